@@ -0,0 +1,84 @@
+/**
+ * @file NetworkBenchmark.hpp
+ *
+ * @brief Load generator of NetworkTestApp, selected with "run-as": "benchmark".
+ *        Runs a Server in the process and connects a number of clients to
+ *        it over loopback or the unix domain socket. Messages of a given
+ *        size are published on the bus at a fixed rate, spread over a
+ *        number of topics, each carrying its send time. Clients decode
+ *        the frames the way Client does and record the one-way latency;
+ *        throughput and p50/p99/p99.9 latency are logged periodically and
+ *        for the whole run on stop.
+ *
+ * @author Nicolae Natea
+ * Contact: nicu@natea.ro
+ */
+
+#ifndef AURORA_CUBE_NETWORK_BENCHMARK_H_
+#define AURORA_CUBE_NETWORK_BENCHMARK_H_
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <boost/asio.hpp>
+#include <boost/property_tree/ptree.hpp>
+
+#include <core/Component.hpp>
+#include <core/util/LatencyHistogram.hpp>
+
+class NetworkBenchmark
+{
+public:
+    /**
+     * @param[in] publisher component the messages are posted from
+     * @param[in] conf "benchmark" settings of NetworkTestApp
+     */
+    NetworkBenchmark(core::Component &publisher, const boost::property_tree::ptree &conf);
+    ~NetworkBenchmark();
+
+    /** Starts the server, connects the clients and starts publishing */
+    void start();
+
+    /** Stops publishing, logs the totals and disconnects everything */
+    void stop();
+
+private:
+    class BenchmarkClient;
+
+    /** Publishes at the configured rate and reports, on m_publisher */
+    void publish();
+
+    /** Logs the statistics gathered since the previous report */
+    void report(const std::chrono::steady_clock::duration &period, uint64_t published);
+
+    core::Component &m_publisher;
+    std::unique_ptr<core::Component> m_server;
+    std::vector<core::TopicId> m_topics;
+
+    uint32_t m_clientCount;
+    uint32_t m_clientThreads;
+    uint32_t m_messageSize;
+    uint32_t m_rate;                  ///< Messages per second, over all topics
+    uint32_t m_reportPeriodMs;
+    bool m_local;                     ///< Clients connect through the unix domain socket
+    std::string m_localPath;
+    uint16_t m_port;
+
+    boost::asio::io_context m_clientContext;
+    std::vector<std::thread> m_clientRunners;
+    std::vector<std::shared_ptr<BenchmarkClient>> m_clients;
+
+    std::thread m_publisherThread;
+    std::atomic<bool> m_isRunning;
+    uint64_t m_published;             ///< Messages posted so far, by m_publisherThread
+    uint64_t m_delivered;             ///< Messages received by all clients so far
+    core::util::LatencyHistogram m_total; ///< Latency of the whole run
+};
+
+#endif
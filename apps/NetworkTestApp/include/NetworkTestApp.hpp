@@ -3,8 +3,11 @@
 
 #include <core/Component.hpp>
 
+#include <memory>
 #include <thread>
 
+#include <NetworkBenchmark.hpp>
+
 class NetworkTestApp : public core::Component
 {
 private:
@@ -31,6 +34,7 @@ private:
     uint32_t m_refreshSrvListPeriodMs;    
     bool m_manageConnection;
     std::thread m_runner;
+    std::unique_ptr<NetworkBenchmark> m_benchmark; ///< Set when running as benchmark
 
     core::TimerId m_refreshServerListTimer;
     core::TimerId m_broadcastMessageTimer;
@@ -0,0 +1,362 @@
+/**
+ * @file NetworkBenchmark.cpp
+ *
+ * @author Nicolae Natea
+ * Contact: nicu@natea.ro
+ */
+
+#include <NetworkBenchmark.hpp>
+
+#include <algorithm>
+#include <cstring>
+#include <string_view>
+
+#include <core/logger/event_logger.h>
+#include <util/network/BinaryMessage.hpp>
+#include <util/network/FrameReader.hpp>
+#include <util/network/LocalTransport.hpp>
+#include <util/network/MessageCodec.hpp>
+
+namespace
+{
+    const char *DOMAIN = "NetworkTestApp";
+    const char *TOPIC_PREFIX = "benchmark-";
+    const uint16_t DEFAULT_PORT = 3200;
+    const size_t MAX_FRAME_SIZE = 1024 * 1024;
+    const size_t STAMP_SIZE = 2 * sizeof(uint64_t); ///< Send time and sequence number, ahead of the filler
+    const std::chrono::milliseconds PUBLISH_TICK(1);
+    const uint32_t MAX_BURSTS_PER_SECOND = 10;
+    const std::chrono::seconds NEGOTIATION_TIMEOUT(5);
+    const std::chrono::milliseconds DRAIN_TIME(500);
+
+    /** @return time of the monotonic clock shared by the publisher and the clients */
+    int64_t getNow()
+    {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+}
+
+/** Viewer connection recording the latency of every message it receives */
+class NetworkBenchmark::BenchmarkClient : public std::enable_shared_from_this<BenchmarkClient>
+{
+public:
+    explicit BenchmarkClient(boost::asio::io_context &context) :
+        m_socket(boost::asio::make_strand(context)),
+        m_reader(MAX_FRAME_SIZE),
+        m_received(0),
+        m_isNegotiated(false)
+    {
+    }
+
+    /** Connects and asks for binary frames, @throws boost::system::system_error */
+    void connect(const boost::asio::generic::stream_protocol::endpoint &endpoint)
+    {
+        boost::system::error_code error;
+        m_socket.connect(endpoint);
+        m_socket.set_option(boost::asio::ip::tcp::no_delay(true), error);
+
+        std::shared_ptr<std::string> hello = util::network::MessageCodec::encode(
+            util::network::WireFormat::BINARY, util::network::BinaryMessage::HELLO_ID, "");
+        boost::asio::write(m_socket, boost::asio::buffer(*hello));
+
+        boost::asio::post(m_socket.get_executor(), [self = shared_from_this()] { self->read(); });
+    }
+
+    /** @return true once the server switched to binary frames */
+    bool isNegotiated() const
+    {
+        return m_isNegotiated;
+    }
+
+    /**
+     * Hands over what was recorded since the previous call
+     *
+     * @param[in,out] histogram receives the latencies
+     * @return number of messages received
+     */
+    uint64_t collect(core::util::LatencyHistogram &histogram)
+    {
+        std::scoped_lock lock(m_mutex);
+
+        uint64_t received = m_received;
+        histogram.merge(m_latency);
+        m_latency.clear();
+        m_received = 0;
+
+        return received;
+    }
+
+    void close()
+    {
+        boost::asio::post(m_socket.get_executor(), [self = shared_from_this()]
+        {
+            boost::system::error_code error;
+            self->m_socket.shutdown(boost::asio::socket_base::shutdown_both, error);
+            self->m_socket.close(error);
+        });
+    }
+
+private:
+    void read()
+    {
+        m_socket.async_read_some(
+            boost::asio::buffer(m_reader.prepare(), m_reader.writable()),
+            [self = shared_from_this()](const boost::system::error_code &ec, size_t readSize)
+            {
+                if (ec)
+                {
+                    return;
+                }
+
+                self->m_reader.commit(readSize);
+
+                std::string_view frame;
+                while (self->m_reader.next(frame))
+                {
+                    util::network::MessageCodec::decode(frame.data(), frame.size(),
+                        [&self](std::string_view id, std::string_view payload, util::network::WireFormat format)
+                        {
+                            self->handleMessage(id, payload);
+                        });
+                }
+
+                self->read();
+            });
+    }
+
+    void handleMessage(std::string_view id, std::string_view payload)
+    {
+        if (id == util::network::BinaryMessage::HELLO_ID)
+        {
+            m_isNegotiated = true;
+            return;
+        }
+
+        if (payload.size() < STAMP_SIZE)
+        {
+            return;
+        }
+
+        int64_t sentAt;
+        std::memcpy(&sentAt, payload.data(), sizeof(sentAt));
+
+        std::scoped_lock lock(m_mutex);
+        m_latency.add(std::chrono::nanoseconds(getNow() - sentAt));
+        ++m_received;
+    }
+
+    boost::asio::generic::stream_protocol::socket m_socket;
+    util::network::FrameReader m_reader;
+
+    std::mutex m_mutex;                       ///< Guards what collect() hands over
+    core::util::LatencyHistogram m_latency;
+    uint64_t m_received;
+    std::atomic<bool> m_isNegotiated;
+};
+
+NetworkBenchmark::NetworkBenchmark(core::Component &publisher, const boost::property_tree::ptree &conf) :
+    m_publisher(publisher),
+    m_clientCount(conf.get<uint32_t>("clients", 10)),
+    m_clientThreads(std::max<uint32_t>(1, conf.get<uint32_t>("client-threads", 1))),
+    m_messageSize(std::max<uint32_t>(STAMP_SIZE, conf.get<uint32_t>("message-size", 512))),
+    m_rate(std::max<uint32_t>(1, conf.get<uint32_t>("rate", 1000))),
+    m_reportPeriodMs(std::max<uint32_t>(100, conf.get<uint32_t>("report-period-ms", 5000))),
+    m_local(conf.get<bool>("local", false)),
+    m_isRunning(false),
+    m_published(0),
+    m_delivered(0)
+{
+    // The server under test is configured like a standalone one, benchmark topics added
+    boost::property_tree::ptree serverConf = conf.get_child("server", boost::property_tree::ptree());
+    m_port = serverConf.get<uint16_t>("server.tcp.port", DEFAULT_PORT);
+    m_localPath = serverConf.get<std::string>(
+        "server.local.path", util::network::LocalTransport::getDefaultPath(m_port));
+
+    serverConf.put("server.tcp.port", m_port);
+    serverConf.put("server.tcp.address", serverConf.get<std::string>("server.tcp.address", "127.0.0.1"));
+    serverConf.put("multicast.group", serverConf.get<std::string>("multicast.group", "239.255.0.1"));
+
+    boost::property_tree::ptree subscriptions;
+    for (uint32_t i = 0, topics = std::max<uint32_t>(1, conf.get<uint32_t>("topics", 1)); i < topics; ++i)
+    {
+        std::string name = TOPIC_PREFIX + std::to_string(i);
+        boost::property_tree::ptree subscription;
+        subscription.put("", name);
+        subscriptions.push_back(std::make_pair("", subscription));
+
+        m_topics.push_back(m_publisher.advertise(name));
+    }
+
+    serverConf.put_child("subscribe", subscriptions);
+
+    boost::property_tree::ptree::value_type server("Server", serverConf);
+    m_server.reset(core::Component::makeComponent(server));
+
+    if (m_server)
+    {
+        m_server->init(server);
+    }
+}
+
+NetworkBenchmark::~NetworkBenchmark()
+{
+    stop();
+}
+
+void NetworkBenchmark::start()
+{
+    if (not m_server or m_isRunning)
+    {
+        return;
+    }
+
+    m_server->start();
+
+    boost::asio::generic::stream_protocol::endpoint endpoint = m_local ?
+        boost::asio::generic::stream_protocol::endpoint(boost::asio::local::stream_protocol::endpoint(
+            util::network::LocalTransport::toSocketPath(m_localPath))) :
+        boost::asio::generic::stream_protocol::endpoint(
+            boost::asio::ip::tcp::endpoint(boost::asio::ip::make_address("127.0.0.1"), m_port));
+
+    for (uint32_t i = 0; i < m_clientCount; ++i)
+    {
+        auto client = std::make_shared<BenchmarkClient>(m_clientContext);
+
+        try
+        {
+            client->connect(endpoint);
+            m_clients.push_back(client);
+        }
+        catch (const boost::system::system_error &e)
+        {
+            LOG_ERROR(DOMAIN, "Benchmark client %u unable to connect: [%s]", i, e.what());
+        }
+    }
+
+    for (uint32_t i = 0; i < m_clientThreads; ++i)
+    {
+        m_clientRunners.emplace_back([this] { m_clientContext.run(); });
+    }
+
+    // Frames sent before the switch to binary would be measured in the wrong format
+    auto deadline = std::chrono::steady_clock::now() + NEGOTIATION_TIMEOUT;
+    for (auto &client : m_clients)
+    {
+        while (not client->isNegotiated() and (std::chrono::steady_clock::now() < deadline))
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    }
+
+    LOG_INFO(DOMAIN, "Benchmark: %zu clients over %s, %zu topics, %u byte messages at %u msg/s",
+        m_clients.size(),
+        m_local ? "unix domain socket" : "tcp",
+        m_topics.size(),
+        m_messageSize,
+        m_rate);
+
+    m_isRunning = true;
+    m_publisherThread = std::thread(&NetworkBenchmark::publish, this);
+}
+
+void NetworkBenchmark::stop()
+{
+    if (not m_isRunning.exchange(false))
+    {
+        return;
+    }
+
+    m_publisherThread.join();
+
+    // Lets the messages in flight arrive before the totals
+    std::this_thread::sleep_for(DRAIN_TIME);
+    report(std::chrono::steady_clock::duration::zero(), 0);
+
+    uint64_t expected = m_published * m_clients.size();
+    LOG_INFO(DOMAIN, "Benchmark total: published %llu, delivered %llu of %llu; latency %s",
+        static_cast<unsigned long long>(m_published),
+        static_cast<unsigned long long>(m_delivered),
+        static_cast<unsigned long long>(expected),
+        m_total.toString().c_str());
+
+    for (auto &client : m_clients)
+    {
+        client->close();
+    }
+
+    for (auto &runner : m_clientRunners)
+    {
+        runner.join();
+    }
+
+    m_clients.clear();
+    m_clientRunners.clear();
+    m_server->stop();
+}
+
+void NetworkBenchmark::publish()
+{
+    std::string filler(m_messageSize, 'x');
+
+    auto start = std::chrono::steady_clock::now();
+    auto lastReport = start;
+    uint64_t lastPublished = 0;
+
+    while (m_isRunning)
+    {
+        auto now = std::chrono::steady_clock::now();
+        uint64_t due = static_cast<uint64_t>(std::chrono::duration<double>(now - start).count() * m_rate);
+
+        // Catches up in a burst when a tick came late, so the average rate holds.
+        // A server that cannot keep up shows as a lower published rate, reports keep coming
+        due = std::min<uint64_t>(due, m_published + std::max<uint32_t>(1, m_rate / MAX_BURSTS_PER_SECOND));
+        while ((m_published < due) and m_isRunning)
+        {
+            std::string payload(filler);
+            int64_t sentAt = getNow();
+            std::memcpy(&payload[0], &sentAt, sizeof(sentAt));
+            std::memcpy(&payload[sizeof(sentAt)], &m_published, sizeof(m_published));
+
+            core::MessageData attrs;
+            attrs.set("data", core::util::SharedBuffer(std::move(payload)));
+            m_publisher.post(m_topics[m_published % m_topics.size()], attrs);
+            ++m_published;
+        }
+
+        if (now - lastReport >= std::chrono::milliseconds(m_reportPeriodMs))
+        {
+            report(now - lastReport, m_published - lastPublished);
+            lastReport = now;
+            lastPublished = m_published;
+        }
+
+        std::this_thread::sleep_until(now + PUBLISH_TICK);
+    }
+}
+
+void NetworkBenchmark::report(const std::chrono::steady_clock::duration &period, uint64_t published)
+{
+    core::util::LatencyHistogram window;
+    uint64_t delivered = 0;
+
+    for (auto &client : m_clients)
+    {
+        delivered += client->collect(window);
+    }
+
+    m_delivered += delivered;
+    m_total.merge(window);
+
+    double seconds = std::chrono::duration<double>(period).count();
+    if (seconds == 0)
+    {
+        return;
+    }
+
+    LOG_INFO(DOMAIN, "Benchmark: published %.0f msg/s, delivered %.0f msg/s (%.2f MB/s); latency %s",
+        published / seconds,
+        delivered / seconds,
+        delivered * m_messageSize / seconds / (1024 * 1024),
+        window.toString().c_str());
+}
@@ -2,6 +2,8 @@
 
 #include <core/util/EnumCast.hpp>
 #include <core/logger/event_logger.h>
+#include <optional>
+#include <string>
 #include <thread>
 
 #include <iostream>
@@ -9,6 +11,7 @@
 namespace
 {
     const char *DOMAIN = "NetworkTestApp";
+    const char *BENCHMARK_MODE = "benchmark";
 
     core::util::EnumCast<bool> runAsMode =
         core::util::EnumCast<bool>
@@ -45,8 +48,15 @@ NetworkTestApp *NetworkTestApp::clone() const
 void NetworkTestApp::init(const boost::property_tree::ptree::value_type &component)
 {
     auto &conf = component.second;
+    std::string runAs = conf.get<std::string>("run-as", "server");
 
-    m_isServer = runAsMode(conf.get<std::string>("run-as", "server"));
+    if (runAs == BENCHMARK_MODE)
+    {
+        m_benchmark = std::make_unique<NetworkBenchmark>(*this, conf.get_child("benchmark", boost::property_tree::ptree()));
+        return;
+    }
+
+    m_isServer = runAsMode(runAs);
     m_updatePeriodMs = conf.get<uint32_t>("update-period-ms", m_updatePeriodMs);
     m_refreshSrvListPeriodMs = conf.get<uint32_t>("refresh-server-list-ms", m_refreshSrvListPeriodMs);
     m_manageConnection = conf.get<bool>("manage-connection", m_manageConnection);
@@ -57,6 +67,12 @@ void NetworkTestApp::init(const boost::property_tree::ptree::value_type &compone
 
 void NetworkTestApp::start()
 {
+    if (m_benchmark)
+    {
+        m_benchmark->start();
+        return;
+    }
+
     if (not m_isActive)
     {
         m_isActive = true;
@@ -89,7 +105,7 @@ void NetworkTestApp::start()
                     runAsMode(m_isServer).c_str(), message.c_str());
 
                 core::MessageData attrs;
-                attrs.set<std::string>("data", message);
+                attrs.set("data", core::util::SharedBuffer(std::move(message)));
                 post(runAsMode(m_isServer), attrs);
             },
             std::chrono::milliseconds{m_updatePeriodMs}
@@ -99,6 +115,12 @@ void NetworkTestApp::start()
 
 void NetworkTestApp::stop()
 {
+    if (m_benchmark)
+    {
+        m_benchmark->stop();
+        return;
+    }
+
     cancelTimer(m_broadcastMessageTimer);
 
     if (not m_isServer)
@@ -116,7 +138,7 @@ void NetworkTestApp::handleIncomingData(const core::MessageId &id, const core::M
 {
     LOG_INFO(DOMAIN, "NETWORK_DATA: Id[%s] Data[%s]",
         id.c_str(),
-        attrs.get<std::string>("data").c_str()
+        attrs.get<core::util::SharedBuffer>("data").data()
     );
 }
 
@@ -124,25 +146,32 @@ void NetworkTestApp::handleServerListUpdate(const core::util::Attributes &attrs)
 {
     std::stringstream sstr;
     uint32_t updateId = 0;
+    std::optional<int> firstServerId;
 
     sstr << "#############################" << std::endl;
     sstr << "UPDATE_SERVER_LIST:" << std::endl;
 
-    for (auto it : attrs)
+    for (const auto &it : attrs)
     {
-        if (it.first != "update_id")
+        if (it.key() != "update_id")
         {
-            std::string serverAddress = attrs.get<std::string>(it.first).c_str();
-            sstr << "[" << it.first.c_str() << "] => " << serverAddress.c_str() << std::endl;
+            const std::string &serverAddress = it.value().get<std::string>();
+            sstr << "[" << it.key().c_str() << "] => " << serverAddress.c_str() << std::endl;
+
+            // Servers keep their id, which is what CONNECT_TO_SERVER takes
+            if (not firstServerId)
+            {
+                firstServerId = std::stoi(std::string(it.key()));
+            }
         }
         else
         {
-            updateId = attrs.get<uint32_t>(it.first);
-            sstr << "[" << it.first.c_str() << "] => " << updateId << std::endl;
+            updateId = it.value().get<uint32_t>();
+            sstr << "[" << it.key().c_str() << "] => " << updateId << std::endl;
         }
     }
 
-    if (m_manageConnection)
+    if (m_manageConnection and firstServerId)
     {
         sstr << "#############################" << std::endl;
         sstr << "Trigger connect to the first server" << std::endl;
@@ -150,7 +179,7 @@ void NetworkTestApp::handleServerListUpdate(const core::util::Attributes &attrs)
 
         core::MessageData connectDetails;
         connectDetails.set<int>("update_id", updateId);
-        connectDetails.set<int>("id", 1);
+        connectDetails.set<int>("id", *firstServerId);
         post("CONNECT_TO_SERVER", connectDetails);
     }
 }
\ No newline at end of file
@@ -45,6 +45,7 @@ protected:
 
 private:
     int m_timerId;
+    core::TopicId m_updateLedTopic;
     std::thread m_uiThread;
     util::math::Cube<util::graphics::Color> m_cubeData;
     static Cube3dComponent _prototype;
@@ -54,29 +54,26 @@ void Cube3dComponent::init(const boost::property_tree::ptree::value_type& compon
         std::placeholders::_3,
         std::placeholders::_4);
 
-    subscribe("updateLed", std::bind(&Cube3dComponent::updateLed, this, std::placeholders::_1));
+    m_updateLedTopic = subscribe("updateLed", std::bind(&Cube3dComponent::updateLed, this, std::placeholders::_1));
     subscribe("updateCube", std::bind(&Cube3dComponent::updateCube, this, std::placeholders::_1));
     subscribe("cubeState", std::bind(&Cube3dComponent::updateCube, this, std::placeholders::_1));
 }
 
 void Cube3dComponent::updateLed(const core::util::Attributes &attrs)
 {
-    std::string data;
-    attrs.get("data", data);
+    core::util::SharedBuffer data = attrs.get<core::util::SharedBuffer>("data");
 
     common::message::type::LedState ledState;
-    ledState.fromString(data);
+    ledState.fromString(data.str());
 
     m_cubeData.set(ledState.x, ledState.y, ledState.z, ledState.color);
 }
 
 void Cube3dComponent::updateCube(const core::util::Attributes &attrs)
 {
-    std::string data;
-    attrs.get("data", data);
+    core::util::SharedBuffer data = attrs.get<core::util::SharedBuffer>("data");
 
-    util::math::Cube<util::graphics::Color> cubeData(1);
-    m_cubeData.fromString(data);
+    m_cubeData.fromString(data.str());
 }
 
 void Cube3dComponent::activeItemBlink(const boost::system::error_code &e)
@@ -132,8 +129,8 @@ void Cube3dComponent::publishLedState(uint32_t x, uint32_t y, uint32_t z, const
     ledState.z = z;
     ledState.color = color;
 
-    attrs.set("data", ledState.toString());
-    post("updateLed", attrs);
+    attrs.set("data", core::util::SharedBuffer(ledState.toString()));
+    post(m_updateLedTopic, attrs);
 }
 
 void Cube3dComponent::start()
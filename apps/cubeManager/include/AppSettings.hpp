@@ -12,6 +12,8 @@
 
 #include <boost/property_tree/ptree.hpp>
 
+#include <core/TimerStatistics.hpp>
+
 #include "CubeController.hpp"
 
 namespace apps
@@ -31,6 +33,8 @@ namespace apps
                 pins{0},
                 cyclePeriodMs(5),
                 statePublishPeriodMs(0),
+                catchUpPolicy(core::CatchUpPolicy::SKIP),
+                presentationDelayMs(0),
                 enableController(true)
             {
             }
@@ -42,6 +46,9 @@ namespace apps
             CubePinout pins;
             uint32_t cyclePeriodMs;
             uint32_t statePublishPeriodMs;
+            core::CatchUpPolicy catchUpPolicy;
+            uint32_t presentationDelayMs; ///< Frames without a presentation time are shown this late, at once if 0;
+                                          ///< should match server.presentation.delay-ms
             bool enableController;
 
         private:
@@ -1,6 +1,16 @@
 /**
  * @file CubeManager.hpp
  *
+ * @brief Drives the cube, refreshing one layer at a time.
+ *        Frames carrying a presentation time, set by the network on the
+ *        clock of this node, are held until then and swapped in on the
+ *        next layer refresh, so cubes fed by different nodes show the
+ *        same frame within a layer period of each other. Local frames,
+ *        and network ones received before the clock of the server is
+ *        known, are held for presentation-delay-ms instead, which must
+ *        match server.presentation.delay-ms of the server for them to
+ *        line up with the scheduled ones.
+ *
  * @author Nicolae Natea
  * Contact: nicu@natea.ro
  */
@@ -9,9 +19,14 @@
 #define _APPS_CUBEMANAGER_CUBEMANAGER_
 
 #include <gpiod.h>
+#include <chrono>
+#include <cstdint>
+#include <deque>
 #include <memory>
+#include <mutex>
 
 #include <core/Component.hpp>
+#include <core/util/LatencyHistogram.hpp>
 
 #include "CubeController.hpp"
 #include "CubeData.hpp"
@@ -39,18 +54,40 @@ namespace apps
             void updateCube(const core::MessageData &attrs);
             void updateLed(const core::MessageData &attrs);
 
+            /** Swaps in the latest frame whose presentation time has come */
+            void presentDueFrame();
+
         private:
+            /** Frame waiting for its presentation time */
+            struct PendingFrame
+            {
+                std::chrono::steady_clock::time_point presentAt;
+                util::math::Cube<util::graphics::Color> content;
+            };
+
+            /** Most frames held at once, older ones are dropped beyond it */
+            static const size_t MAX_PENDING_FRAMES = 64;
+
             static CubeManager _prototype;
 
             std::shared_ptr<CubeControllerItf> m_controllerPtr;
             core::TimerId m_timerCycleId;
             core::TimerId m_timerStateId;
+            core::TopicId m_cubeStateTopic;
 
             CubeData m_cubeData;
             uint8_t m_numLayers;
 
             uint8_t m_activeLayer;
             uint8_t m_activeDigit;
+
+            std::shared_ptr<std::mutex> m_pendingMutex;
+            std::deque<PendingFrame> m_pendingFrames;        ///< By presentation time, under m_pendingMutex
+            uint64_t m_presentedFrames;                      ///< Scheduled frames shown, under m_pendingMutex
+            uint64_t m_lateFrames;                           ///< Scheduled frames received past their time
+            uint64_t m_skippedFrames;                        ///< Scheduled frames superseded before being shown
+            core::util::LatencyHistogram m_presentationLag; ///< From the scheduled time to the swap
+            bool m_isDelayMismatchReported;                  ///< A frame showed a longer server delay, under m_pendingMutex
         };
     }
 }
@@ -29,6 +29,13 @@ void AppSettings::configure(const boost::property_tree::ptree& configuration)
     statePublishPeriodMs = configuration.get<uint32_t>("state-publish-period-ms", statePublishPeriodMs);
     LOG_INFO(DOMAIN, "State publish period: [%d ms]", statePublishPeriodMs);
 
+    catchUpPolicy = core::catch_up_policy_map(
+        configuration.get<std::string>("catch-up-policy", core::catch_up_policy_map(catchUpPolicy)));
+    LOG_INFO(DOMAIN, "Layer refresh catch-up policy: [%s]", core::catch_up_policy_map(catchUpPolicy).c_str());
+
+    presentationDelayMs = configuration.get<uint32_t>("presentation-delay-ms", presentationDelayMs);
+    LOG_INFO(DOMAIN, "Presentation delay of unscheduled frames: [%d ms]", presentationDelayMs);
+
     if (enableController)
     {
         pins.A0   = configuration.get<uint8_t>("pins.A0"  );
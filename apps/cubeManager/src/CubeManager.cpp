@@ -8,6 +8,8 @@
 #include "CubeManager.hpp"
 
 #include <iomanip>
+#include <iterator>
+#include <optional>
 
 #include <core/logger/event_logger.h>
 #include <common/message/type/LedState.hpp>
@@ -25,7 +27,11 @@ CubeManager CubeManager::_prototype;
 CubeManager::CubeManager() :
     m_numLayers(8),
     m_activeLayer(0),
-    m_activeDigit(0)
+    m_activeDigit(0),
+    m_presentedFrames(0),
+    m_lateFrames(0),
+    m_skippedFrames(0),
+    m_isDelayMismatchReported(false)
 {
     addPrototype(DOMAIN, this);
 }
@@ -44,6 +50,9 @@ void CubeManager::init(const boost::property_tree::ptree::value_type &component)
         std::shared_ptr<CubeControllerItf>(new CubeController(params.pins)) :
         std::shared_ptr<CubeControllerItf>(new StubCubeController(params.pins));
 
+    m_cubeStateTopic = advertise("cubeState");
+    m_pendingMutex = std::make_shared<std::mutex>();
+
     subscribe(
         "updateCube",
         std::bind(&CubeManager::updateCube, this, std::placeholders::_1));
@@ -61,7 +70,8 @@ void CubeManager::start()
 
     m_timerCycleId = setPeriodicTimer(
         std::bind(&CubeManager::periodicUpdate, this, std::placeholders::_1),
-        std::chrono::microseconds(cyclePeriodUs));
+        std::chrono::microseconds(cyclePeriodUs),
+        params.catchUpPolicy);
 
     if (params.statePublishPeriodMs != 0)
     {
@@ -75,13 +85,32 @@ void CubeManager::start()
 
 void CubeManager::stop()
 {
+    core::TimerStatistics statistics;
+
+    if (getTimerStatistics(m_timerCycleId, statistics))
+    {
+        LOG_INFO(DOMAIN, "Layer refresh timer: %s", statistics.toString().c_str());
+    }
+
     cancelTimer(m_timerCycleId);
     cancelTimer(m_timerStateId);
     m_controllerPtr.reset();
+
+    std::scoped_lock<std::mutex> lock(*m_pendingMutex);
+    if (m_presentedFrames or m_lateFrames or m_skippedFrames)
+    {
+        LOG_INFO(DOMAIN, "Scheduled frames presented: %llu, late: %llu, superseded: %llu; lag %s",
+            static_cast<unsigned long long>(m_presentedFrames),
+            static_cast<unsigned long long>(m_lateFrames),
+            static_cast<unsigned long long>(m_skippedFrames),
+            m_presentationLag.toString().c_str());
+    }
 }
 
 void CubeManager::periodicUpdate(const boost::system::error_code &e)
 {
+    presentDueFrame();
+
     ++m_activeLayer;
     if (m_activeLayer >= m_numLayers)
     {
@@ -106,28 +135,110 @@ void CubeManager::periodicUpdate(const boost::system::error_code &e)
 void CubeManager::publishState(const boost::system::error_code &e)
 {
     core::MessageData attrs;
-    attrs.set("data", m_cubeData.getContent().toString());
-    post("cubeState", attrs);
+    attrs.set("data", core::util::SharedBuffer(m_cubeData.getContent().toString()));
+    post(m_cubeStateTopic, attrs);
 }
 
 void CubeManager::updateCube(const core::MessageData &attrs)
 {
-    std::string data;
-    attrs.get("data", data);
+    core::util::SharedBuffer data = attrs.get<core::util::SharedBuffer>("data");
 
     util::math::Cube<util::graphics::Color> cubeData(1);
-    cubeData.fromString(data);
+    cubeData.fromString(data.str());
+
+    // Frames from the network are scheduled by the server, the local ones as late as theirs
+    std::optional<std::chrono::steady_clock::time_point> presentAt;
+    attrs.get_optional("present_at", presentAt);
+
+    auto now = std::chrono::steady_clock::now();
+    const AppSettings &params = AppSettings::getInstance();
+    std::chrono::milliseconds presentationDelay(params.presentationDelayMs);
+
+    std::scoped_lock<std::mutex> lock(*m_pendingMutex);
+
+    // The server lead only shrinks on the way, a longer one means the two delays differ
+    if (presentAt and (*presentAt - now > presentationDelay + std::chrono::milliseconds(params.cyclePeriodMs)) and
+        not m_isDelayMismatchReported)
+    {
+        LOG_WARNING(DOMAIN, "Frame scheduled %lld ms ahead, local frames are shown after %u ms;"
+            " presentation-delay-ms should match server.presentation.delay-ms",
+            static_cast<long long>(std::chrono::duration_cast<std::chrono::milliseconds>(*presentAt - now).count()),
+            params.presentationDelayMs);
+        m_isDelayMismatchReported = true;
+    }
+
+    if (not presentAt and (presentationDelay.count() != 0))
+    {
+        presentAt = now + presentationDelay;
+    }
+
+    // Shown at once, so the frames still waiting are older and must not replace it later
+    if (not presentAt)
+    {
+        m_skippedFrames += m_pendingFrames.size();
+        m_pendingFrames.clear();
+        m_cubeData.setContent(cubeData);
+        return;
+    }
+
+    if (*presentAt <= now)
+    {
+        LOG_DEBUG(DOMAIN, "Frame received %lld us past its presentation time",
+            static_cast<long long>(std::chrono::duration_cast<std::chrono::microseconds>(now - *presentAt).count()));
+
+        ++m_lateFrames;
+    }
+
+    // Frames mostly arrive in order, the search rarely moves past the back
+    auto position = m_pendingFrames.end();
+    while ((position != m_pendingFrames.begin()) and (std::prev(position)->presentAt > *presentAt))
+    {
+        --position;
+    }
+
+    m_pendingFrames.insert(position, PendingFrame{*presentAt, cubeData});
+
+    if (m_pendingFrames.size() > MAX_PENDING_FRAMES)
+    {
+        LOG_WARNING(DOMAIN, "More than %zu frames waiting to be presented, dropping the oldest", MAX_PENDING_FRAMES);
+
+        m_pendingFrames.pop_front();
+        ++m_skippedFrames;
+    }
+}
+
+void CubeManager::presentDueFrame()
+{
+    auto now = std::chrono::steady_clock::now();
+
+    std::scoped_lock<std::mutex> lock(*m_pendingMutex);
+
+    if (m_pendingFrames.empty() or (m_pendingFrames.front().presentAt > now))
+    {
+        return;
+    }
+
+    // Only the latest due frame is shown, the ones before it were already superseded
+    while ((m_pendingFrames.size() > 1) and (m_pendingFrames[1].presentAt <= now))
+    {
+        m_pendingFrames.pop_front();
+        ++m_skippedFrames;
+    }
+
+    PendingFrame &frame = m_pendingFrames.front();
+    m_cubeData.setContent(frame.content);
+    m_presentationLag.add(now - frame.presentAt);
+    ++m_presentedFrames;
 
-    m_cubeData.setContent(cubeData);
+    m_pendingFrames.pop_front();
 }
 
 void CubeManager::updateLed(const core::MessageData &attrs)
 {
-    std::string data;
-    attrs.get("data", data);
+    core::util::SharedBuffer data = attrs.get<core::util::SharedBuffer>("data");
 
     common::message::type::LedState ledState;
-    ledState.fromString(data);
+    ledState.fromString(data.str());
 
     m_cubeData.setState(ledState.x, ledState.y, ledState.z, ledState.color);
 }
\ No newline at end of file
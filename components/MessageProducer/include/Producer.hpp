@@ -55,6 +55,9 @@ namespace component
 		/** Published message */
 		std::string m_published_message;
 
+		/** Published message topic */
+		core::TopicId m_published_topic;
+
 		/** Add the Producer prototype */
 		static Producer _prototype;
 
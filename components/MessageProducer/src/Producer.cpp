@@ -36,6 +36,7 @@ namespace component
 		m_duration_ms = base.m_duration_ms;
 		m_stop = base.m_stop;
 		m_last_published_message_id = base.m_last_published_message_id;
+		m_published_topic = base.m_published_topic;
 	}
 
 	Producer::~Producer()
@@ -61,6 +62,11 @@ namespace component
 
 		m_duration_ms = timePeriod * timeUnitFactorMap(timeUnit);
 		m_published_message = msgId;
+
+		if (not m_published_message.empty())
+		{
+			m_published_topic = advertise(m_published_message);
+		}
 	}
 
 	void Producer::handler(const boost::system::error_code &e)
@@ -83,7 +89,7 @@ namespace component
 				"Producer: publishing message-id: %s with value: %u",
 				m_published_message.c_str(),
 				attr.get<uint32_t>("count"));
-			post(m_published_message, attr);
+			post(m_published_topic, attr);
 		}
 	}
 
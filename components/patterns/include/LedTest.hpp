@@ -28,6 +28,7 @@ private:
     uint8_t m_activeZ;
     bool m_enabled;
     core::TimerId m_timerId;
+    core::TopicId m_updateCubeTopic;
     util::math::Cube<util::graphics::Color> m_cubeData;
 
     static LedTest _prototype;
@@ -25,6 +25,7 @@ private:
     uint8_t m_updateRatePercentage;
     bool m_enabled;
     core::TimerId m_timerId;
+    core::TopicId m_updateCubeTopic;
     util::math::Cube<util::graphics::Color> m_cubeData;
 
     static SnowFlake _prototype;
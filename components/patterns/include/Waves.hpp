@@ -24,6 +24,7 @@ private:
     uint32_t m_updatePeriodMs;
     bool m_enabled;
     core::TimerId m_timerId;
+    core::TopicId m_updateCubeTopic;
     util::math::Cube<util::graphics::Color> m_cubeData;
 
     static Waves _prototype;
@@ -29,6 +29,8 @@ void BoxIt::init(const boost::property_tree::ptree::value_type& component)
 {
     auto config = component.second;
 
+    m_updateCubeTopic = advertise("updateCube");
+
     uint32_t cubeSize = m_cubeData.size();
 
     cubeSize = config.get<uint32_t>("cube-size", cubeSize);
@@ -94,6 +96,6 @@ void BoxIt::start()
 void BoxIt::update(const boost::system::error_code &e)
 {
     core::MessageData attr;
-    attr.set("data", m_cubeData.toString());
-    post("updateCube", attr);
+    attr.set("data", core::util::SharedBuffer(m_cubeData.toString()));
+    post(m_updateCubeTopic, attr);
 }
\ No newline at end of file
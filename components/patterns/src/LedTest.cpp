@@ -33,6 +33,8 @@ void LedTest::init(const boost::property_tree::ptree::value_type& component)
 {
     auto config = component.second;
 
+    m_updateCubeTopic = advertise("updateCube");
+
     uint32_t cubeSize = m_cubeData.size();
 
     cubeSize = config.get<uint32_t>("cube-size", cubeSize);
@@ -101,7 +103,7 @@ void LedTest::ledTest(const boost::system::error_code &e)
     // Update the active led
     m_cubeData(m_activeX, m_activeY, m_activeZ) = WHITE;
 
-    attr.set("data", m_cubeData.toString());
+    attr.set("data", core::util::SharedBuffer(m_cubeData.toString()));
 
-    post("updateCube", attr);
+    post(m_updateCubeTopic, attr);
 }
\ No newline at end of file
@@ -129,6 +129,8 @@ void Marques::init(const boost::property_tree::ptree::value_type& component)
 {
     auto config = component.second;
 
+    m_updateCubeTopic = advertise("updateCube");
+
     uint32_t cubeSize = m_cubeData.size();
 
     cubeSize = config.get<uint32_t>("cube-size", cubeSize);
@@ -237,8 +239,8 @@ void Marques::update(const boost::system::error_code &e)
     m_currentIteration++;
 
     core::MessageData attr;
-    attr.set("data", m_cubeData.toString());
-    post("updateCube", attr);
+    attr.set("data", core::util::SharedBuffer(m_cubeData.toString()));
+    post(m_updateCubeTopic, attr);
 }
 
 void Marques::clearCube()
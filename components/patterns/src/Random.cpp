@@ -32,6 +32,8 @@ void Random::init(const boost::property_tree::ptree::value_type& component)
 {
     auto config = component.second;
 
+    m_updateCubeTopic = advertise("updateCube");
+
     uint32_t cubeSize = m_cubeData.size();
 
     cubeSize = config.get<uint32_t>("cube-size", cubeSize);
@@ -82,6 +84,6 @@ void Random::update(const boost::system::error_code &e)
     }
 
     core::MessageData attr;
-    attr.set("data", m_cubeData.toString());
-    post("updateCube", attr);
+    attr.set("data", core::util::SharedBuffer(m_cubeData.toString()));
+    post(m_updateCubeTopic, attr);
 }
\ No newline at end of file
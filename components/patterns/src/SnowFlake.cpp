@@ -36,6 +36,8 @@ void SnowFlake::init(const boost::property_tree::ptree::value_type& component)
 {
     auto config = component.second;
 
+    m_updateCubeTopic = advertise("updateCube");
+
     uint32_t cubeSize = m_cubeData.size();
 
     cubeSize = config.get<uint32_t>("cube-size", cubeSize);
@@ -93,7 +95,7 @@ void SnowFlake::snowLeds(const boost::system::error_code &e)
         }
     }
 
-    attr.set("data", m_cubeData.toString());
+    attr.set("data", core::util::SharedBuffer(m_cubeData.toString()));
 
-    post("updateCube", attr);
+    post(m_updateCubeTopic, attr);
 }
\ No newline at end of file
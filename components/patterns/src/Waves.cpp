@@ -36,6 +36,8 @@ void Waves::init(const boost::property_tree::ptree::value_type& component)
 {
     auto config = component.second;
 
+    m_updateCubeTopic = advertise("updateCube");
+
     uint32_t cubeSize = m_cubeData.size();
 
     cubeSize = config.get<uint32_t>("cube-size", cubeSize);
@@ -96,7 +98,7 @@ void Waves::waves(const boost::system::error_code &e)
         m_cubeData(i, cubeSize - 1, cubeSize - 1) = color;
     }
 
-    attr.set("data", m_cubeData.toString());
+    attr.set("data", core::util::SharedBuffer(m_cubeData.toString()));
 
-    post("updateCube", attr);
+    post(m_updateCubeTopic, attr);
 }
@@ -15,26 +15,34 @@
 #define _CORE_COMPONENT_COMPONENT_H_
 
 #include <any>
+#include <atomic>
 #include <functional>
 #include <cstdint>
 #include <string>
 #include <map>
+#include <mutex>
+#include <optional>
+#include <shared_mutex>
+#include <unordered_map>
 
 #include <boost/asio.hpp>
 #include <boost/property_tree/ptree.hpp>
-#include <boost/ptr_container/ptr_map.hpp>
+#include <boost/ptr_container/ptr_vector.hpp>
 #include <boost/signals2.hpp>
 
 #include <core/util/Attributes.hpp>
+#include <core/util/SharedBuffer.hpp>
+#include <core/Mailbox.hpp>
+#include <core/TimerStatistics.hpp>
 
 namespace core
 {
 	// Poorly defined types ... TO FIX
 	typedef uint64_t TimerId;
+	typedef uint32_t TopicId;
 	typedef std::string MessageId;
 	typedef core::util::Attributes MessageData;
-	typedef boost::signals2::signal<void (MessageData)> Signal;
-	typedef boost::ptr_map<std::string, Signal>  SignalMap;
+	typedef boost::signals2::signal<void (const MessageData&)> Signal;
 	typedef std::function<void (const MessageData&)> MessageHandler;
 	typedef std::function<void (const boost::system::error_code &)> TimeoutHandler;
 
@@ -43,14 +51,44 @@ namespace core
 	{
 		const uint32_t MAX_NBR_OF_COMPONENT = 64;
 		const uint32_t MAX_COMPONENT_NAME_LEN = 32;
+		const uint32_t MAX_NBR_OF_TOPICS = 1024;
 	}
 
+	/** Message topic, identified by a dense TopicId */
+	struct Topic
+	{
+		Topic(const MessageId &topicName) : name(topicName), conflate(false), dropped(0)
+		{
+		}
+
+		MessageId name;                ///< Message name
+		Signal signal;                 ///< Subscribers
+		bool conflate;                 ///< Subscribers only receive the newest pending message
+		std::atomic<uint64_t> dropped; ///< Messages superseded before a subscriber handled them
+	};
+
+	typedef boost::ptr_vector<Topic> TopicList;
+	typedef std::unordered_map<MessageId, TopicId> TopicMap;
+
+	/** How the message handlers and timers of a component are executed */
+	enum struct ExecutionMode
+	{
+		DIRECT, ///< Handlers run on the thread posting the message or firing the timer
+		MAILBOX ///< Handlers are queued, then run one at a time on the scheduler threads
+	};
+
+	static const core::util::EnumCast<ExecutionMode> execution_mode_map =
+		core::util::EnumCast<ExecutionMode>
+			(ExecutionMode::DIRECT,  "direct")
+			(ExecutionMode::MAILBOX, "mailbox");
+
 	/** Component class */
 	class Component {
 
 		public:
 			// Construction
 			Component();
+			Component(const Component &other);
 			virtual ~Component();
 
 			// Methods
@@ -64,7 +102,11 @@ namespace core
 			static Component* addPrototype(const char* type, Component* p);
 
 			/**
-			 *  Creates a clone of the selected component
+			 *  Creates a clone of the selected component.
+			 *  The "execution" parameter selects the ExecutionMode (default "direct"),
+			 *  "mailbox-size" the number of pending handlers in mailbox mode, and
+			 *  "mailbox-max-wait-ms" how long a thread outside the scheduler waits
+			 *  for room in a full mailbox before the handler is dropped.
 			 *
 			 *   @param[in] component parameters of the object
 			 */
@@ -86,40 +128,171 @@ namespace core
 			/** Method to signal the stop of a component */
 			virtual void stop();
 
-			/** Method to permit a component to subscribe to a message-id */
-			void subscribe(const MessageId& messageName, MessageHandler handler);
+			/**
+			 * Method to register a message-id that a component publishes.
+			 * The returned id may be used to post without name lookups.
+			 *
+			 *  @param[in] messageName message name
+			 *  @return id of the topic
+			 */
+			TopicId advertise(const MessageId& messageName);
+
+			/**
+			 * Method to permit a component to subscribe to a message-id.
+			 * In mailbox mode the handler is queued on the component executor.
+			 */
+			TopicId subscribe(const MessageId& messageName, MessageHandler handler);
+
+			/** Method to publish a message on a topic returned by advertise/subscribe */
+			void post(TopicId topic, const MessageData& message);
 
 			/** Method to publish a message-id */
 			void post(const MessageId& messageName, const MessageData& message);
 
-			/** Method to start a one shot timer */
+			/** @return name of the topic */
+			static const MessageId& getTopicName(TopicId topic);
+
+			/**
+			 * Method to declare a topic as a latest-value stream. A subscriber that
+			 * is still busy receives only the newest of the messages posted meanwhile,
+			 * the others are dropped unread. Must be called before subscribing.
+			 *
+			 *  @param[in] messageName message name
+			 */
+			static void setConflating(const MessageId& messageName);
+
+			/** @return number of messages dropped on a conflating topic */
+			static uint64_t getDroppedCount(TopicId topic);
+
+			/** @return drop counters of all conflating topics, one per line */
+			static std::string getTopicStatistics();
+
+			/**
+			 * Method to start a one shot timer. Timers of all components
+			 * share the threads of the core::Scheduler.
+			 * The handler is not called if the timer is cancelled.
+			 */
 			TimerId setOneShotTimer(
 				TimeoutHandler handler,
 				const std::chrono::steady_clock::duration &duration);
 
-			/** Method to start a periodic timer */
+			/**
+			 * Method to start a periodic timer. Expirations are scheduled on
+			 * absolute deadlines (start + n * period) so the handler run time
+			 * does not accumulate as drift.
+			 *
+			 *  @param[in] handler method called on each expiration
+			 *  @param[in] period timer period
+			 *  @param[in] policy action taken when deadlines have been missed
+			 */
 			TimerId setPeriodicTimer(
 				TimeoutHandler handler,
-				const std::chrono::steady_clock::duration &period);
+				const std::chrono::steady_clock::duration &period,
+				CatchUpPolicy policy = CatchUpPolicy::SKIP);
 
 			/** Method to cancel a running timer */
 			bool cancelTimer(TimerId timer);
 
+			/**
+			 * Method to retrieve the deadline statistics of a periodic timer
+			 *
+			 *  @param[in] timer timer id
+			 *  @param[out] statistics copy of the current counters
+			 *  @return true if the timer is running, false otherwise
+			 */
+			bool getTimerStatistics(TimerId timer, TimerStatistics &statistics);
+
 		protected:
+			/**
+			 * Method to select how handlers and timers are executed.
+			 * Must be called before subscribing or starting timers.
+			 */
+			void setExecutionMode(
+				ExecutionMode mode,
+				uint32_t mailboxSize = DEFAULT_MAILBOX_SIZE,
+				uint32_t mailboxMaxWaitMs = DEFAULT_MAILBOX_MAX_WAIT_MS);
+
+			/**
+			 * Method to wait on a timer, the handler goes through the mailbox if any.
+			 * Timer completions bypass the mailbox capacity: a periodic timer is only
+			 * re-armed by its handler, one dropped completion would stop it.
+			 */
+			template <typename Handler>
+			void asyncWait(boost::asio::steady_timer &timer, Handler handler)
+			{
+				if (m_mailbox)
+				{
+					std::shared_ptr<Mailbox> mailbox = m_mailbox;
+					timer.async_wait(
+						[mailbox, handler](const boost::system::error_code &e)
+						{
+							mailbox->postTimeout([handler, e] { handler(e); });
+						});
+				}
+				else
+				{
+					timer.async_wait(handler);
+				}
+			}
+
+			/** Newest message not yet handled by a subscriber of a conflating topic */
+			struct LatestValue
+			{
+				LatestValue() : busy(false)
+				{
+				}
+
+				std::mutex mutex;                  ///< Protects the members below
+				std::optional<MessageData> pending; ///< Newest unhandled message
+				bool busy;                         ///< A drain is queued or running
+			};
+
+			/** Method to hand the newest pending message to the handler until none is left */
+			static void drainLatest(LatestValue &slot, const MessageHandler &handler);
+
+			/** Timer registered on the shared scheduler */
+			struct Timer
+			{
+				Timer(boost::asio::io_context &context) : timer(context)
+				{
+				}
+
+				boost::asio::steady_timer timer; ///< Asio timer
+				TimerStatistics statistics;      ///< Deadline accounting
+			};
+
+			/**
+			 * Method to find or create a topic.
+			 * Caller must hold m_topics_mutex exclusively.
+			 */
+			static TopicId getTopic(const MessageId& messageName);
+
 			/** Method to get a unique timer id */
 			TimerId getNextTimerId();
 
+			/** Method to get a timer registered on the shared scheduler */
+			std::shared_ptr<Timer> createTimer(TimerId timerId);
+
 			/** Method to handle periodic timer expiration */
 			void handleTimeout(
 				TimeoutHandler handler,
 				const TimerId timerId,
+				std::shared_ptr<Timer> timer,
+				const std::chrono::steady_clock::time_point deadline,
 				const std::chrono::steady_clock::duration period,
+				const CatchUpPolicy policy,
 				const boost::system::error_code &e);
 
 		protected:
 
-			/** Map of all registered signals */
-			static SignalMap m_signal_map;
+			/** All registered topics, indexed by TopicId */
+			static TopicList m_topics;
+
+			/** Topic ids indexed by message name */
+			static TopicMap m_topic_ids;
+
+			/** Synchronization mutex for topic registration */
+			static std::shared_mutex m_topics_mutex;
 
 			/** Array of available component names */
 			static char m_components_name[MAX_NBR_OF_COMPONENT][MAX_COMPONENT_NAME_LEN];
@@ -130,10 +303,20 @@ namespace core
 			/** Available components */
 			static uint32_t m_components_count;
 
-			std::map<TimerId, std::shared_ptr<boost::asio::steady_timer>> m_timers;
+			/** Timers owned by this component, registered on the shared scheduler */
+			std::map<TimerId, std::shared_ptr<Timer>> m_timers;
+
+			/** Synchronization mutex for the timers map */
+			std::mutex m_timers_mutex;
 
 			/** Last allocated timer */
 			TimerId m_last_timer_id;
+
+			/** Execution mode */
+			ExecutionMode m_execution_mode;
+
+			/** Pending handlers in mailbox mode, empty otherwise */
+			std::shared_ptr<Mailbox> m_mailbox;
 	};
 }
 
@@ -0,0 +1,116 @@
+/**
+ * @file Mailbox.hpp
+ *
+ * @brief Queue of pending handlers of a component running in mailbox mode.
+ *        Any thread may post; the handlers are executed one at a time, in
+ *        order, on the scheduler threads. Posting is lock free: the
+ *        scheduler is only involved when an idle mailbox becomes busy.
+ *        A full mailbox drops the newest handler. Threads outside the
+ *        scheduler may first wait a bounded time for room; scheduler
+ *        threads never wait, the mailbox may need them to drain.
+ *        Timer completions are queued apart and never dropped, a lost
+ *        completion would stop a periodic timer for good.
+ *
+ * @author Nicolae Natea
+ * Contact: nicu@natea.ro
+ */
+
+#ifndef _CORE_COMPONENT_MAILBOX_H_
+#define _CORE_COMPONENT_MAILBOX_H_
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+
+#include <boost/asio.hpp>
+
+#include <core/util/MpscQueue.hpp>
+
+namespace core
+{
+	namespace
+	{
+		const uint32_t DEFAULT_MAILBOX_SIZE = 1024;
+		const uint32_t DEFAULT_MAILBOX_MAX_WAIT_MS = 0;
+	}
+
+	/** Mailbox class */
+	class Mailbox : public std::enable_shared_from_this<Mailbox> {
+
+		public:
+			typedef std::function<void ()> Task;
+
+			/**
+			 *  @param[in] context context on which the handlers are executed
+			 *  @param[in] capacity maximum number of pending handlers
+			 *  @param[in] maxWait longest a thread outside the scheduler waits for room
+			 */
+			Mailbox(
+				boost::asio::io_context &context,
+				uint32_t capacity = DEFAULT_MAILBOX_SIZE,
+				std::chrono::milliseconds maxWait = std::chrono::milliseconds(DEFAULT_MAILBOX_MAX_WAIT_MS));
+
+			/**
+			 * Method to queue a handler. When the mailbox is full the handler
+			 * is dropped, after waiting up to maxWait for room if the caller
+			 * is not a scheduler thread.
+			 *
+			 *  @return false if the handler was dropped
+			 */
+			bool post(Task task);
+
+			/**
+			 * Method to queue a timer completion, regardless of the capacity.
+			 * Each timer has at most one completion outstanding, so this
+			 * queue is bounded by the number of running timers.
+			 */
+			void postTimeout(Task task);
+
+			/** @return number of handlers dropped because the mailbox was full */
+			uint64_t getDropped() const;
+
+		protected:
+			/** Method to run the pending handlers, one drain is active at a time */
+			void drain();
+
+			/** Method to queue a drain on the scheduler */
+			void schedule();
+
+			/** Method to count a queued handler, scheduling a drain if the mailbox was idle */
+			void addPending();
+
+			/** Method to take the oldest timer completion, if any */
+			bool popTimeout(Task &task);
+
+		private:
+			/** Context on which the handlers are executed */
+			boost::asio::io_context &m_context;
+
+			/** Pending handlers */
+			core::util::MpscQueue<Task> m_tasks;
+
+			/** Pending timer completions, served before the handlers */
+			std::deque<Task> m_timeouts;
+
+			/** Number of entries in m_timeouts, checked without the lock */
+			std::atomic<size_t> m_timeoutCount;
+
+			/** Synchronization mutex for the timer completions */
+			std::mutex m_timeoutsMutex;
+
+			/** Number of handlers posted and not yet executed */
+			std::atomic<size_t> m_pending;
+
+			/** Longest a thread outside the scheduler waits for room */
+			std::chrono::milliseconds m_maxWait;
+
+			/** Number of handlers dropped */
+			std::atomic<uint64_t> m_dropped;
+	};
+}
+
+#endif /* _CORE_COMPONENT_MAILBOX_H_ */
@@ -0,0 +1,80 @@
+/**
+ * @file Scheduler.hpp
+ *
+ * @brief Process wide execution context shared by all components.
+ *        Timers of every component are multiplexed on a single
+ *        io_context (heap based timer queue) which is driven by a
+ *        small, fixed pool of threads.
+ *
+ * @author Nicolae Natea
+ * Contact: nicu@natea.ro
+ */
+
+#ifndef _CORE_COMPONENT_SCHEDULER_H_
+#define _CORE_COMPONENT_SCHEDULER_H_
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <boost/asio.hpp>
+
+namespace core
+{
+	namespace
+	{
+		const uint32_t DEFAULT_SCHEDULER_THREADS = 2;
+	}
+
+	/** Scheduler class */
+	class Scheduler {
+
+		public:
+			/** @return the process wide scheduler */
+			static Scheduler& getInstance();
+
+			/**
+			 * Starts the worker threads. Calling it on a running
+			 * scheduler has no effect.
+			 *
+			 *  @param[in] threadCount number of threads driving the scheduler
+			 */
+			void start(uint32_t threadCount = DEFAULT_SCHEDULER_THREADS);
+
+			/** Stops and joins the worker threads */
+			void stop();
+
+			/**
+			 * @return the shared io_context. The scheduler is started
+			 *         with the default number of threads if needed.
+			 */
+			boost::asio::io_context& getContext();
+
+			/** @return number of worker threads */
+			uint32_t getThreadCount() const;
+
+		private:
+			Scheduler();
+			~Scheduler();
+
+			Scheduler(const Scheduler &other) = delete;
+			Scheduler& operator=(const Scheduler &other) = delete;
+
+		private:
+			/** Shared context on which all timers are registered */
+			boost::asio::io_context m_ioContext;
+
+			/** Keeps the context running while no timers are pending */
+			std::unique_ptr<boost::asio::executor_work_guard<boost::asio::io_context::executor_type>> m_workGuard;
+
+			/** Worker threads */
+			std::vector<std::thread> m_workers;
+
+			/** Synchronization mutex for start/stop */
+			std::mutex m_mutex;
+	};
+}
+
+#endif /* _CORE_COMPONENT_SCHEDULER_H_ */
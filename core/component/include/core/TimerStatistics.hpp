@@ -0,0 +1,62 @@
+/**
+ * @file TimerStatistics.hpp
+ *
+ * @brief Deadline accounting for periodic timers.
+ *
+ * @author Nicolae Natea
+ * Contact: nicu@natea.ro
+ */
+
+#ifndef _CORE_COMPONENT_TIMER_STATISTICS_H_
+#define _CORE_COMPONENT_TIMER_STATISTICS_H_
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+#include <core/util/EnumCast.hpp>
+
+namespace core
+{
+	/** Behaviour of a periodic timer once one or more deadlines have passed */
+	enum struct CatchUpPolicy
+	{
+		SKIP,  ///< Drop the missed deadlines and resume on the next one in phase
+		BURST  ///< Run the handler back to back until the schedule is caught up
+	};
+
+	static const core::util::EnumCast<CatchUpPolicy> catch_up_policy_map =
+		core::util::EnumCast<CatchUpPolicy>
+			(CatchUpPolicy::SKIP,  "skip")
+			(CatchUpPolicy::BURST, "burst");
+
+	/** Counters kept for each periodic timer */
+	struct TimerStatistics
+	{
+		/**
+		 * Number of lateness buckets. Bucket 0 counts expirations served
+		 * within 1us of their deadline, bucket i those in [2^(i-1), 2^i) us,
+		 * the last one everything above.
+		 */
+		static const uint32_t JITTER_BUCKETS = 16;
+
+		uint64_t expirations = 0;                            ///< Handler invocations
+		uint64_t missedDeadlines = 0;                        ///< Skipped (SKIP) or served a period late (BURST)
+		std::chrono::nanoseconds maxLateness{0};             ///< Worst delay between deadline and handler
+		std::array<uint64_t, JITTER_BUCKETS> jitterHistogram{}; ///< Lateness distribution
+
+		/**
+		 * Account for one expiration
+		 *
+		 *  @param[in] lateness delay between the deadline and the handler call,
+		 *             counted as none if the handler ran early
+		 */
+		void addExpiration(const std::chrono::nanoseconds &lateness);
+
+		/** @return human readable summary */
+		std::string toString() const;
+	};
+}
+
+#endif /* _CORE_COMPONENT_TIMER_STATISTICS_H_ */
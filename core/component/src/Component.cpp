@@ -6,35 +6,47 @@
  */
 
 #include <iostream>
-#include <thread>
+#include <sstream>
 
 #include <core/logger/event_logger.h>
 #include <core/Component.hpp>
+#include <core/Scheduler.hpp>
 
 namespace core
 {
+	namespace
+	{
+		const char *DOMAIN = "Component";
+	}
+
 	// Globals
 	char Component::m_components_name[MAX_NBR_OF_COMPONENT][MAX_COMPONENT_NAME_LEN];
 	Component* Component::m_components_base[MAX_NBR_OF_COMPONENT];
 	uint32_t Component::m_components_count = 0;
-	SignalMap Component::m_signal_map;
+	TopicList Component::m_topics;
+	TopicMap Component::m_topic_ids;
+	std::shared_mutex Component::m_topics_mutex;
 
-	Component::Component()
+	Component::Component() :
+		m_last_timer_id(0),
+		m_execution_mode(ExecutionMode::DIRECT)
 	{
 	}
 
+	Component::Component(const Component &other) :
+		m_last_timer_id(0),
+		m_execution_mode(ExecutionMode::DIRECT)
+	{
+		// Timers belong to the instance that started them, they are not copied
+	}
+
 	Component::~Component()
 	{
-		std::vector<TimerId> timerIds;
-		std::transform(
-			m_timers.begin(),
-			m_timers.end(),
-			std::back_inserter(timerIds),
-			[](auto const &entry) {return entry.first;});
+		std::scoped_lock lock(m_timers_mutex);
 
-		for (auto& timerId : timerIds)
+		for (auto &timer : m_timers)
 		{
-			cancelTimer(timerId);
+			timer.second->timer.cancel();
 		}
 
 		m_timers.clear();
@@ -86,8 +98,29 @@ namespace core
 			return nullptr;
 		}
 
-		return temp->clone();
+		Component *clone = temp->clone();
+		clone->setExecutionMode(
+			execution_mode_map(component.second.get<std::string>("execution", execution_mode_map(ExecutionMode::DIRECT))),
+			component.second.get<uint32_t>("mailbox-size", DEFAULT_MAILBOX_SIZE),
+			component.second.get<uint32_t>("mailbox-max-wait-ms", DEFAULT_MAILBOX_MAX_WAIT_MS));
 
+		return clone;
+	}
+
+	void Component::setExecutionMode(ExecutionMode mode, uint32_t mailboxSize, uint32_t mailboxMaxWaitMs)
+	{
+		m_execution_mode = mode;
+
+		if (mode == ExecutionMode::MAILBOX)
+		{
+			// Serialized per component, parallel across components
+			m_mailbox = std::make_shared<Mailbox>(
+				Scheduler::getInstance().getContext(), mailboxSize, std::chrono::milliseconds(mailboxMaxWaitMs));
+		}
+		else
+		{
+			m_mailbox.reset();
+		}
 	}
 
 	void Component::start()
@@ -99,16 +132,191 @@ namespace core
 
 	}
 
-	void Component::subscribe(const MessageId& messageName, MessageHandler handler)
+	TopicId Component::getTopic(const MessageId& messageName)
+	{
+		auto topic = m_topic_ids.find(messageName);
+
+		if (topic != m_topic_ids.end())
+		{
+			return topic->second;
+		}
+
+		if (m_topics.size() >= MAX_NBR_OF_TOPICS)
+		{
+			LOG_PANIC("dbg", "Too many topics, unable to register: %s\n", messageName.c_str());
+			throw std::length_error("Too many topics");
+		}
+
+		// Topics are never removed and the storage is reserved upfront, so
+		// ids handed out remain valid and lock free to dispatch on
+		if (m_topics.capacity() < MAX_NBR_OF_TOPICS)
+		{
+			m_topics.reserve(MAX_NBR_OF_TOPICS);
+		}
+
+		TopicId topicId = m_topics.size();
+		m_topics.push_back(new Topic(messageName));
+		m_topic_ids.emplace(messageName, topicId);
+
+		return topicId;
+	}
+
+	TopicId Component::advertise(const MessageId& messageName)
+	{
+		std::unique_lock lock(m_topics_mutex);
+		return getTopic(messageName);
+	}
+
+	TopicId Component::subscribe(const MessageId& messageName, MessageHandler handler)
+	{
+		std::unique_lock lock(m_topics_mutex);
+		TopicId topicId = getTopic(messageName);
+		Topic &topic = m_topics[topicId];
+
+		if (topic.conflate)
+		{
+			// Publishers only replace the pending message; whoever finds the slot
+			// idle becomes the drainer, so stale frames are never handed out
+			std::shared_ptr<LatestValue> slot = std::make_shared<LatestValue>();
+			std::shared_ptr<Mailbox> mailbox = m_mailbox;
+			topic.signal.connect(
+				[&topic, slot, mailbox, handler](const MessageData &message)
+				{
+					{
+						std::scoped_lock slotLock(slot->mutex);
+
+						if (slot->pending)
+						{
+							topic.dropped.fetch_add(1, std::memory_order_relaxed);
+						}
+
+						slot->pending = message;
+
+						if (slot->busy)
+						{
+							return;
+						}
+
+						slot->busy = true;
+					}
+
+					if (mailbox)
+					{
+						// Left pending, the next message tries again
+						if (not mailbox->post([slot, handler] { drainLatest(*slot, handler); }))
+						{
+							std::scoped_lock slotLock(slot->mutex);
+							slot->busy = false;
+						}
+					}
+					else
+					{
+						drainLatest(*slot, handler);
+					}
+				});
+		}
+		else if (m_execution_mode == ExecutionMode::MAILBOX)
+		{
+			// Publishers only enqueue, the handler runs from the component mailbox
+			std::shared_ptr<Mailbox> mailbox = m_mailbox;
+			topic.signal.connect(
+				[mailbox, handler](const MessageData &message)
+				{
+					mailbox->post([handler, message] { handler(message); });
+				});
+		}
+		else
+		{
+			topic.signal.connect(handler);
+		}
+
+		return topicId;
+	}
+
+	void Component::post(TopicId topic, const MessageData& message)
 	{
-		m_signal_map[messageName].connect(handler);
+		m_topics[topic].signal(message);
 	}
 
 	void Component::post(const MessageId& messageName, const MessageData& message)
 	{
-		if (m_signal_map.find(messageName) != m_signal_map.end())
+		TopicId topicId;
+
+		{
+			std::shared_lock lock(m_topics_mutex);
+			auto topic = m_topic_ids.find(messageName);
+
+			if (topic == m_topic_ids.end())
+			{
+				// Nobody subscribed or advertised the message
+				return;
+			}
+
+			topicId = topic->second;
+		}
+
+		post(topicId, message);
+	}
+
+	const MessageId& Component::getTopicName(TopicId topic)
+	{
+		return m_topics[topic].name;
+	}
+
+	void Component::setConflating(const MessageId& messageName)
+	{
+		std::unique_lock lock(m_topics_mutex);
+		Topic &topic = m_topics[getTopic(messageName)];
+
+		if (not topic.signal.empty())
+		{
+			LOG_WARNING(DOMAIN, "Topic [%s] made conflating after subscribers connected", messageName.c_str());
+		}
+
+		topic.conflate = true;
+	}
+
+	uint64_t Component::getDroppedCount(TopicId topic)
+	{
+		return m_topics[topic].dropped.load(std::memory_order_relaxed);
+	}
+
+	std::string Component::getTopicStatistics()
+	{
+		std::shared_lock lock(m_topics_mutex);
+		std::ostringstream oss;
+
+		for (const Topic &topic : m_topics)
 		{
-			m_signal_map[messageName](message);
+			if (topic.conflate)
+			{
+				oss << topic.name << ": dropped " << topic.dropped.load(std::memory_order_relaxed) << std::endl;
+			}
+		}
+
+		return oss.str();
+	}
+
+	void Component::drainLatest(LatestValue &slot, const MessageHandler &handler)
+	{
+		for (;;)
+		{
+			MessageData message;
+
+			{
+				std::scoped_lock lock(slot.mutex);
+
+				if (not slot.pending)
+				{
+					slot.busy = false;
+					return;
+				}
+
+				message = std::move(*slot.pending);
+				slot.pending.reset();
+			}
+
+			handler(message);
 		}
 	}
 
@@ -117,53 +325,64 @@ namespace core
 		const std::chrono::steady_clock::duration &duration)
 	{
 		TimerId timerId = getNextTimerId();
-		std::thread thr(
-			[this, timerId, handler, duration]
+		std::shared_ptr<Timer> timer = createTimer(timerId);
+
+		timer->timer.expires_after(duration);
+		asyncWait(
+			timer->timer,
+			[this, timerId, handler](const boost::system::error_code &e)
 			{
-				boost::asio::io_context io;
-				m_timers[timerId] = std::make_shared<boost::asio::steady_timer>(io);
-				m_timers[timerId]->expires_after(duration);
-				m_timers[timerId]->async_wait(handler);
+				if (e == boost::asio::error::operation_aborted)
+				{
+					return;
+				}
 
-				io.run();
-				m_timers.erase(timerId);
+				{
+					std::scoped_lock lock(m_timers_mutex);
+					m_timers.erase(timerId);
+				}
+
+				handler(e);
 			});
-		thr.detach();
+
 		return timerId;
 	}
 
 	TimerId Component::setPeriodicTimer(
 		TimeoutHandler handler,
-		const std::chrono::steady_clock::duration &period)
+		const std::chrono::steady_clock::duration &period,
+		CatchUpPolicy policy)
 	{
 		TimerId timerId = getNextTimerId();
-		std::thread thr(
-			[this, timerId, handler, period]
-			{
-				boost::asio::io_context io;
-				m_timers[timerId] = std::make_shared<boost::asio::steady_timer>(io);
-				m_timers[timerId]->expires_after(period);
-				m_timers[timerId]->async_wait(
-					boost::bind(
-						&Component::handleTimeout,
-						this,
-						handler,
-						timerId,
-						period,
-						boost::asio::placeholders::error));
-
-				io.run();
-			});
-		thr.detach();
+		std::shared_ptr<Timer> timer = createTimer(timerId);
+		std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::now() + period;
+
+		timer->timer.expires_at(deadline);
+		asyncWait(
+			timer->timer,
+			boost::bind(
+				&Component::handleTimeout,
+				this,
+				handler,
+				timerId,
+				timer,
+				deadline,
+				period,
+				policy,
+				boost::asio::placeholders::error));
+
 		return timerId;
 	}
 
 	bool Component::cancelTimer(TimerId timerId)
 	{
-		if (m_timers.count(timerId))
+		std::scoped_lock lock(m_timers_mutex);
+		auto timer = m_timers.find(timerId);
+
+		if (timer != m_timers.end())
 		{
-			m_timers[timerId]->cancel();
-			m_timers.erase(timerId);
+			timer->second->timer.cancel();
+			m_timers.erase(timer);
 
 			return true;
 		}
@@ -171,33 +390,97 @@ namespace core
 		return false;
 	}
 
+	bool Component::getTimerStatistics(TimerId timerId, TimerStatistics &statistics)
+	{
+		std::scoped_lock lock(m_timers_mutex);
+		auto timer = m_timers.find(timerId);
+
+		if (timer != m_timers.end())
+		{
+			statistics = timer->second->statistics;
+			return true;
+		}
+
+		return false;
+	}
+
 	TimerId Component::getNextTimerId()
 	{
+		std::scoped_lock lock(m_timers_mutex);
 		return ++m_last_timer_id;
 	}
 
+	std::shared_ptr<Component::Timer> Component::createTimer(TimerId timerId)
+	{
+		std::shared_ptr<Timer> timer = std::make_shared<Timer>(Scheduler::getInstance().getContext());
+
+		std::scoped_lock lock(m_timers_mutex);
+		m_timers[timerId] = timer;
+
+		return timer;
+	}
+
 	void Component::handleTimeout(
 		TimeoutHandler handler,
 		const TimerId timerId,
+		std::shared_ptr<Timer> timer,
+		const std::chrono::steady_clock::time_point deadline,
 		const std::chrono::steady_clock::duration period,
+		const CatchUpPolicy policy,
 		const boost::system::error_code &e)
 	{
 		if (e.value())
 		{
-			cancelTimer(timerId);
+			// Cancelled timers have already been removed from the map
 			return;
 		}
 
+		std::chrono::steady_clock::duration lateness = std::chrono::steady_clock::now() - deadline;
+
 		handler(e);
 
-		m_timers[timerId]->expires_after(period);
-		m_timers[timerId]->async_wait(
+		// Only re-arm if the timer was not cancelled while the handler was running
+		std::scoped_lock lock(m_timers_mutex);
+
+		if (m_timers.count(timerId) == 0)
+		{
+			return;
+		}
+
+		timer->statistics.addExpiration(lateness);
+
+		// Next deadline is always computed from the previous one, never from "now"
+		std::chrono::steady_clock::time_point nextDeadline = deadline + period;
+		std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+
+		if (policy == CatchUpPolicy::BURST)
+		{
+			// Late deadlines are still served, back to back
+			if (lateness >= period)
+			{
+				++timer->statistics.missedDeadlines;
+			}
+		}
+		else if (nextDeadline <= now)
+		{
+			// Resume on the first deadline still ahead, keeping the original phase
+			uint64_t missed = (now - deadline) / period;
+			timer->statistics.missedDeadlines += missed;
+			nextDeadline = deadline + (missed + 1) * period;
+		}
+
+		timer->timer.expires_at(nextDeadline);
+		asyncWait(
+			timer->timer,
 			boost::bind(
 				&Component::handleTimeout,
 				this,
 				handler,
 				timerId,
+				timer,
+				nextDeadline,
 				period,
+				policy,
 				boost::asio::placeholders::error));
 	}
 }
@@ -0,0 +1,129 @@
+/**
+ * @file Mailbox.cpp
+ *
+ * @author Nicolae Natea
+ * Contact: nicu@natea.ro
+ */
+
+#include <thread>
+
+#include <core/logger/event_logger.h>
+#include <core/Mailbox.hpp>
+
+namespace core
+{
+	namespace
+	{
+		const char *DOMAIN = "Mailbox";
+
+		/** Handlers executed per drain, so busy mailboxes do not starve the others */
+		const size_t MAX_BATCH_SIZE = 32;
+	}
+
+	Mailbox::Mailbox(boost::asio::io_context &context, uint32_t capacity, std::chrono::milliseconds maxWait) :
+		m_context(context),
+		m_tasks(capacity),
+		m_timeoutCount(0),
+		m_pending(0),
+		m_maxWait(maxWait),
+		m_dropped(0)
+	{
+	}
+
+	bool Mailbox::post(Task task)
+	{
+		bool queued = m_tasks.push(task);
+
+		// A scheduler thread waiting could be the one the mailbox needs to drain
+		if (not queued and (m_maxWait.count() > 0) and not m_context.get_executor().running_in_this_thread())
+		{
+			auto deadline = std::chrono::steady_clock::now() + m_maxWait;
+
+			while (not (queued = m_tasks.push(task)) and (std::chrono::steady_clock::now() < deadline))
+			{
+				std::this_thread::yield();
+			}
+		}
+
+		if (not queued)
+		{
+			uint64_t dropped = m_dropped.fetch_add(1, std::memory_order_relaxed) + 1;
+
+			// Logged at powers of two, an overloaded mailbox does not flood the log
+			if ((dropped & (dropped - 1)) == 0)
+			{
+				LOG_WARNING(DOMAIN, "Mailbox full, %llu handlers dropped so far", static_cast<unsigned long long>(dropped));
+			}
+
+			return false;
+		}
+
+		addPending();
+		return true;
+	}
+
+	void Mailbox::postTimeout(Task task)
+	{
+		{
+			std::scoped_lock lock(m_timeoutsMutex);
+			m_timeouts.push_back(std::move(task));
+			m_timeoutCount.fetch_add(1, std::memory_order_release);
+		}
+
+		addPending();
+	}
+
+	void Mailbox::addPending()
+	{
+		// Only the transition from idle to busy needs the scheduler
+		if (m_pending.fetch_add(1, std::memory_order_acq_rel) == 0)
+		{
+			schedule();
+		}
+	}
+
+	bool Mailbox::popTimeout(Task &task)
+	{
+		if (m_timeoutCount.load(std::memory_order_acquire) == 0)
+		{
+			return false;
+		}
+
+		std::scoped_lock lock(m_timeoutsMutex);
+		task = std::move(m_timeouts.front());
+		m_timeouts.pop_front();
+		m_timeoutCount.fetch_sub(1, std::memory_order_relaxed);
+
+		return true;
+	}
+
+	uint64_t Mailbox::getDropped() const
+	{
+		return m_dropped.load(std::memory_order_relaxed);
+	}
+
+	void Mailbox::schedule()
+	{
+		boost::asio::post(m_context, [self = shared_from_this()] { self->drain(); });
+	}
+
+	void Mailbox::drain()
+	{
+		size_t pending = m_pending.load(std::memory_order_acquire);
+		size_t executed = 0;
+		Task task;
+
+		while ((executed < pending) and (executed < MAX_BATCH_SIZE) and (popTimeout(task) or m_tasks.pop(task)))
+		{
+			task();
+			task = nullptr;
+			++executed;
+		}
+
+		// Reschedule if anything was posted meanwhile or left over from the batch
+		if (m_pending.fetch_sub(executed, std::memory_order_acq_rel) != executed)
+		{
+			schedule();
+		}
+	}
+}
@@ -0,0 +1,92 @@
+/**
+ * @file Scheduler.cpp
+ *
+ * @author Nicolae Natea
+ * Contact: nicu@natea.ro
+ */
+
+#include <core/logger/event_logger.h>
+#include <core/Scheduler.hpp>
+
+namespace core
+{
+	namespace
+	{
+		const char *DOMAIN = "Scheduler";
+	}
+
+	Scheduler::Scheduler()
+	{
+	}
+
+	Scheduler::~Scheduler()
+	{
+		stop();
+	}
+
+	Scheduler& Scheduler::getInstance()
+	{
+		static Scheduler instance;
+		return instance;
+	}
+
+	void Scheduler::start(uint32_t threadCount)
+	{
+		std::scoped_lock lock(m_mutex);
+
+		if (not m_workers.empty())
+		{
+			return;
+		}
+
+		if (threadCount == 0)
+		{
+			threadCount = 1;
+		}
+
+		LOG_INFO(DOMAIN, "Starting scheduler with [%u] threads", threadCount);
+
+		m_ioContext.restart();
+		m_workGuard = std::make_unique<boost::asio::executor_work_guard<boost::asio::io_context::executor_type>>(
+			m_ioContext.get_executor());
+
+		for (uint32_t i = 0; i < threadCount; ++i)
+		{
+			m_workers.emplace_back([this] { m_ioContext.run(); });
+		}
+	}
+
+	void Scheduler::stop()
+	{
+		std::scoped_lock lock(m_mutex);
+
+		if (m_workers.empty())
+		{
+			return;
+		}
+
+		m_workGuard.reset();
+		m_ioContext.stop();
+
+		for (auto &worker : m_workers)
+		{
+			if (worker.joinable())
+			{
+				worker.join();
+			}
+		}
+
+		m_workers.clear();
+	}
+
+	boost::asio::io_context& Scheduler::getContext()
+	{
+		start();
+		return m_ioContext;
+	}
+
+	uint32_t Scheduler::getThreadCount() const
+	{
+		return m_workers.size();
+	}
+}
@@ -0,0 +1,67 @@
+/**
+ * @file TimerStatistics.cpp
+ *
+ * @author Nicolae Natea
+ * Contact: nicu@natea.ro
+ */
+
+#include <core/TimerStatistics.hpp>
+
+#include <algorithm>
+
+namespace core
+{
+	void TimerStatistics::addExpiration(const std::chrono::nanoseconds &lateness)
+	{
+		++expirations;
+
+		// A handler called ahead of its deadline is on time
+		std::chrono::nanoseconds delay = std::max(lateness, std::chrono::nanoseconds::zero());
+
+		if (delay > maxLateness)
+		{
+			maxLateness = delay;
+		}
+
+		uint64_t latenessUs = std::chrono::duration_cast<std::chrono::microseconds>(delay).count();
+		uint32_t bucket = 0;
+
+		while ((latenessUs > 0) and (bucket < JITTER_BUCKETS - 1))
+		{
+			latenessUs >>= 1;
+			++bucket;
+		}
+
+		++jitterHistogram[bucket];
+	}
+
+	std::string TimerStatistics::toString() const
+	{
+		std::string response;
+
+		response.append("expirations: ");
+		response.append(std::to_string(expirations));
+		response.append(", missed: ");
+		response.append(std::to_string(missedDeadlines));
+		response.append(", max lateness: ");
+		response.append(std::to_string(std::chrono::duration_cast<std::chrono::microseconds>(maxLateness).count()));
+		response.append("us, lateness histogram [<1us");
+
+		for (uint32_t i = 1; i < JITTER_BUCKETS; ++i)
+		{
+			response.append((i == JITTER_BUCKETS - 1) ? ", >=" : ", <");
+			response.append(std::to_string(1u << ((i == JITTER_BUCKETS - 1) ? i - 1 : i)));
+			response.append("us");
+		}
+
+		response.append("]: ");
+
+		for (uint32_t i = 0; i < JITTER_BUCKETS; ++i)
+		{
+			response.append((i == 0) ? "" : " ");
+			response.append(std::to_string(jitterHistogram[i]));
+		}
+
+		return response;
+	}
+}
@@ -0,0 +1,475 @@
+/**
+ * @file ComponentTest.cpp
+ *
+ * @author Nicolae Natea
+ * Contact: nicu@natea.ro
+ */
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include <core/Component.hpp>
+
+using namespace std::chrono_literals;
+
+namespace
+{
+	/** Component exposing the protected members the tests rely on */
+	class TestComponent : public core::Component
+	{
+		public:
+			core::Component* clone() const override
+			{
+				return new TestComponent(*this);
+			}
+
+			void init(const boost::property_tree::ptree::value_type &component) override
+			{
+			}
+
+			using core::Component::setExecutionMode;
+			using core::Component::m_mailbox;
+	};
+
+	/** Lets makeComponent clone a TestComponent */
+	core::Component *prototype = core::Component::addPrototype("ComponentTest", new TestComponent());
+
+	/** Polls the condition until it holds or the timeout expires */
+	bool waitFor(const std::function<bool ()> &condition, std::chrono::milliseconds timeout = 2000ms)
+	{
+		auto deadline = std::chrono::steady_clock::now() + timeout;
+
+		while (not condition())
+		{
+			if (std::chrono::steady_clock::now() >= deadline)
+			{
+				return false;
+			}
+
+			std::this_thread::sleep_for(1ms);
+		}
+
+		return true;
+	}
+
+	/** Handler holding the mailbox busy until released */
+	struct Gate
+	{
+		Gate() : released(promise.get_future().share()), entered(0)
+		{
+		}
+
+		void operator()(const core::MessageData &message)
+		{
+			entered.fetch_add(1);
+			released.wait();
+		}
+
+		void release()
+		{
+			promise.set_value();
+		}
+
+		std::promise<void> promise;
+		std::shared_future<void> released;
+		std::atomic<int> entered;
+	};
+}
+
+TEST(ComponentTest, FullMailboxKeepsPeriodicTimer)
+{
+	TestComponent component;
+	component.setExecutionMode(core::ExecutionMode::MAILBOX, 2);
+
+	Gate gate;
+	core::TopicId topic = component.subscribe("ComponentTest.full.block", std::ref(gate));
+
+	// One handler blocks the mailbox, two more fill it, the last one is dropped
+	component.post(topic, core::MessageData());
+	ASSERT_TRUE(waitFor([&gate] { return gate.entered.load() == 1; }));
+	component.post(topic, core::MessageData());
+	component.post(topic, core::MessageData());
+	component.post(topic, core::MessageData());
+	EXPECT_EQ(1u, component.m_mailbox->getDropped());
+
+	// Expirations complete while the mailbox is full
+	std::atomic<int> expirations(0);
+	core::TimerId timer = component.setPeriodicTimer(
+		[&expirations](const boost::system::error_code &e) { expirations.fetch_add(1); },
+		2ms);
+
+	std::this_thread::sleep_for(20ms);
+	gate.release();
+
+	EXPECT_TRUE(waitFor([&expirations] { return expirations.load() >= 5; }));
+	EXPECT_EQ(1u, component.m_mailbox->getDropped());
+
+	component.cancelTimer(timer);
+	std::this_thread::sleep_for(10ms);
+}
+
+TEST(ComponentTest, MailboxRunsHandlersOneAtATimeInOrder)
+{
+	TestComponent component;
+	component.setExecutionMode(core::ExecutionMode::MAILBOX);
+
+	const int SENDERS = 2;
+	const int MESSAGES = 200;
+	std::atomic<int> active(0);
+	std::atomic<bool> overlapped(false);
+	std::atomic<int> handled(0);
+	std::vector<int> next(SENDERS, 0);
+	bool ordered = true;
+
+	core::TopicId topic = component.subscribe("ComponentTest.mailbox.order",
+		[&](const core::MessageData &message)
+		{
+			if (active.fetch_add(1) != 0)
+			{
+				overlapped = true;
+			}
+
+			// Unsynchronized on purpose, the mailbox serializes the handlers
+			int sender = message.get<int>("sender");
+			ordered = ordered and (message.get<int>("seq") == next[sender]);
+			next[sender] = message.get<int>("seq") + 1;
+
+			std::this_thread::yield();
+			active.fetch_sub(1);
+			handled.fetch_add(1);
+		});
+
+	std::vector<std::thread> senders;
+	for (int sender = 0; sender < SENDERS; ++sender)
+	{
+		senders.emplace_back([&component, topic, sender, MESSAGES]
+			{
+				for (int seq = 0; seq < MESSAGES; ++seq)
+				{
+					core::MessageData message;
+					message.set("sender", sender);
+					message.set("seq", seq);
+					component.post(topic, message);
+				}
+			});
+	}
+
+	for (auto &sender : senders)
+	{
+		sender.join();
+	}
+
+	ASSERT_TRUE(waitFor([&handled] { return handled.load() == SENDERS * MESSAGES; }));
+	EXPECT_FALSE(overlapped);
+	EXPECT_TRUE(ordered);
+	EXPECT_EQ(0u, component.m_mailbox->getDropped());
+}
+
+TEST(ComponentTest, MailboxSettingsFromConfiguration)
+{
+	boost::property_tree::ptree config;
+	config.put("execution", "mailbox");
+	config.put("mailbox-size", 2);
+	config.put("mailbox-max-wait-ms", 2000);
+
+	std::unique_ptr<core::Component> created(
+		core::Component::makeComponent(boost::property_tree::ptree::value_type("ComponentTest", config)));
+	TestComponent *component = dynamic_cast<TestComponent *>(created.get());
+	ASSERT_NE(nullptr, component);
+	ASSERT_TRUE(component->m_mailbox);
+
+	Gate gate;
+	std::atomic<int> handled(0);
+	core::TopicId topic = component->subscribe("ComponentTest.config.block",
+		[&gate, &handled](const core::MessageData &message)
+		{
+			gate(message);
+			handled.fetch_add(1);
+		});
+
+	component->post(topic, core::MessageData());
+	ASSERT_TRUE(waitFor([&gate] { return gate.entered.load() == 1; }));
+	component->post(topic, core::MessageData());
+	component->post(topic, core::MessageData());
+
+	// The mailbox is full, posting waits until the gate opens
+	std::thread opener([&gate]
+		{
+			std::this_thread::sleep_for(20ms);
+			gate.release();
+		});
+
+	component->post(topic, core::MessageData());
+	opener.join();
+
+	EXPECT_TRUE(waitFor([&handled] { return handled.load() == 4; }));
+	EXPECT_EQ(0u, component->m_mailbox->getDropped());
+}
+
+TEST(ComponentTest, MailboxTimersWaitForTheHandlers)
+{
+	TestComponent component;
+	component.setExecutionMode(core::ExecutionMode::MAILBOX);
+
+	Gate gate;
+	core::TopicId topic = component.subscribe("ComponentTest.timer.block", std::ref(gate));
+
+	component.post(topic, core::MessageData());
+	ASSERT_TRUE(waitFor([&gate] { return gate.entered.load() == 1; }));
+
+	std::atomic<bool> expired(false);
+	component.setOneShotTimer([&expired](const boost::system::error_code &e) { expired = true; }, 1ms);
+
+	// Expired meanwhile, but queued behind the running handler
+	std::this_thread::sleep_for(20ms);
+	EXPECT_FALSE(expired);
+
+	gate.release();
+	EXPECT_TRUE(waitFor([&expired] { return expired.load(); }));
+}
+
+TEST(ComponentTest, ConflatingTopicDeliversTheNewestValue)
+{
+	TestComponent component;
+	const core::MessageId name = "ComponentTest.conflate.direct";
+	core::Component::setConflating(name);
+
+	Gate gate;
+	std::mutex mutex;
+	std::vector<int> values;
+	core::TopicId topic = component.subscribe(name,
+		[&](const core::MessageData &message)
+		{
+			{
+				std::scoped_lock lock(mutex);
+				values.push_back(message.get<int>("value"));
+			}
+
+			gate(message);
+		});
+
+	// The first handler keeps the subscriber busy on the posting thread
+	std::thread first([&component, topic] { component.post(topic, core::MessageData("value", 0)); });
+	ASSERT_TRUE(waitFor([&gate] { return gate.entered.load() == 1; }));
+
+	for (int value = 1; value <= 3; ++value)
+	{
+		component.post(topic, core::MessageData("value", value));
+	}
+
+	gate.release();
+	first.join();
+
+	EXPECT_EQ(std::vector<int>({0, 3}), values);
+	EXPECT_EQ(2u, core::Component::getDroppedCount(topic));
+	EXPECT_NE(std::string::npos, core::Component::getTopicStatistics().find(name + ": dropped 2"));
+}
+
+TEST(ComponentTest, ConflatingTopicInMailboxMode)
+{
+	TestComponent component;
+	component.setExecutionMode(core::ExecutionMode::MAILBOX);
+	const core::MessageId name = "ComponentTest.conflate.mailbox";
+	core::Component::setConflating(name);
+
+	Gate gate;
+	std::vector<int> values;
+	std::atomic<int> handled(0);
+	core::TopicId topic = component.subscribe(name,
+		[&](const core::MessageData &message)
+		{
+			values.push_back(message.get<int>("value"));
+			gate(message);
+			handled.fetch_add(1);
+		});
+
+	component.post(topic, core::MessageData("value", 0));
+	ASSERT_TRUE(waitFor([&gate] { return gate.entered.load() == 1; }));
+
+	for (int value = 1; value <= 5; ++value)
+	{
+		component.post(topic, core::MessageData("value", value));
+	}
+
+	gate.release();
+
+	ASSERT_TRUE(waitFor([&handled] { return handled.load() == 2; }));
+	std::this_thread::sleep_for(10ms);
+	EXPECT_EQ(std::vector<int>({0, 5}), values);
+	EXPECT_EQ(4u, core::Component::getDroppedCount(topic));
+	EXPECT_EQ(0u, component.m_mailbox->getDropped());
+}
+
+TEST(ComponentTest, ConflatingSlotReleasedWhenTheMailboxIsFull)
+{
+	TestComponent component;
+	component.setExecutionMode(core::ExecutionMode::MAILBOX, 2);
+	const core::MessageId name = "ComponentTest.conflate.full";
+	core::Component::setConflating(name);
+
+	Gate gate;
+	std::atomic<int> blocked(0);
+	core::TopicId block = component.subscribe("ComponentTest.conflate.full.block",
+		[&gate, &blocked](const core::MessageData &message)
+		{
+			gate(message);
+			blocked.fetch_add(1);
+		});
+
+	std::vector<int> values;
+	std::atomic<int> handled(0);
+	core::TopicId topic = component.subscribe(name,
+		[&values, &handled](const core::MessageData &message)
+		{
+			values.push_back(message.get<int>("value"));
+			handled.fetch_add(1);
+		});
+
+	// The mailbox is full, the drain of the conflating topic cannot be queued
+	component.post(block, core::MessageData());
+	ASSERT_TRUE(waitFor([&gate] { return gate.entered.load() == 1; }));
+	component.post(block, core::MessageData());
+	component.post(block, core::MessageData());
+	component.post(topic, core::MessageData("value", 1));
+	EXPECT_EQ(1u, component.m_mailbox->getDropped());
+
+	gate.release();
+	ASSERT_TRUE(waitFor([&blocked] { return blocked.load() == 3; }));
+
+	// The slot is idle again, the next message replaces the stranded one and is delivered
+	component.post(topic, core::MessageData("value", 2));
+
+	ASSERT_TRUE(waitFor([&handled] { return handled.load() == 1; }));
+	std::this_thread::sleep_for(10ms);
+	EXPECT_EQ(std::vector<int>({2}), values);
+	EXPECT_EQ(1u, core::Component::getDroppedCount(topic));
+}
+
+TEST(ComponentTest, TopicIdsAreResolvedOnce)
+{
+	TestComponent publisher;
+	TestComponent subscriber;
+	const core::MessageId name = "ComponentTest.topic.ids";
+
+	core::TopicId advertised = publisher.advertise(name);
+	core::TopicId subscribed = subscriber.subscribe(name, [](const core::MessageData &message) {});
+
+	EXPECT_EQ(advertised, subscribed);
+	EXPECT_EQ(advertised, publisher.advertise(name));
+	EXPECT_EQ(name, core::Component::getTopicName(advertised));
+	EXPECT_NE(advertised, publisher.advertise(name + ".other"));
+}
+
+TEST(ComponentTest, PostingByIdOrNameReachesTheSameSubscribers)
+{
+	TestComponent publisher;
+	TestComponent first;
+	TestComponent second;
+	const core::MessageId name = "ComponentTest.topic.post";
+
+	std::vector<int> received;
+	first.subscribe(name, [&received](const core::MessageData &message) { received.push_back(message.get<int>("value")); });
+	second.subscribe(name, [&received](const core::MessageData &message) { received.push_back(-message.get<int>("value")); });
+	core::TopicId topic = publisher.advertise(name);
+
+	publisher.post(topic, core::MessageData("value", 1));
+	publisher.post(name, core::MessageData("value", 2));
+
+	EXPECT_EQ(std::vector<int>({1, -1, 2, -2}), received);
+
+	// Names nobody advertised or subscribed are ignored
+	publisher.post(name + ".unknown", core::MessageData("value", 3));
+	EXPECT_EQ(4u, received.size());
+}
+
+namespace
+{
+	/** Periodic timer whose first expiration overruns by the given time */
+	struct LateTimer
+	{
+		LateTimer(TestComponent &component, std::chrono::milliseconds period, std::chrono::milliseconds overrun, core::CatchUpPolicy policy) :
+			component(component),
+			start(std::chrono::steady_clock::now())
+		{
+			timer = component.setPeriodicTimer(
+				[this, overrun](const boost::system::error_code &e)
+				{
+					std::scoped_lock lock(mutex);
+					expirations.push_back(std::chrono::steady_clock::now() - start);
+
+					if (expirations.size() == 1)
+					{
+						std::this_thread::sleep_for(overrun);
+					}
+				},
+				period,
+				policy);
+		}
+
+		~LateTimer()
+		{
+			component.cancelTimer(timer);
+			std::this_thread::sleep_for(10ms);
+		}
+
+		size_t count()
+		{
+			std::scoped_lock lock(mutex);
+			return expirations.size();
+		}
+
+		TestComponent &component;
+		std::chrono::steady_clock::time_point start;
+		core::TimerId timer;
+		std::mutex mutex;
+		std::vector<std::chrono::steady_clock::duration> expirations; ///< Since start
+	};
+}
+
+TEST(ComponentTest, SkipResumesInPhase)
+{
+	TestComponent component;
+	LateTimer late(component, 40ms, 100ms, core::CatchUpPolicy::SKIP);
+
+	ASSERT_TRUE(waitFor([&late] { return late.count() >= 2; }));
+
+	core::TimerStatistics statistics;
+	ASSERT_TRUE(component.getTimerStatistics(late.timer, statistics));
+
+	std::scoped_lock lock(late.mutex);
+
+	// Deadlines at 40, 80, 120, 160ms: the overrun skips 80 and 120 and
+	// resumes at 160, not one period after the handler returned (180)
+	EXPECT_GE(late.expirations[1], 160ms);
+	EXPECT_LT(late.expirations[1], 175ms);
+	EXPECT_EQ(2u, statistics.missedDeadlines);
+}
+
+TEST(ComponentTest, BurstServesTheMissedPeriods)
+{
+	TestComponent component;
+	LateTimer late(component, 40ms, 130ms, core::CatchUpPolicy::BURST);
+
+	ASSERT_TRUE(waitFor([&late] { return late.count() >= 5; }));
+
+	core::TimerStatistics statistics;
+	ASSERT_TRUE(component.getTimerStatistics(late.timer, statistics));
+
+	std::scoped_lock lock(late.mutex);
+
+	// Deadlines at 80, 120 and 160ms are served back to back once the first
+	// handler returns around 170ms, then the schedule is back on time at 200ms
+	EXPECT_GE(late.expirations[1], 170ms);
+	EXPECT_LT(late.expirations[3] - late.expirations[1], 15ms);
+	EXPECT_GE(late.expirations[4], 200ms);
+	EXPECT_LT(late.expirations[4], 215ms);
+	EXPECT_EQ(2u, statistics.missedDeadlines);
+}
@@ -0,0 +1,141 @@
+/**
+ * @file MailboxTest.cpp
+ *
+ * @author Nicolae Natea
+ * Contact: nicu@natea.ro
+ */
+
+#include <chrono>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include <core/Mailbox.hpp>
+
+using namespace std::chrono_literals;
+
+TEST(MailboxTest, RunsHandlersInOrder)
+{
+	boost::asio::io_context context;
+	std::shared_ptr<core::Mailbox> mailbox = std::make_shared<core::Mailbox>(context, 8);
+	std::vector<int> executed;
+
+	for (int i = 0; i < 5; ++i)
+	{
+		EXPECT_TRUE(mailbox->post([&executed, i] { executed.push_back(i); }));
+	}
+
+	EXPECT_TRUE(executed.empty());
+	context.run();
+
+	EXPECT_EQ(std::vector<int>({0, 1, 2, 3, 4}), executed);
+	EXPECT_EQ(0u, mailbox->getDropped());
+}
+
+TEST(MailboxTest, DropsWhenFull)
+{
+	boost::asio::io_context context;
+	std::shared_ptr<core::Mailbox> mailbox = std::make_shared<core::Mailbox>(context, 2);
+	int executed = 0;
+
+	EXPECT_TRUE(mailbox->post([&executed] { ++executed; }));
+	EXPECT_TRUE(mailbox->post([&executed] { ++executed; }));
+	EXPECT_FALSE(mailbox->post([&executed] { ++executed; }));
+	EXPECT_EQ(1u, mailbox->getDropped());
+
+	context.run();
+	EXPECT_EQ(2, executed);
+
+	// Room again once drained
+	EXPECT_TRUE(mailbox->post([&executed] { ++executed; }));
+	context.restart();
+	context.run();
+	EXPECT_EQ(3, executed);
+	EXPECT_EQ(1u, mailbox->getDropped());
+}
+
+TEST(MailboxTest, TimeoutsIgnoreTheCapacity)
+{
+	boost::asio::io_context context;
+	std::shared_ptr<core::Mailbox> mailbox = std::make_shared<core::Mailbox>(context, 2);
+	std::vector<int> executed;
+
+	EXPECT_TRUE(mailbox->post([&executed] { executed.push_back(0); }));
+	EXPECT_TRUE(mailbox->post([&executed] { executed.push_back(1); }));
+
+	for (int i = 10; i < 13; ++i)
+	{
+		mailbox->postTimeout([&executed, i] { executed.push_back(i); });
+	}
+
+	context.run();
+
+	// Timer completions are served first
+	EXPECT_EQ(std::vector<int>({10, 11, 12, 0, 1}), executed);
+	EXPECT_EQ(0u, mailbox->getDropped());
+}
+
+TEST(MailboxTest, WaitsForRoom)
+{
+	boost::asio::io_context context;
+	std::shared_ptr<core::Mailbox> mailbox = std::make_shared<core::Mailbox>(context, 2, 2000ms);
+	int executed = 0;
+
+	EXPECT_TRUE(mailbox->post([&executed] { ++executed; }));
+	EXPECT_TRUE(mailbox->post([&executed] { ++executed; }));
+
+	std::thread drainer([&context]
+		{
+			std::this_thread::sleep_for(20ms);
+			context.run();
+		});
+
+	EXPECT_TRUE(mailbox->post([&executed] { ++executed; }));
+	drainer.join();
+
+	context.restart();
+	context.run();
+	EXPECT_EQ(3, executed);
+	EXPECT_EQ(0u, mailbox->getDropped());
+}
+
+TEST(MailboxTest, GivesUpAfterMaxWait)
+{
+	boost::asio::io_context context;
+	std::shared_ptr<core::Mailbox> mailbox = std::make_shared<core::Mailbox>(context, 2, 20ms);
+
+	EXPECT_TRUE(mailbox->post([] {}));
+	EXPECT_TRUE(mailbox->post([] {}));
+
+	auto start = std::chrono::steady_clock::now();
+	EXPECT_FALSE(mailbox->post([] {}));
+	EXPECT_GE(std::chrono::steady_clock::now() - start, 20ms);
+	EXPECT_EQ(1u, mailbox->getDropped());
+}
+
+TEST(MailboxTest, SchedulerThreadsDoNotWait)
+{
+	boost::asio::io_context context;
+	std::shared_ptr<core::Mailbox> mailbox = std::make_shared<core::Mailbox>(context, 2, 2000ms);
+	bool queued = true;
+	std::chrono::steady_clock::duration elapsed;
+
+	// Runs on the context: waiting there could block the drain it waits for
+	boost::asio::post(context, [&]
+		{
+			mailbox->post([] {});
+			mailbox->post([] {});
+
+			auto start = std::chrono::steady_clock::now();
+			queued = mailbox->post([] {});
+			elapsed = std::chrono::steady_clock::now() - start;
+		});
+
+	context.run();
+
+	EXPECT_FALSE(queued);
+	EXPECT_LT(elapsed, 1000ms);
+	EXPECT_EQ(1u, mailbox->getDropped());
+}
@@ -0,0 +1,66 @@
+/**
+ * @file TimerStatisticsTest.cpp
+ *
+ * @author Nicolae Natea
+ * Contact: nicu@natea.ro
+ */
+
+#include <chrono>
+
+#include <gtest/gtest.h>
+
+#include <core/TimerStatistics.hpp>
+
+using namespace std::chrono_literals;
+
+TEST(TimerStatisticsTest, LatenessBuckets)
+{
+	core::TimerStatistics statistics;
+
+	statistics.addExpiration(500ns);
+	statistics.addExpiration(1us);
+	statistics.addExpiration(3us);
+	statistics.addExpiration(1000us);
+
+	EXPECT_EQ(4u, statistics.expirations);
+	EXPECT_EQ(1u, statistics.jitterHistogram[0]);
+	EXPECT_EQ(1u, statistics.jitterHistogram[1]);
+	EXPECT_EQ(1u, statistics.jitterHistogram[2]);
+	EXPECT_EQ(1u, statistics.jitterHistogram[10]);
+	EXPECT_EQ(1000us, statistics.maxLateness);
+}
+
+TEST(TimerStatisticsTest, LongDelaysShareTheLastBucket)
+{
+	core::TimerStatistics statistics;
+
+	statistics.addExpiration(std::chrono::microseconds(1u << (core::TimerStatistics::JITTER_BUCKETS - 2)));
+	statistics.addExpiration(10s);
+
+	EXPECT_EQ(2u, statistics.jitterHistogram[core::TimerStatistics::JITTER_BUCKETS - 1]);
+	EXPECT_EQ(10s, statistics.maxLateness);
+}
+
+TEST(TimerStatisticsTest, EarlyExpirationIsOnTime)
+{
+	core::TimerStatistics statistics;
+
+	statistics.addExpiration(-5ms);
+
+	EXPECT_EQ(1u, statistics.expirations);
+	EXPECT_EQ(1u, statistics.jitterHistogram[0]);
+	EXPECT_EQ(0u, statistics.jitterHistogram[core::TimerStatistics::JITTER_BUCKETS - 1]);
+	EXPECT_EQ(0ns, statistics.maxLateness);
+}
+
+TEST(TimerStatisticsTest, Summary)
+{
+	core::TimerStatistics statistics;
+
+	statistics.addExpiration(3us);
+	statistics.missedDeadlines = 2;
+
+	std::string summary = statistics.toString();
+	EXPECT_NE(std::string::npos, summary.find("expirations: 1, missed: 2, max lateness: 3us"));
+	EXPECT_NE(std::string::npos, summary.find("]: 0 0 1 0"));
+}
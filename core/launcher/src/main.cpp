@@ -26,6 +26,7 @@
 #include <core/logger/event_logger.h>
 #include <core/util/TimeTracker.hpp>
 #include <core/Component.hpp>
+#include <core/Scheduler.hpp>
 
 namespace {
     const char * APP_NAME = "Breadcrumbs";
@@ -101,6 +102,18 @@ int main(int argc, char* arcv[])
     // Initialise the logger
     logger_init(configFile.c_str());
 
+    // Start the threads shared by all component timers
+    core::Scheduler::getInstance().start(
+        root.get<uint32_t>("scheduler.threads", core::DEFAULT_SCHEDULER_THREADS));
+
+    // Latest-value topics must be known before components subscribe
+    const boost::property_tree::ptree noTopics;
+    for (const boost::property_tree::ptree::value_type&
+        topic : root.get_child("topics.conflate", noTopics))
+    {
+        core::Component::setConflating(topic.second.get_value<std::string>());
+    }
+
     // Clone all components and initialize them
     for (const boost::property_tree::ptree::value_type&
         component : root.get_child("components"))
@@ -124,12 +137,20 @@ int main(int argc, char* arcv[])
     for (core::Component* component : componentList)
     {
         component->stop();
+    }
+
+    // Stop the shared threads so that no queued handler runs on a deleted component
+    core::Scheduler::getInstance().stop();
+
+    for (core::Component* component : componentList)
+    {
         delete component;
     }
 
     componentList.clear();
 
     LOG_INFO(APP_NAME, "Timing statistics:\n%s",  core::util::getTimingStatistics().c_str());
+    LOG_INFO(APP_NAME, "Topic statistics:\n%s",  core::Component::getTopicStatistics().c_str());
 
     // Uninitialise the logger
     logger_deinit();
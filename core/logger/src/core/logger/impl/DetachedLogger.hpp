@@ -10,12 +10,11 @@
 #ifndef _CORE_LOGGER_IMPL_DETACHED_LOGGER_HPP_
 #define _CORE_LOGGER_IMPL_DETACHED_LOGGER_HPP_
 
-#include <condition_variable>
-#include <mutex>
-#include <queue>
+#include <atomic>
 #include <thread>
 
 #include <core/logger/Logger.hpp>
+#include <core/util/MpscQueue.hpp>
 
 namespace util
 {
@@ -37,20 +36,14 @@ namespace util
                 // Encapsulated data
             private:
 
-                /** Mutex */
-                std::mutex m_consumer_mutex;
-
                 /** Thread */
                 std::thread m_thread;
 
-                /** Condition variable */
-                std::condition_variable m_cond_variable;
-
                 /** Stop flag */
-                bool m_stop;
+                std::atomic<bool> m_stop;
 
-                /** Message queue */
-                std::queue<LogEntryCPtr> m_msg_queue;
+                /** Message queue, filled by any thread and drained by m_thread */
+                core::util::MpscQueue<LogEntryCPtr> m_msg_queue;
         };
     }
 }
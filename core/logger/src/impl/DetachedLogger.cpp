@@ -6,6 +6,7 @@
  */
 
 #include <iostream>
+#include <vector>
 
 #include <boost/format.hpp>
 
@@ -18,54 +19,63 @@ namespace util
 {
     namespace logger
     {
+        namespace
+        {
+            const size_t QUEUE_SIZE = 4096;
+            const size_t BATCH_SIZE = 64;
+            const std::chrono::milliseconds IDLE_TIMEOUT(100);
+        }
+
         void DetachedLogger::log_event(const LogEntryCPtr& entry)
         {
-            if (not m_stop)
+            // Never block on the consumer, only retry while the ring is full
+            while (not m_stop and not m_msg_queue.push(entry))
             {
-                std::unique_lock lock(m_consumer_mutex);
-                m_msg_queue.push(entry);
-                m_cond_variable.notify_one();
+                std::this_thread::yield();
             }
         }
 
         void DetachedLogger::handler()
         {
-            while(not m_stop)
+            std::vector<LogEntryCPtr> entries;
+            entries.reserve(BATCH_SIZE);
+
+            for (;;)
             {
-                std::unique_lock lock(m_consumer_mutex);
+                entries.clear();
 
-                while(m_msg_queue.empty())
+                if (m_msg_queue.popBatch(std::back_inserter(entries), BATCH_SIZE) == 0)
                 {
-                    m_cond_variable.wait(lock);
-                    if (m_msg_queue.empty() and m_stop)
+                    if (m_stop)
                     {
                         std::cout << "handler exited\n";
                         return;
                     }
-                }
 
-                const LogEntryCPtr entry = m_msg_queue.front();
+                    m_msg_queue.wait(IDLE_TIMEOUT);
+                    continue;
+                }
 
-                // Formatted output
-                boost::format logMsg("Detached: [%s][%s] %s: %s (%s:%u)\n");
-                logMsg % core::util::time::to_string(entry->get_timestamp())
-                       % logger_level_map(entry->get_level())
-                       % entry->get_domain()
-                       % entry->get_message()
-                       % entry->get_filename()
-                       % entry->get_line();
+                for (const LogEntryCPtr &entry : entries)
+                {
+                    // Formatted output
+                    boost::format logMsg("Detached: [%s][%s] %s: %s (%s:%u)\n");
+                    logMsg % core::util::time::to_string(entry->get_timestamp())
+                           % logger_level_map(entry->get_level())
+                           % entry->get_domain()
+                           % entry->get_message()
+                           % entry->get_filename()
+                           % entry->get_line();
 
-                std::cout << logMsg.str();
-          
-                m_msg_queue.pop();
+                    std::cout << logMsg.str();
+                }
             }
         }
 
-        DetachedLogger::DetachedLogger()
+        DetachedLogger::DetachedLogger() :
+            m_stop(false),
+            m_msg_queue(QUEUE_SIZE)
         {
-            std::scoped_lock lock(this->m_consumer_mutex);
-
-            m_stop = false;
             m_thread = std::thread(&DetachedLogger::handler, this);
         }
 
@@ -76,7 +86,7 @@ namespace util
                 m_stop = true;
 
                 // Wake up the thread
-                m_cond_variable.notify_one();
+                m_msg_queue.wakeup();
 
                 // Join the thread
                 if (this->m_thread.joinable()) {
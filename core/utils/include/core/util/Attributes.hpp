@@ -2,6 +2,11 @@
  * @file Attributes.hpp
  *
  * @brief Generic container class for storing various types.
+ *        Entries are kept in a flat array with inline room for a few
+ *        of them and iterated in the order their keys were first set.
+ *        Keys short enough for the string small buffer and values up to
+ *        32 bytes are stored in place, so small messages are built
+ *        without heap allocations.
  *
  * @author Nicolae Natea
  * Contact: nicu@natea.ro
@@ -11,20 +16,292 @@
 #define _CORE_UTIL_ATTRIBUTES_H_
 
 #include <any>
-#include <map>
+#include <cstddef>
+#include <cstring>
+#include <new>
 #include <optional>
 #include <stdexcept>
 #include <string>
+#include <type_traits>
+#include <typeinfo>
+#include <utility>
+
+#include <boost/container/small_vector.hpp>
 
 namespace core
-{   
+{
     namespace util
     {
+        /** Type erased value with inline storage for small types. */
+        class AttributeValue
+        {
+        private:
+            static const size_t INLINE_SIZE = 32;
+
+            enum struct Operation
+            {
+                COPY,   ///< Copy construct the destination from the source
+                MOVE,   ///< Move construct the destination from the source
+                DESTROY ///< Destroy the source
+            };
+
+            typedef void (*Manager)(Operation operation, AttributeValue *source, AttributeValue *destination);
+
+            template<typename T>
+            struct Storage
+            {
+                static const bool IS_INLINE =
+                    (sizeof(T) <= INLINE_SIZE) and
+                    (alignof(T) <= alignof(std::max_align_t)) and
+                    std::is_nothrow_move_constructible<T>::value;
+
+                static const bool IS_TRIVIAL = IS_INLINE and std::is_trivially_copyable<T>::value;
+            };
+
+            alignas(std::max_align_t) unsigned char m_buffer[INLINE_SIZE]; ///< Value or pointer to it
+            const std::type_info *m_type; ///< Type of the value, null if empty
+            Manager m_manager;            ///< Copy/move/destroy, null for trivially copyable values
+
+            // Construction
+        public:
+            AttributeValue() : m_type(nullptr), m_manager(nullptr)
+            {
+            }
+
+            template<typename T, typename = std::enable_if_t<not std::is_same<std::decay_t<T>, AttributeValue>::value>>
+            AttributeValue(T &&value) : m_type(nullptr), m_manager(nullptr)
+            {
+                emplace<std::decay_t<T>>(std::forward<T>(value));
+            }
+
+            AttributeValue(const AttributeValue &other) : m_type(nullptr), m_manager(nullptr)
+            {
+                copyFrom(other);
+            }
+
+            AttributeValue(AttributeValue &&other) noexcept : m_type(nullptr), m_manager(nullptr)
+            {
+                moveFrom(other);
+            }
+
+            ~AttributeValue()
+            {
+                reset();
+            }
+
+            AttributeValue &operator=(const AttributeValue &other)
+            {
+                if (this != &other)
+                {
+                    reset();
+                    copyFrom(other);
+                }
+
+                return *this;
+            }
+
+            AttributeValue &operator=(AttributeValue &&other) noexcept
+            {
+                if (this != &other)
+                {
+                    reset();
+                    moveFrom(other);
+                }
+
+                return *this;
+            }
+
+            // Methods
+        public:
+            /** @return true if a value is stored */
+            bool has_value() const noexcept
+            {
+                return m_type != nullptr;
+            }
+
+            /** @return type of the stored value */
+            const std::type_info &type() const noexcept
+            {
+                return has_value() ? *m_type : typeid(void);
+            }
+
+            /** @return pointer to the value if it is of type T, nullptr otherwise */
+            template<typename T>
+            const T *get_if() const noexcept
+            {
+                if ((m_type == nullptr) or (*m_type != typeid(T)))
+                {
+                    return nullptr;
+                }
+
+                return Storage<T>::IS_INLINE ?
+                    reinterpret_cast<const T *>(m_buffer) :
+                    *reinterpret_cast<T * const *>(m_buffer);
+            }
+
+            /**
+             * @return the stored value
+             * @throws bad_any_cast if the value is of a different type
+             */
+            template<typename T>
+            const T &get() const
+            {
+                const T *value = get_if<T>();
+
+                if (value == nullptr)
+                {
+                    throw std::bad_any_cast();
+                }
+
+                return *value;
+            }
+
+            /** Stores a new value */
+            template<typename T, typename... Args>
+            void emplace(Args &&...args)
+            {
+                reset();
+
+                if constexpr (Storage<T>::IS_INLINE)
+                {
+                    new (m_buffer) T(std::forward<Args>(args)...);
+                }
+                else
+                {
+                    *reinterpret_cast<T **>(m_buffer) = new T(std::forward<Args>(args)...);
+                }
+
+                m_type = &typeid(T);
+                m_manager = Storage<T>::IS_TRIVIAL ? nullptr : &manage<T>;
+            }
+
+            /** Destroys the stored value */
+            void reset() noexcept
+            {
+                if (m_manager != nullptr)
+                {
+                    m_manager(Operation::DESTROY, this, nullptr);
+                }
+
+                m_type = nullptr;
+                m_manager = nullptr;
+            }
+
+        private:
+            void copyFrom(const AttributeValue &other)
+            {
+                if (other.m_manager != nullptr)
+                {
+                    other.m_manager(Operation::COPY, const_cast<AttributeValue *>(&other), this);
+                }
+                else
+                {
+                    std::memcpy(m_buffer, other.m_buffer, INLINE_SIZE);
+                }
+
+                m_type = other.m_type;
+                m_manager = other.m_manager;
+            }
+
+            void moveFrom(AttributeValue &other) noexcept
+            {
+                if (other.m_manager != nullptr)
+                {
+                    other.m_manager(Operation::MOVE, &other, this);
+                }
+                else
+                {
+                    std::memcpy(m_buffer, other.m_buffer, INLINE_SIZE);
+                }
+
+                m_type = other.m_type;
+                m_manager = other.m_manager;
+                other.m_type = nullptr;
+                other.m_manager = nullptr;
+            }
+
+            template<typename T>
+            static void manage(Operation operation, AttributeValue *source, AttributeValue *destination)
+            {
+                if constexpr (Storage<T>::IS_INLINE)
+                {
+                    T *value = reinterpret_cast<T *>(source->m_buffer);
+
+                    switch (operation)
+                    {
+                        case Operation::COPY:
+                            new (destination->m_buffer) T(*value);
+                            break;
+                        case Operation::MOVE:
+                            new (destination->m_buffer) T(std::move(*value));
+                            value->~T();
+                            break;
+                        case Operation::DESTROY:
+                            value->~T();
+                            break;
+                    }
+                }
+                else
+                {
+                    T *&value = *reinterpret_cast<T **>(source->m_buffer);
+
+                    switch (operation)
+                    {
+                        case Operation::COPY:
+                            *reinterpret_cast<T **>(destination->m_buffer) = new T(*value);
+                            break;
+                        case Operation::MOVE:
+                            *reinterpret_cast<T **>(destination->m_buffer) = value;
+                            value = nullptr;
+                            break;
+                        case Operation::DESTROY:
+                            delete value;
+                            break;
+                    }
+                }
+            }
+        };
+
         /** Generic container class. */
         class Attributes
         {
+        public:
+            /** Key/value pair */
+            class Entry
+            {
+            public:
+                Entry(const std::string &key, AttributeValue &&value) :
+                    m_key(key),
+                    m_value(std::move(value))
+                {
+                }
+
+                /** @return key of the entry */
+                const std::string &key() const
+                {
+                    return m_key;
+                }
+
+                /** @return value of the entry */
+                const AttributeValue &value() const
+                {
+                    return m_value;
+                }
+
+            private:
+                friend class Attributes;
+
+                std::string m_key;      ///< Key
+                AttributeValue m_value; ///< Value
+            };
+
+            /** Number of entries stored without heap allocation */
+            static const size_t INLINE_ENTRIES = 4;
+
+            typedef boost::container::small_vector<Entry, INLINE_ENTRIES> EntryList;
+
         private:
-            std::map<const std::string, std::any> m_attributes; ///< Attributes
+            EntryList m_attributes; ///< Attributes
 
             // Construction
         public:
@@ -55,20 +332,27 @@ namespace core
             /**
              * @param[in] key to retrieve
              * @return value associated with the key, if it exists
-             * 
+             *
              * @throws out_of_range | bad_any_cast exception if the key does not
              *            exist or is of a different type
              */
             template<typename T>
             T get(const std::string &key) const
             {
-                return std::any_cast<T>(m_attributes.at(key));
+                const Entry *entry = find(key);
+
+                if (entry == nullptr)
+                {
+                    throw std::out_of_range(key);
+                }
+
+                return entry->m_value.get<T>();
             }
 
             /**
              * @param[in] key to retrieve
              * @param[out] value associated with the key, if it exists
-             * 
+             *
              * @throws out_of_range | bad_any_cast exception if the key does not
              *            exist or is of a different type
              */
@@ -86,47 +370,68 @@ namespace core
             template<typename T>
             bool get_optional(const std::string &key, std::optional<T> &value) const
             {
-                try
-                {
-                    value = std::optional<T>(std::any_cast<T>(m_attributes.at(key)));
-                }
-                catch (const std::out_of_range &e)
+                const Entry *entry = find(key);
+                const T *stored = (entry == nullptr) ? nullptr : entry->m_value.get_if<T>();
+
+                if (stored == nullptr)
                 {
                     value = std::nullopt;
                     return false;
                 }
-                catch (const std::bad_any_cast &e) {
-                    value = std::nullopt;
-                    return false;
-                }
- 
+
+                value = *stored;
                 return true;
             }
-            
+
             /**
              * @param[in] key to store
              * @param[out] value to associate with the given key
              * @return refrence to the updated object
              */
             template<typename T>
-            Attributes set(const std::string &key, const T &value)
+            Attributes &set(const std::string &key, const T &value)
             {
-                m_attributes[key] = std::any(value);
+                Entry *entry = const_cast<Entry *>(find(key));
+
+                if (entry != nullptr)
+                {
+                    entry->m_value.emplace<std::decay_t<T>>(value);
+                }
+                else
+                {
+                    m_attributes.emplace_back(key, AttributeValue(value));
+                }
+
                 return *this;
             }
 
-            /** @return iterator pointing to the first element in the sequence */
-            std::map<const std::string, std::any>::const_iterator begin() const noexcept;
-            std::map<const std::string, std::any>::const_iterator cbegin() const noexcept;
+            /** @return iterator pointing to the first element, in insertion order */
+            EntryList::const_iterator begin() const noexcept;
+            EntryList::const_iterator cbegin() const noexcept;
 
             /** @return iterator pointing to the past-the-end element in the sequence */
-            std::map<const std::string, std::any>::const_iterator end() const noexcept;
-            std::map<const std::string, std::any>::const_iterator cend() const noexcept;
+            EntryList::const_iterator end() const noexcept;
+            EntryList::const_iterator cend() const noexcept;
 
             /** @return number of attributes */
-            size_t count();
+            size_t count() const;
+
+        private:
+            /** @return entry with the given key, nullptr if missing */
+            const Entry *find(const std::string &key) const
+            {
+                for (const Entry &entry : m_attributes)
+                {
+                    if (entry.m_key == key)
+                    {
+                        return &entry;
+                    }
+                }
+
+                return nullptr;
+            }
         };
     }
 }
 
-#endif /* _CORE_UTIL_ATTRIBUTES_H_ */
\ No newline at end of file
+#endif /* _CORE_UTIL_ATTRIBUTES_H_ */
@@ -0,0 +1,45 @@
+/**
+ * @file Futex.hpp
+ *
+ * @brief Thin wrappers over the linux futex system call, used to
+ *        block a thread on a 32 bit atomic without a mutex.
+ *
+ * @author Nicolae Natea
+ * Contact: nicu@natea.ro
+ */
+
+#ifndef _CORE_UTIL_FUTEX_H_
+#define _CORE_UTIL_FUTEX_H_
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+namespace core
+{
+    namespace util
+    {
+        namespace futex
+        {
+            /**
+             * Blocks while the value of the word equals the expected value.
+             * May return spuriously.
+             *
+             *  @param[in] word futex word
+             *  @param[in] expected value for which the thread should sleep
+             *  @param[in] timeout maximum time to sleep
+             */
+            void wait(std::atomic<uint32_t> &word, uint32_t expected, const std::chrono::nanoseconds &timeout);
+
+            /**
+             * Wakes up threads blocked on the word
+             *
+             *  @param[in] word futex word
+             *  @param[in] count maximum number of threads to wake up
+             */
+            void wake(std::atomic<uint32_t> &word, uint32_t count = 1);
+        }
+    }
+}
+
+#endif /* _CORE_UTIL_FUTEX_H_ */
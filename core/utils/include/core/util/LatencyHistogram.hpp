@@ -0,0 +1,77 @@
+/**
+ * @file LatencyHistogram.hpp
+ *
+ * @brief Fixed size histogram of durations for percentile reporting.
+ *        Buckets grow with the value, each power of two being split in
+ *        2^(PRECISION_BITS - 1) linear buckets, so any recorded value is
+ *        reported within ~3% whatever its magnitude. Recording is a few
+ *        shifts and an increment; histograms of several threads are
+ *        merged for the report.
+ *
+ * @author Nicolae Natea
+ * Contact: nicu@natea.ro
+ */
+
+#ifndef _CORE_UTIL_LATENCY_HISTOGRAM_H_
+#define _CORE_UTIL_LATENCY_HISTOGRAM_H_
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace core
+{
+    namespace util
+    {
+        class LatencyHistogram
+        {
+        public:
+            /** Values below 2^PRECISION_BITS ns are exact, larger ones within 1/2^(PRECISION_BITS - 1) */
+            static const uint32_t PRECISION_BITS = 6;
+
+            /** Largest value told apart, about 18 minutes; longer ones are counted there */
+            static const uint32_t MAX_VALUE_BITS = 40;
+
+            LatencyHistogram();
+
+            /** Records one duration, negative ones as 0 */
+            void add(const std::chrono::nanoseconds &value);
+
+            /** Adds the values recorded by another histogram */
+            void merge(const LatencyHistogram &other);
+
+            /** Forgets all values */
+            void clear();
+
+            /** @return number of recorded values */
+            uint64_t getCount() const;
+
+            std::chrono::nanoseconds getMin() const;
+            std::chrono::nanoseconds getMax() const;
+            std::chrono::nanoseconds getMean() const;
+
+            /**
+             * @param[in] percentile in [0, 100], ex. 99.9
+             * @return value below or equal to which the given share of values
+             *         lies, rounded up to its bucket; 0 when empty
+             */
+            std::chrono::nanoseconds getPercentile(double percentile) const;
+
+            /** @return human readable summary in microseconds, with p50, p99 and p99.9 */
+            std::string toString() const;
+
+        private:
+            static uint32_t getBucket(uint64_t value);
+            static uint64_t getBucketEnd(uint32_t bucket);
+
+            std::vector<uint64_t> m_buckets;
+            uint64_t m_count;
+            uint64_t m_sum; ///< Sum of the values in ns, for the mean
+            uint64_t m_min;
+            uint64_t m_max;
+        };
+    }
+}
+
+#endif /* _CORE_UTIL_LATENCY_HISTOGRAM_H_ */
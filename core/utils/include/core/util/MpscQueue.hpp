@@ -0,0 +1,234 @@
+/**
+ * @file MpscQueue.hpp
+ *
+ * @brief Bounded lock-free multi-producer/single-consumer ring.
+ *        Producers claim a slot with a single CAS and publish it through
+ *        a per slot sequence number; the consumer never writes shared
+ *        indexes. An optional futex based wait lets the consumer sleep
+ *        while the ring is empty; producers only enter the kernel when
+ *        the consumer is actually asleep.
+ *
+ * @author Nicolae Natea
+ * Contact: nicu@natea.ro
+ */
+
+#ifndef _CORE_UTIL_MPSC_QUEUE_H_
+#define _CORE_UTIL_MPSC_QUEUE_H_
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+
+#include <core/util/Futex.hpp>
+
+namespace core
+{
+    namespace util
+    {
+        /** Bounded multi-producer/single-consumer queue. */
+        template<typename T>
+        class MpscQueue
+        {
+        private:
+            static const size_t CACHE_LINE_SIZE = 64;
+
+            struct Slot
+            {
+                std::atomic<size_t> sequence; ///< Position the slot is ready for
+                T value;                      ///< Stored element
+            };
+
+            std::unique_ptr<Slot[]> m_slots;                    ///< Ring storage
+            size_t m_mask;                                      ///< Capacity - 1
+            alignas(CACHE_LINE_SIZE) std::atomic<size_t> m_tail; ///< Next position to be claimed by producers
+            alignas(CACHE_LINE_SIZE) size_t m_head;             ///< Next position to be read, consumer only
+            alignas(CACHE_LINE_SIZE) std::atomic<uint32_t> m_futex; ///< Wake up counter
+            std::atomic<bool> m_waiting;                        ///< Consumer is (about to be) asleep
+
+            // Construction
+        public:
+            /**
+             * @param[in] capacity maximum number of elements,
+             *            rounded up to a power of two
+             */
+            explicit MpscQueue(size_t capacity) :
+                m_tail(0),
+                m_head(0),
+                m_futex(0),
+                m_waiting(false)
+            {
+                size_t size = 2;
+                while (size < capacity)
+                {
+                    size <<= 1;
+                }
+
+                m_mask = size - 1;
+                m_slots.reset(new Slot[size]);
+
+                for (size_t i = 0; i < size; ++i)
+                {
+                    m_slots[i].sequence.store(i, std::memory_order_relaxed);
+                }
+            }
+
+            MpscQueue(const MpscQueue &other) = delete;
+            MpscQueue &operator=(const MpscQueue &other) = delete;
+
+            // Methods
+        public:
+            /** @return maximum number of elements */
+            size_t capacity() const
+            {
+                return m_mask + 1;
+            }
+
+            /**
+             * Producer side, may be called from any thread.
+             *
+             * @param[in] value element to add
+             * @return false if the queue is full
+             */
+            template<typename U>
+            bool push(U &&value)
+            {
+                Slot *slot;
+                size_t position = m_tail.load(std::memory_order_relaxed);
+
+                for (;;)
+                {
+                    slot = &m_slots[position & m_mask];
+                    size_t sequence = slot->sequence.load(std::memory_order_acquire);
+                    intptr_t difference = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(position);
+
+                    if (difference == 0)
+                    {
+                        if (m_tail.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+                        {
+                            break;
+                        }
+                    }
+                    else if (difference < 0)
+                    {
+                        // The consumer has not released this slot yet
+                        return false;
+                    }
+                    else
+                    {
+                        position = m_tail.load(std::memory_order_relaxed);
+                    }
+                }
+
+                slot->value = std::forward<U>(value);
+                slot->sequence.store(position + 1, std::memory_order_release);
+
+                notify();
+                return true;
+            }
+
+            /**
+             * Consumer side.
+             *
+             * @param[out] value oldest element
+             * @return false if the queue is empty
+             */
+            bool pop(T &value)
+            {
+                Slot &slot = m_slots[m_head & m_mask];
+
+                if (slot.sequence.load(std::memory_order_acquire) != m_head + 1)
+                {
+                    return false;
+                }
+
+                value = std::move(slot.value);
+                slot.value = T();
+                slot.sequence.store(m_head + m_mask + 1, std::memory_order_release);
+                ++m_head;
+
+                return true;
+            }
+
+            /**
+             * Consumer side.
+             *
+             * @param[out] out iterator receiving the elements, oldest first
+             * @param[in] maxCount maximum number of elements to retrieve
+             * @return number of retrieved elements
+             */
+            template<typename OutputIt>
+            size_t popBatch(OutputIt out, size_t maxCount)
+            {
+                size_t count = 0;
+                T value;
+
+                while ((count < maxCount) and pop(value))
+                {
+                    *out++ = std::move(value);
+                    ++count;
+                }
+
+                return count;
+            }
+
+            /**
+             * Consumer side.
+             *
+             * @return true if no element is ready to be read
+             */
+            bool empty() const
+            {
+                return m_slots[m_head & m_mask].sequence.load(std::memory_order_acquire) != m_head + 1;
+            }
+
+            /**
+             * Consumer side. Blocks until an element is available, wakeup()
+             * is called or the timeout expires.
+             *
+             * @param[in] timeout maximum time to block
+             * @return true if an element is available
+             */
+            bool wait(const std::chrono::nanoseconds &timeout)
+            {
+                uint32_t epoch = m_futex.load(std::memory_order_acquire);
+
+                m_waiting.store(true, std::memory_order_relaxed);
+                std::atomic_thread_fence(std::memory_order_seq_cst);
+
+                if (empty())
+                {
+                    futex::wait(m_futex, epoch, timeout);
+                }
+
+                m_waiting.store(false, std::memory_order_relaxed);
+
+                return not empty();
+            }
+
+            /** Wakes up the consumer if blocked in wait() */
+            void wakeup()
+            {
+                m_futex.fetch_add(1, std::memory_order_release);
+                futex::wake(m_futex);
+            }
+
+        private:
+            void notify()
+            {
+                // Pairs with the fence in wait(): either the consumer sees the
+                // new element, or we see it waiting and bump the futex word
+                std::atomic_thread_fence(std::memory_order_seq_cst);
+
+                if (m_waiting.load(std::memory_order_relaxed))
+                {
+                    wakeup();
+                }
+            }
+        };
+    }
+}
+
+#endif /* _CORE_UTIL_MPSC_QUEUE_H_ */
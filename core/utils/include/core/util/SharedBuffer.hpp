@@ -0,0 +1,88 @@
+/**
+ * @file SharedBuffer.hpp
+ *
+ * @brief Reference counted immutable byte buffer. A payload is
+ *        serialized once and then handed to any number of subscribers
+ *        by bumping a counter instead of copying its contents.
+ *
+ * @author Nicolae Natea
+ * Contact: nicu@natea.ro
+ */
+
+#ifndef _CORE_UTIL_SHARED_BUFFER_H_
+#define _CORE_UTIL_SHARED_BUFFER_H_
+
+#include <cstddef>
+#include <memory>
+#include <string>
+
+namespace core
+{
+    namespace util
+    {
+        /** Immutable, cheaply copyable buffer. */
+        class SharedBuffer
+        {
+        private:
+            std::shared_ptr<const std::string> m_data; ///< Contents, null if empty
+
+            // Construction
+        public:
+            SharedBuffer()
+            {
+            }
+
+            /** @param[in] data contents, moved into the buffer */
+            explicit SharedBuffer(std::string &&data) :
+                m_data(std::make_shared<const std::string>(std::move(data)))
+            {
+            }
+
+            /** @param[in] data contents, copied into the buffer */
+            explicit SharedBuffer(const std::string &data) :
+                m_data(std::make_shared<const std::string>(data))
+            {
+            }
+
+            SharedBuffer(const char *data, size_t size) :
+                m_data(std::make_shared<const std::string>(data, size))
+            {
+            }
+
+            // Methods
+        public:
+            /** @return contents of the buffer */
+            const std::string &str() const
+            {
+                static const std::string empty;
+                return m_data ? *m_data : empty;
+            }
+
+            /** @return pointer to the first byte */
+            const char *data() const
+            {
+                return str().data();
+            }
+
+            /** @return number of bytes */
+            size_t size() const
+            {
+                return m_data ? m_data->size() : 0;
+            }
+
+            /** @return true if the buffer holds no bytes */
+            bool empty() const
+            {
+                return size() == 0;
+            }
+
+            /** @return number of buffers sharing the contents */
+            long useCount() const
+            {
+                return m_data.use_count();
+            }
+        };
+    }
+}
+
+#endif /* _CORE_UTIL_SHARED_BUFFER_H_ */
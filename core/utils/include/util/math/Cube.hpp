@@ -12,6 +12,8 @@
 
 #include <boost/archive/text_oarchive.hpp>
 #include <boost/archive/text_iarchive.hpp>
+#include <boost/iostreams/device/array.hpp>
+#include <boost/iostreams/stream.hpp>
 #include <boost/serialization/string.hpp>
 #include <boost/serialization/serialization.hpp>
 #include <boost/serialization/vector.hpp>
@@ -61,9 +63,10 @@ namespace util
 				return oss.str();
 			}
 
-			void fromString(std::string& data)
+			void fromString(const std::string& data)
 			{
-				std::istringstream iss(data);
+				// Parse in place, the payload may be shared with other readers
+				boost::iostreams::stream<boost::iostreams::array_source> iss(data.data(), data.size());
 				boost::archive::text_iarchive ia(iss);
 
 				ia >> *this;
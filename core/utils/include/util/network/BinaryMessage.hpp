@@ -0,0 +1,352 @@
+/**
+ * @file BinaryMessage.hpp
+ *
+ * @brief Versioned binary frame format for network messages.
+ *        A frame is a fixed little endian header followed by the raw
+ *        id and payload bytes:
+ *
+ *          offset size field
+ *               0    1 sync (0xB5, never an ASCII digit, so frames can
+ *                      be told apart from text archived Messages)
+ *               1    1 version, 2 since the extensions; a peer only
+ *                      decodes its own, so an older one rejects the hello
+ *                      and both stay on text archives
+ *               2    2 flags
+ *               4    2 id length
+ *               6    2 extension length, zero when absent
+ *               8    4 payload length
+ *              12    4 crc32 of the id followed by the payload
+ *
+ *        The extension sits between the header and the id. Frames with
+ *        FLAG_TRACE carry the trace of the message there, stamped by each
+ *        node it goes through:
+ *
+ *          offset size field
+ *               0    4 origin node id
+ *               4    4 sequence number, per origin and id
+ *               8    8 origin time, ns of the origin monotonic clock
+ *              16    8 send time, ns of the last hop monotonic clock
+ *              24    2 hop count, 0 when sent by the origin
+ *              26    2 reserved, zero
+ *
+ *        Frames with FLAG_PRESENTATION follow with the time the message
+ *        is to be presented at, so displays fed by different nodes swap
+ *        frames together:
+ *
+ *          offset size field
+ *               0    8 presentation time, ns of the monotonic clock of
+ *                      the server, the reference its clients sync to
+ *
+ *        Extensions a receiver does not know are skipped, the checksum
+ *        only covers the id and payload so hops restamp the trace freely.
+ *        Encoding and decoding work on caller provided buffers and do
+ *        not allocate; a decoded frame references the input bytes.
+ *
+ * @author Nicolae Natea
+ * Contact: nicu@natea.ro
+ */
+
+#ifndef _UTIL_NETWORK_BINARY_MESSAGE_H_
+#define _UTIL_NETWORK_BINARY_MESSAGE_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <optional>
+#include <string_view>
+
+#include <boost/crc.hpp>
+
+#include <core/util/EnumCast.hpp>
+
+namespace util
+{
+    namespace network
+    {
+        /** Encoding used on a connection */
+        enum struct WireFormat
+        {
+            TEXT,  ///< boost text archive of util::network::Message, understood by every peer
+            BINARY ///< BinaryMessage frames, used once both peers exchanged a hello
+        };
+
+        static const core::util::EnumCast<WireFormat> wire_format_map =
+            core::util::EnumCast<WireFormat>
+                (WireFormat::TEXT,   "text")
+                (WireFormat::BINARY, "binary");
+
+        /** Latency tracing fields of a message, see BinaryMessage */
+        struct MessageTrace
+        {
+            uint32_t origin;     ///< Node which published the message
+            uint32_t sequence;   ///< Per origin and id, gaps reveal lost messages
+            uint64_t originTime; ///< When the origin sent it, ns of its monotonic clock
+            uint64_t sendTime;   ///< When the last hop sent it, ns of its monotonic clock
+            uint16_t hops;       ///< Nodes which forwarded it
+        };
+
+        /** Optional fields a frame carries between its header and id */
+        struct MessageExtensions
+        {
+            std::optional<MessageTrace> trace; ///< Set if FLAG_TRACE is
+            std::optional<uint64_t> presentAt; ///< Set if FLAG_PRESENTATION is, ns of the server monotonic clock
+        };
+
+        /** View over a decoded frame, valid while the input buffer is */
+        struct BinaryMessageView
+        {
+            std::string_view id;          ///< Message id
+            std::string_view payload;     ///< Message data
+            uint16_t flags;               ///< Header flags
+            MessageExtensions extensions; ///< Known extensions the frame carries
+        };
+
+        class BinaryMessage
+        {
+        public:
+            static const uint8_t SYNC = 0xB5;
+            static const uint8_t VERSION = 2;
+            static const size_t HEADER_SIZE = 16;
+            static const size_t MAX_ID_SIZE = 0xFFFF;
+            static const size_t TRACE_SIZE = 28;
+            static const size_t PRESENTATION_SIZE = 8;
+
+            /** The frame carries a MessageTrace extension */
+            static const uint16_t FLAG_TRACE = 0x0001;
+
+            /** The frame carries a presentation time extension */
+            static const uint16_t FLAG_PRESENTATION = 0x0002;
+
+            /** Id of the frame a peer sends to announce it understands binary frames */
+            static constexpr const char *HELLO_ID = "__hello";
+
+            /** Result of a decode attempt */
+            enum struct Status
+            {
+                OK,         ///< A complete, valid frame was decoded
+                INCOMPLETE, ///< More bytes are needed
+                INVALID     ///< Bad sync, unsupported version or checksum mismatch
+            };
+
+            /** @return true if the bytes start like a binary frame */
+            static bool isBinary(const char *data, size_t size)
+            {
+                return (size > 0) and (static_cast<uint8_t>(data[0]) == SYNC);
+            }
+
+            /** @return number of bytes needed to encode the message */
+            static size_t encodedSize(size_t idSize, size_t payloadSize, size_t extensionSize = 0)
+            {
+                return HEADER_SIZE + extensionSize + idSize + payloadSize;
+            }
+
+            /** @return number of bytes the extensions take in a frame */
+            static size_t extensionSize(const MessageExtensions &extensions)
+            {
+                return (extensions.trace ? TRACE_SIZE : 0) + (extensions.presentAt ? PRESENTATION_SIZE : 0);
+            }
+
+            /**
+             * @param[in] data start of a frame
+             * @param[in] size number of available bytes
+             * @return size of the whole frame, 0 if the header is incomplete
+             */
+            static size_t frameSize(const char *data, size_t size)
+            {
+                if (size < HEADER_SIZE)
+                {
+                    return 0;
+                }
+
+                return encodedSize(get16(data + 4), get32(data + 8), get16(data + 6));
+            }
+
+            /**
+             * Encodes a message into the caller buffer.
+             *
+             * @param[in] id message id
+             * @param[in] payload message data
+             * @param[out] out destination buffer
+             * @param[in] outSize size of the destination buffer
+             * @param[in] flags header flags
+             * @param[in] extensions optional fields, each sets its flag
+             * @return number of bytes written, 0 if the buffer is too small
+             */
+            static size_t encode(
+                std::string_view id,
+                std::string_view payload,
+                char *out,
+                size_t outSize,
+                uint16_t flags = 0,
+                const MessageExtensions &extensions = MessageExtensions())
+            {
+                size_t extensionsSize = extensionSize(extensions);
+                size_t size = encodedSize(id.size(), payload.size(), extensionsSize);
+
+                if ((size > outSize) or (id.size() > MAX_ID_SIZE) or (payload.size() > UINT32_MAX))
+                {
+                    return 0;
+                }
+
+                out[0] = static_cast<char>(SYNC);
+                out[1] = static_cast<char>(VERSION);
+                flags &= ~(FLAG_TRACE | FLAG_PRESENTATION);
+                flags |= (extensions.trace ? FLAG_TRACE : 0) | (extensions.presentAt ? FLAG_PRESENTATION : 0);
+                put16(out + 2, flags);
+                put16(out + 4, static_cast<uint16_t>(id.size()));
+                put16(out + 6, static_cast<uint16_t>(extensionsSize));
+                put32(out + 8, static_cast<uint32_t>(payload.size()));
+                put32(out + 12, checksum(id, payload));
+
+                char *extension = out + HEADER_SIZE;
+                if (extensions.trace)
+                {
+                    const MessageTrace &trace = *extensions.trace;
+                    put32(extension, trace.origin);
+                    put32(extension + 4, trace.sequence);
+                    put64(extension + 8, trace.originTime);
+                    put64(extension + 16, trace.sendTime);
+                    put16(extension + 24, trace.hops);
+                    put16(extension + 26, 0);
+                    extension += TRACE_SIZE;
+                }
+
+                if (extensions.presentAt)
+                {
+                    put64(extension, *extensions.presentAt);
+                    extension += PRESENTATION_SIZE;
+                }
+
+                std::memcpy(extension, id.data(), id.size());
+                std::memcpy(extension + id.size(), payload.data(), payload.size());
+
+                return size;
+            }
+
+            /**
+             * Decodes the frame at the start of the buffer.
+             *
+             * @param[in] data received bytes
+             * @param[in] size number of received bytes
+             * @param[out] view id and payload, pointing into data, and the known extensions
+             * @param[out] consumed size of the decoded frame
+             * @return decode status
+             */
+            static Status decode(const char *data, size_t size, BinaryMessageView &view, size_t &consumed)
+            {
+                consumed = 0;
+
+                if (size == 0)
+                {
+                    return Status::INCOMPLETE;
+                }
+
+                if (static_cast<uint8_t>(data[0]) != SYNC)
+                {
+                    return Status::INVALID;
+                }
+
+                if (size < HEADER_SIZE)
+                {
+                    return Status::INCOMPLETE;
+                }
+
+                if (static_cast<uint8_t>(data[1]) != VERSION)
+                {
+                    return Status::INVALID;
+                }
+
+                size_t frame = frameSize(data, size);
+                if (size < frame)
+                {
+                    return Status::INCOMPLETE;
+                }
+
+                uint16_t idSize = get16(data + 4);
+                uint16_t extensionSize = get16(data + 6);
+                const char *extension = data + HEADER_SIZE;
+                view.flags = get16(data + 2);
+                view.id = std::string_view(extension + extensionSize, idSize);
+                view.payload = std::string_view(extension + extensionSize + idSize, get32(data + 8));
+                view.extensions = MessageExtensions();
+
+                size_t known = ((view.flags & FLAG_TRACE) ? TRACE_SIZE : 0) +
+                    ((view.flags & FLAG_PRESENTATION) ? PRESENTATION_SIZE : 0);
+                if (extensionSize < known)
+                {
+                    return Status::INVALID;
+                }
+
+                if (view.flags & FLAG_TRACE)
+                {
+                    view.extensions.trace = MessageTrace{
+                        get32(extension),
+                        get32(extension + 4),
+                        get64(extension + 8),
+                        get64(extension + 16),
+                        get16(extension + 24)};
+                    extension += TRACE_SIZE;
+                }
+
+                if (view.flags & FLAG_PRESENTATION)
+                {
+                    view.extensions.presentAt = get64(extension);
+                }
+
+                if (checksum(view.id, view.payload) != get32(data + 12))
+                {
+                    return Status::INVALID;
+                }
+
+                consumed = frame;
+                return Status::OK;
+            }
+
+            /** Little endian field accessors, shared with the other network headers */
+            static void put16(char *out, uint16_t value)
+            {
+                out[0] = static_cast<char>(value);
+                out[1] = static_cast<char>(value >> 8);
+            }
+
+            static void put32(char *out, uint32_t value)
+            {
+                put16(out, static_cast<uint16_t>(value));
+                put16(out + 2, static_cast<uint16_t>(value >> 16));
+            }
+
+            static void put64(char *out, uint64_t value)
+            {
+                put32(out, static_cast<uint32_t>(value));
+                put32(out + 4, static_cast<uint32_t>(value >> 32));
+            }
+
+            static uint16_t get16(const char *in)
+            {
+                const uint8_t *bytes = reinterpret_cast<const uint8_t *>(in);
+                return static_cast<uint16_t>(bytes[0] | (bytes[1] << 8));
+            }
+
+            static uint32_t get32(const char *in)
+            {
+                return get16(in) | (static_cast<uint32_t>(get16(in + 2)) << 16);
+            }
+
+            static uint64_t get64(const char *in)
+            {
+                return get32(in) | (static_cast<uint64_t>(get32(in + 4)) << 32);
+            }
+
+        private:
+            static uint32_t checksum(std::string_view id, std::string_view payload)
+            {
+                boost::crc_32_type crc;
+                crc.process_bytes(id.data(), id.size());
+                crc.process_bytes(payload.data(), payload.size());
+                return crc.checksum();
+            }
+        };
+    }
+}
+
+#endif /* _UTIL_NETWORK_BINARY_MESSAGE_H_ */
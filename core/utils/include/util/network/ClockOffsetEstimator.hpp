@@ -0,0 +1,87 @@
+/**
+ * @file ClockOffsetEstimator.hpp
+ *
+ * @brief Estimates the offset of a remote monotonic clock from request /
+ *        response exchanges, the way NTP does: the request leaves at t1
+ *        and arrives at t2, the response leaves at t3 and arrives at t4,
+ *        t1 and t4 read from the local clock, t2 and t3 from the remote one.
+ *
+ *          delay  = (t4 - t1) - (t3 - t2)
+ *          offset = ((t2 - t1) + (t3 - t4)) / 2
+ *
+ *        The offset is exact when both directions take as long; queuing
+ *        delays one direction only, so among the last exchanges the one
+ *        with the smallest round trip gives the estimate.
+ *
+ * @author Nicolae Natea
+ * Contact: nicu@natea.ro
+ */
+
+#ifndef _UTIL_NETWORK_CLOCK_OFFSET_ESTIMATOR_H_
+#define _UTIL_NETWORK_CLOCK_OFFSET_ESTIMATOR_H_
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+
+namespace util
+{
+    namespace network
+    {
+        class ClockOffsetEstimator
+        {
+        public:
+            /** @param[in] window number of exchanges the estimate is picked from */
+            explicit ClockOffsetEstimator(size_t window = 8);
+
+            /**
+             * Records an exchange, times in ns.
+             *
+             * @param[in] t1 request sent, local clock
+             * @param[in] t2 request received, remote clock
+             * @param[in] t3 response sent, remote clock
+             * @param[in] t4 response received, local clock
+             * @return false if the times are inconsistent and were ignored
+             */
+            bool add(uint64_t t1, uint64_t t2, uint64_t t3, uint64_t t4);
+
+            /** Forgets the exchanges, the remote clock changed */
+            void reset();
+
+            /** @return true once an exchange was recorded */
+            bool isSynchronized() const;
+
+            /** @return remote minus local clock, zero until synchronized */
+            std::chrono::nanoseconds getOffset() const;
+
+            /** @return round trip of the exchange the offset comes from */
+            std::chrono::nanoseconds getDelay() const;
+
+            /** @return remote clock time matching a local one, in ns */
+            uint64_t toRemote(uint64_t local) const;
+
+            /** @return local clock time matching a remote one, in ns */
+            uint64_t toLocal(uint64_t remote) const;
+
+        private:
+            struct Sample
+            {
+                int64_t offset;
+                int64_t delay;
+            };
+
+            /** Picks the sample with the smallest round trip, m_mutex held */
+            void select();
+
+            size_t m_window;
+
+            mutable std::mutex m_mutex;
+            std::deque<Sample> m_samples; ///< Last exchanges, oldest first
+            Sample m_selected;            ///< Estimate in use
+        };
+    }
+}
+
+#endif /* _UTIL_NETWORK_CLOCK_OFFSET_ESTIMATOR_H_ */
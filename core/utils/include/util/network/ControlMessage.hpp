@@ -0,0 +1,98 @@
+/**
+ * @file ControlMessage.hpp
+ *
+ * @brief Messages exchanged between network peers to manage the
+ *        connection itself. They travel as regular messages with
+ *        reserved ids and are never published on the bus.
+ *
+ * @author Nicolae Natea
+ * Contact: nicu@natea.ro
+ */
+
+#ifndef _UTIL_NETWORK_CONTROL_MESSAGE_H_
+#define _UTIL_NETWORK_CONTROL_MESSAGE_H_
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace util
+{
+    namespace network
+    {
+        class ControlMessage
+        {
+        public:
+            /**
+             * Id of the message carrying the complete set of topics a client
+             * wants to receive. Each new one replaces the previous set; a
+             * client that never sends one receives every topic.
+             */
+            static constexpr const char *SUBSCRIBE_ID = "__subscribe";
+
+            /**
+             * Id of the message offering the multicast data channel, whose
+             * group and port it lists. The client answers with the same id
+             * and no payload once it joined; the server then stops sending
+             * the multicast topics over its connection.
+             */
+            static constexpr const char *MULTICAST_ID = "__multicast";
+
+            /**
+             * Id of the message a client sends when multicast frames were
+             * lost, listing the first and last missing sequence numbers.
+             * The server answers with the latest frame of each multicast
+             * topic over the connection.
+             */
+            static constexpr const char *NACK_ID = "__nack";
+
+            /**
+             * Id of the heartbeat a client sends periodically, listing its
+             * send time in ns and the round trip time it measured so far in
+             * us. The server answers with PONG_ID, the same payload followed
+             * by the times, in ns of its monotonic clock, it received the
+             * ping and sent the answer, so the client estimates the offset
+             * of the server clock. A peer silent for too long is considered
+             * dead.
+             */
+            static constexpr const char *PING_ID = "__ping";
+            static constexpr const char *PONG_ID = "__pong";
+
+            /** @return the values as a newline separated payload */
+            static std::string encodeList(const std::vector<std::string> &values)
+            {
+                std::string payload;
+
+                for (const std::string &value : values)
+                {
+                    payload.append(value).push_back('\n');
+                }
+
+                return payload;
+            }
+
+            /** @return the values of a newline separated payload */
+            static std::vector<std::string> decodeList(std::string_view payload)
+            {
+                std::vector<std::string> values;
+
+                while (not payload.empty())
+                {
+                    size_t end = payload.find('\n');
+                    std::string_view value = payload.substr(0, end);
+
+                    if (not value.empty())
+                    {
+                        values.emplace_back(value);
+                    }
+
+                    payload.remove_prefix((end == std::string_view::npos) ? payload.size() : end + 1);
+                }
+
+                return values;
+            }
+        };
+    }
+}
+
+#endif /* _UTIL_NETWORK_CONTROL_MESSAGE_H_ */
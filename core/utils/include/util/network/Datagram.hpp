@@ -0,0 +1,322 @@
+/**
+ * @file Datagram.hpp
+ *
+ * @brief Sequenced datagrams carrying binary frames over UDP.
+ *        Each frame gets a sequence number and is split into datagrams
+ *        no larger than the MTU, each starting with a little endian header:
+ *
+ *          offset size field
+ *               0    1 sync (0xB6)
+ *               1    1 version
+ *               2    2 fragment index
+ *               4    2 fragment count
+ *               6    2 reserved, zero
+ *               8    4 frame sequence number
+ *              12    4 frame size
+ *              16    4 offset of the fragment in the frame
+ *
+ *        The receiving side reassembles the fragments and hands out the
+ *        newest complete frames only. Frames are state updates, so one
+ *        older than what was delivered is dropped, and skipped sequence
+ *        numbers are reported as a gap for the caller to recover from.
+ *
+ * @author Nicolae Natea
+ * Contact: nicu@natea.ro
+ */
+
+#ifndef _UTIL_NETWORK_DATAGRAM_H_
+#define _UTIL_NETWORK_DATAGRAM_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <map>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <util/network/BinaryMessage.hpp>
+
+namespace util
+{
+    namespace network
+    {
+        class Datagram
+        {
+        public:
+            static const uint8_t SYNC = 0xB6;
+            static const uint8_t VERSION = 1;
+            static const size_t HEADER_SIZE = 20;
+            static const size_t MAX_FRAGMENTS = 0xFFFF;
+
+            /**
+             * Splits a frame into datagrams. The header and the data of each
+             * one are handed out separately, so they can be gathered into a
+             * single send without copying the frame.
+             *
+             * @param[in] sequence frame sequence number
+             * @param[in] frame bytes to send
+             * @param[in] mtu largest datagram, header included
+             * @param[in] handler called as handler(header, data) for each datagram,
+             *            header holds HEADER_SIZE bytes valid during the call
+             * @return number of datagrams, 0 if the frame needs too many
+             */
+            template<typename Handler>
+            static size_t fragment(uint32_t sequence, std::string_view frame, size_t mtu, Handler handler)
+            {
+                size_t fragmentSize = (mtu > HEADER_SIZE) ? mtu - HEADER_SIZE : 1;
+                size_t count = (frame.size() + fragmentSize - 1) / fragmentSize;
+
+                if ((count == 0) or (count > MAX_FRAGMENTS) or (frame.size() > UINT32_MAX))
+                {
+                    return 0;
+                }
+
+                char header[HEADER_SIZE];
+                header[0] = static_cast<char>(SYNC);
+                header[1] = static_cast<char>(VERSION);
+                BinaryMessage::put16(header + 4, static_cast<uint16_t>(count));
+                BinaryMessage::put16(header + 6, 0);
+                BinaryMessage::put32(header + 8, sequence);
+                BinaryMessage::put32(header + 12, static_cast<uint32_t>(frame.size()));
+
+                for (size_t index = 0; index < count; ++index)
+                {
+                    size_t offset = index * fragmentSize;
+
+                    BinaryMessage::put16(header + 2, static_cast<uint16_t>(index));
+                    BinaryMessage::put32(header + 16, static_cast<uint32_t>(offset));
+
+                    handler(std::string_view(header, HEADER_SIZE), frame.substr(offset, fragmentSize));
+                }
+
+                return count;
+            }
+        };
+
+        class DatagramReassembler
+        {
+        public:
+            /**
+             * @param[in] maxFrameSize largest accepted frame
+             * @param[in] maxPending frames kept incomplete at the same time
+             */
+            explicit DatagramReassembler(size_t maxFrameSize, size_t maxPending = 16) :
+                m_maxFrameSize(maxFrameSize),
+                m_maxPending(maxPending),
+                m_isStarted(false),
+                m_next(0),
+                m_hasGap(false),
+                m_gapFrom(0),
+                m_gapTo(0),
+                m_invalid(0)
+            {
+            }
+
+            /**
+             * Adds a received datagram.
+             *
+             * @param[in] data received bytes
+             * @param[in] size number of received bytes
+             * @param[in] handler called as handler(frame) if the datagram completed
+             *            a frame newer than the last delivered one
+             * @return false if the datagram is not valid
+             */
+            template<typename Handler>
+            bool add(const char *data, size_t size, Handler handler)
+            {
+                if ((size < Datagram::HEADER_SIZE) or
+                    (static_cast<uint8_t>(data[0]) != Datagram::SYNC) or
+                    (static_cast<uint8_t>(data[1]) != Datagram::VERSION))
+                {
+                    ++m_invalid;
+                    return false;
+                }
+
+                uint16_t index = BinaryMessage::get16(data + 2);
+                uint16_t count = BinaryMessage::get16(data + 4);
+                uint32_t sequence = BinaryMessage::get32(data + 8);
+                uint32_t frameSize = BinaryMessage::get32(data + 12);
+                uint32_t offset = BinaryMessage::get32(data + 16);
+                size_t fragmentSize = size - Datagram::HEADER_SIZE;
+
+                if ((index >= count) or (frameSize > m_maxFrameSize) or
+                    (offset > frameSize) or (fragmentSize > frameSize - offset))
+                {
+                    ++m_invalid;
+                    return false;
+                }
+
+                if (not m_isStarted or isRestarted(sequence))
+                {
+                    // Whatever was sent before joining is not a gap
+                    m_isStarted = true;
+                    m_next = sequence;
+                    m_pending.clear();
+                }
+
+                if (isBefore(sequence, m_next))
+                {
+                    return true;
+                }
+
+                std::string_view frame(data + Datagram::HEADER_SIZE, fragmentSize);
+
+                if (count > 1)
+                {
+                    Pending &pending = m_pending[sequence];
+
+                    if (pending.received.empty())
+                    {
+                        pending.frame.resize(frameSize);
+                        pending.received.resize(count, false);
+                        pending.missing = count;
+                    }
+
+                    if ((pending.frame.size() != frameSize) or (pending.received.size() != count))
+                    {
+                        ++m_invalid;
+                        return false;
+                    }
+
+                    if (not pending.received[index])
+                    {
+                        std::memcpy(&pending.frame[offset], frame.data(), fragmentSize);
+                        pending.received[index] = true;
+                        --pending.missing;
+                    }
+
+                    if (pending.missing != 0)
+                    {
+                        trimPending();
+                        return true;
+                    }
+
+                    m_completed.swap(pending.frame);
+                    frame = m_completed;
+                }
+                else if (fragmentSize != frameSize)
+                {
+                    ++m_invalid;
+                    return false;
+                }
+
+                deliver(sequence);
+                handler(frame);
+
+                return true;
+            }
+
+            /**
+             * Takes the oldest range of frames skipped since the last call.
+             *
+             * @param[out] from first missing sequence number
+             * @param[out] to last missing sequence number
+             * @return false if nothing was skipped
+             */
+            bool takeGap(uint32_t &from, uint32_t &to)
+            {
+                if (not m_hasGap)
+                {
+                    return false;
+                }
+
+                from = m_gapFrom;
+                to = m_gapTo;
+                m_hasGap = false;
+
+                return true;
+            }
+
+            /** @return number of datagrams rejected as invalid */
+            uint64_t getInvalidCount() const
+            {
+                return m_invalid;
+            }
+
+            /** Forgets all state, the next datagram starts a new stream */
+            void clear()
+            {
+                m_isStarted = false;
+                m_hasGap = false;
+                m_pending.clear();
+            }
+
+        private:
+            /** Frame waiting for some of its fragments */
+            struct Pending
+            {
+                std::string frame;
+                std::vector<bool> received;
+                size_t missing;
+            };
+
+            /** Sequence numbers older than this are taken as a sender restart */
+            static const uint32_t RESTART_DISTANCE = 1024;
+
+            static bool isBefore(uint32_t sequence, uint32_t other)
+            {
+                return static_cast<int32_t>(sequence - other) < 0;
+            }
+
+            bool isRestarted(uint32_t sequence) const
+            {
+                return isBefore(sequence, m_next) and (m_next - sequence > RESTART_DISTANCE);
+            }
+
+            /** Moves past a frame, everything older is abandoned */
+            void deliver(uint32_t sequence)
+            {
+                if (sequence != m_next)
+                {
+                    if (not m_hasGap)
+                    {
+                        m_gapFrom = m_next;
+                    }
+
+                    m_hasGap = true;
+                    m_gapTo = sequence - 1;
+                }
+
+                m_next = sequence + 1;
+
+                for (auto it = m_pending.begin(); it != m_pending.end();)
+                {
+                    it = isBefore(it->first, m_next) ? m_pending.erase(it) : std::next(it);
+                }
+            }
+
+            /** Abandons the oldest incomplete frames beyond the limit */
+            void trimPending()
+            {
+                while (m_pending.size() > m_maxPending)
+                {
+                    auto oldest = m_pending.begin();
+
+                    for (auto it = m_pending.begin(); it != m_pending.end(); ++it)
+                    {
+                        if (isBefore(it->first, oldest->first))
+                        {
+                            oldest = it;
+                        }
+                    }
+
+                    m_pending.erase(oldest);
+                }
+            }
+
+            size_t m_maxFrameSize;                ///< Largest accepted frame
+            size_t m_maxPending;                  ///< Incomplete frames kept at most
+            std::map<uint32_t, Pending> m_pending; ///< Incomplete frames by sequence number
+            std::string m_completed;              ///< Last frame completed from fragments
+            bool m_isStarted;                     ///< A datagram was received since clear()
+            uint32_t m_next;                      ///< Oldest sequence number still accepted
+            bool m_hasGap;                        ///< Frames were skipped since the last takeGap()
+            uint32_t m_gapFrom;                   ///< First skipped sequence number
+            uint32_t m_gapTo;                     ///< Last skipped sequence number
+            uint64_t m_invalid;                   ///< Rejected datagrams
+        };
+    }
+}
+
+#endif /* _UTIL_NETWORK_DATAGRAM_H_ */
@@ -0,0 +1,59 @@
+/**
+ * @file FramePool.hpp
+ *
+ * @brief Encoded frames shared with the queues of the connections, reused
+ *        once every queue let go of them. A frame nobody else holds is
+ *        handed out again with the capacity it grew to, so encoding a
+ *        steady stream of messages stops allocating after warm up.
+ *
+ * @author Nicolae Natea
+ * Contact: nicu@natea.ro
+ */
+
+#ifndef _UTIL_NETWORK_FRAME_POOL_H_
+#define _UTIL_NETWORK_FRAME_POOL_H_
+
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace util
+{
+    namespace network
+    {
+        class FramePool
+        {
+        public:
+            /**
+             * @param[in] size frames kept for reuse
+             * @param[in] maxFrameCapacity frames grown past it are not kept
+             */
+            explicit FramePool(size_t size = 256, size_t maxFrameCapacity = 64 * 1024);
+
+            FramePool(const FramePool &) = delete;
+            FramePool &operator=(const FramePool &) = delete;
+
+            /**
+             * @return a frame nobody else holds, may be called from any thread.
+             *         It is allocated only if every pooled frame is still in use.
+             */
+            std::shared_ptr<std::string> acquire();
+
+            /** @return frames allocated because none was free */
+            size_t getAllocations() const;
+
+        private:
+            size_t m_maxFrameCapacity;
+
+            mutable std::mutex m_mutex;
+            std::vector<std::shared_ptr<std::string>> m_frames; ///< Free once only the pool holds them
+            size_t m_size;                                      ///< Capacity of m_frames
+            size_t m_next;                                      ///< Where the search starts, oldest first
+            size_t m_allocations;
+        };
+    }
+}
+
+#endif /* _UTIL_NETWORK_FRAME_POOL_H_ */
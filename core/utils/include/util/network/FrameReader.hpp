@@ -0,0 +1,133 @@
+/**
+ * @file FrameReader.hpp
+ *
+ * @brief Reassembly buffer for a stream socket. Bytes are read straight
+ *        into the buffer and complete frames are handed out in place,
+ *        however TCP split or coalesced them. Binary frames are
+ *        delimited by the lengths in their header; legacy text archives
+ *        carry no length, so whatever is buffered is handed out as one.
+ *        Text peers are therefore deprecated, MessageCodec rejects a
+ *        buffer holding several archives.
+ *
+ * @author Nicolae Natea
+ * Contact: nicu@natea.ro
+ */
+
+#ifndef _UTIL_NETWORK_FRAME_READER_H_
+#define _UTIL_NETWORK_FRAME_READER_H_
+
+#include <cstddef>
+#include <cstring>
+#include <stdexcept>
+#include <string_view>
+#include <vector>
+
+#include <util/network/BinaryMessage.hpp>
+
+namespace util
+{
+    namespace network
+    {
+        class FrameReader
+        {
+        public:
+            /**
+             * @param[in] maxFrameSize largest accepted frame, header included.
+             *            It is also the minimum size of each read.
+             */
+            explicit FrameReader(size_t maxFrameSize) :
+                m_maxFrameSize(maxFrameSize),
+                m_buffer(2 * maxFrameSize),
+                m_begin(0),
+                m_end(0)
+            {
+            }
+
+            /** @return start of the free space to read into */
+            char *prepare()
+            {
+                // Only a partial frame, smaller than the maximum, is ever kept
+                // so moving it to the front leaves room for a full read
+                if (m_begin != 0)
+                {
+                    std::memmove(m_buffer.data(), m_buffer.data() + m_begin, m_end - m_begin);
+                    m_end -= m_begin;
+                    m_begin = 0;
+                }
+
+                return m_buffer.data() + m_end;
+            }
+
+            /** @return number of bytes that may be written after prepare() */
+            size_t writable() const
+            {
+                return m_buffer.size() - m_end;
+            }
+
+            /** @param[in] size number of bytes written after prepare() */
+            void commit(size_t size)
+            {
+                m_end += size;
+            }
+
+            /**
+             * Extracts the next complete frame. The view is valid until the
+             * next call to prepare().
+             *
+             * @param[out] frame bytes of the frame
+             * @return true if a frame was extracted, false if more bytes are needed
+             *
+             * @throws length_error if the frame exceeds the maximum size;
+             *         the stream cannot be resynchronized afterwards
+             */
+            bool next(std::string_view &frame)
+            {
+                const char *data = m_buffer.data() + m_begin;
+                size_t available = m_end - m_begin;
+
+                if (available == 0)
+                {
+                    return false;
+                }
+
+                if (not BinaryMessage::isBinary(data, available))
+                {
+                    frame = std::string_view(data, available);
+                    m_begin = m_end;
+                    return true;
+                }
+
+                size_t size = BinaryMessage::frameSize(data, available);
+
+                if (size > m_maxFrameSize)
+                {
+                    throw std::length_error("Frame exceeds the maximum size");
+                }
+
+                if ((size == 0) or (size > available))
+                {
+                    return false;
+                }
+
+                frame = std::string_view(data, size);
+                m_begin += size;
+                return true;
+            }
+
+            /** Drops any buffered bytes */
+            void clear()
+            {
+                m_begin = 0;
+                m_end = 0;
+            }
+
+        private:
+            size_t m_maxFrameSize;     ///< Largest accepted frame
+            std::vector<char> m_buffer; ///< Received bytes
+            size_t m_begin;            ///< Start of the unread bytes
+            size_t m_end;              ///< End of the received bytes
+        };
+    }
+}
+
+#endif /* _UTIL_NETWORK_FRAME_READER_H_ */
@@ -0,0 +1,58 @@
+/**
+ * @file LocalTransport.hpp
+ *
+ * @brief Naming of the unix domain socket a server listens on next to
+ *        its TCP port. Peers on the same host connect through it and
+ *        skip the TCP/IP stack. A path starting with '@' names an
+ *        abstract socket, which lives outside the filesystem and
+ *        disappears with the server.
+ *
+ * @author Nicolae Natea
+ * Contact: nicu@natea.ro
+ */
+
+#ifndef _UTIL_NETWORK_LOCAL_TRANSPORT_H_
+#define _UTIL_NETWORK_LOCAL_TRANSPORT_H_
+
+#include <cstdint>
+#include <string>
+
+namespace util
+{
+    namespace network
+    {
+        class LocalTransport
+        {
+        public:
+            /** First character of abstract socket names */
+            static const char ABSTRACT_PREFIX = '@';
+
+            /** @return path used when neither side configures one, derived from the TCP port */
+            static std::string getDefaultPath(uint16_t tcpPort)
+            {
+                return std::string(1, ABSTRACT_PREFIX) + "breadcrumbs-" + std::to_string(tcpPort);
+            }
+
+            /** @return true if the path names an abstract socket */
+            static bool isAbstract(const std::string &path)
+            {
+                return not path.empty() and (path[0] == ABSTRACT_PREFIX);
+            }
+
+            /** @return the path as given to the socket address, abstract names start with a null byte */
+            static std::string toSocketPath(const std::string &path)
+            {
+                if (not isAbstract(path))
+                {
+                    return path;
+                }
+
+                std::string socketPath(path);
+                socketPath[0] = '\0';
+                return socketPath;
+            }
+        };
+    }
+}
+
+#endif /* _UTIL_NETWORK_LOCAL_TRANSPORT_H_ */
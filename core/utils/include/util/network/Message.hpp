@@ -8,6 +8,7 @@
 #ifndef _UTIL_NETWORK_MESSAGE_H_
 #define _UTIL_NETWORK_MESSAGE_H_
 
+#include <cstddef>
 #include <cstdint>
 
 #include <boost/archive/text_oarchive.hpp>
@@ -59,12 +60,16 @@ namespace util
                 return oss.str();
             }
 
-            void fromString(const std::string &data)
+            /** @return number of bytes the archive took, whatever follows was not read */
+            size_t fromString(const std::string &data)
             {
                 std::istringstream iss(data);
                 boost::archive::text_iarchive ia(iss);
 
                 ia >> *this;
+
+                std::streampos end = iss.tellg();
+                return (end < 0) ? data.size() : static_cast<size_t>(end);
             }
 
         protected:
@@ -0,0 +1,177 @@
+/**
+ * @file MessageCodec.hpp
+ *
+ * @brief Encodes and decodes network messages in either wire format.
+ *        Binary frames are recognized by their sync byte, anything else
+ *        is handled as a text archived Message, so a receiver accepts
+ *        both without knowing what the peer negotiated. Message
+ *        extensions, traces and presentation times, only travel in binary
+ *        frames, text archives drop them.
+ *        Text archives are deprecated: they carry no length, so they are
+ *        only decoded one per buffer, and a buffer holding more than one
+ *        archive is rejected rather than partially delivered.
+ *
+ * @author Nicolae Natea
+ * Contact: nicu@natea.ro
+ */
+
+#ifndef _UTIL_NETWORK_MESSAGE_CODEC_H_
+#define _UTIL_NETWORK_MESSAGE_CODEC_H_
+
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+#include <util/network/BinaryMessage.hpp>
+#include <util/network/Message.hpp>
+
+namespace util
+{
+    namespace network
+    {
+        class MessageCodec
+        {
+        public:
+            /**
+             * @param[in] format wire format expected by the peer
+             * @param[in] id message id
+             * @param[in] payload message data
+             * @param[in] extensions optional fields, binary frames only
+             * @return encoded message, ready to be sent
+             */
+            static std::shared_ptr<std::string> encode(
+                WireFormat format,
+                std::string_view id,
+                std::string_view payload,
+                const MessageExtensions &extensions = MessageExtensions())
+            {
+                std::shared_ptr<std::string> buf = std::make_shared<std::string>();
+                encode(format, id, payload, *buf, extensions);
+                return buf;
+            }
+
+            /**
+             * Encodes into a caller buffer, which only allocates if the
+             * message does not fit its capacity.
+             *
+             * @param[in] format wire format expected by the peer
+             * @param[in] id message id
+             * @param[in] payload message data
+             * @param[out] out encoded message, replaces its content
+             * @param[in] extensions optional fields, binary frames only
+             */
+            static void encode(
+                WireFormat format,
+                std::string_view id,
+                std::string_view payload,
+                std::string &out,
+                const MessageExtensions &extensions = MessageExtensions())
+            {
+                if (format == WireFormat::TEXT)
+                {
+                    Message message{std::string(id), std::string(payload)};
+                    out = message.toString();
+                    return;
+                }
+
+                out.resize(BinaryMessage::encodedSize(
+                    id.size(), payload.size(), BinaryMessage::extensionSize(extensions)));
+
+                if (BinaryMessage::encode(id, payload, &out[0], out.size(), 0, extensions) == 0)
+                {
+                    throw std::length_error("Message too large for a binary frame");
+                }
+            }
+
+            /**
+             * Decodes the messages held by a received buffer. Only complete
+             * binary frames are handed out; a text archive must fill the buffer.
+             *
+             * @param[in] data received bytes
+             * @param[in] size number of received bytes
+             * @param[in] handler called as handler(id, payload, format) for each message,
+             *            or as handler(id, payload, format, extensions) if it takes
+             *            the MessageExtensions of the message
+             * @return number of bytes consumed
+             *
+             * @throws invalid_argument if the bytes are not a valid message,
+             *         or hold more than a text archive
+             */
+            template<typename Handler>
+            static size_t decode(const char *data, size_t size, Handler handler)
+            {
+                if (not BinaryMessage::isBinary(data, size))
+                {
+                    Message message;
+                    size_t used = message.fromString(std::string(data, size));
+
+                    if (not message.isValid())
+                    {
+                        throw std::invalid_argument("Invalid text message");
+                    }
+
+                    // Where a second archive would start cannot be told, so none is guessed
+                    if (std::string_view(data + used, size - used).find_first_not_of(" \t\r\n") != std::string_view::npos)
+                    {
+                        throw std::invalid_argument("Unframed text messages coalesced in one read");
+                    }
+
+                    std::string id = message.getId();
+                    std::string payload = message.getData();
+                    dispatch(handler, std::string_view(id), std::string_view(payload), WireFormat::TEXT, MessageExtensions());
+
+                    return size;
+                }
+
+                size_t offset = 0;
+
+                while (offset < size)
+                {
+                    BinaryMessageView view;
+                    size_t consumed;
+
+                    BinaryMessage::Status status = BinaryMessage::decode(data + offset, size - offset, view, consumed);
+
+                    if (status == BinaryMessage::Status::INCOMPLETE)
+                    {
+                        break;
+                    }
+
+                    if (status == BinaryMessage::Status::INVALID)
+                    {
+                        throw std::invalid_argument("Invalid binary frame");
+                    }
+
+                    dispatch(handler, view.id, view.payload, WireFormat::BINARY, view.extensions);
+                    offset += consumed;
+                }
+
+                return offset;
+            }
+
+        private:
+            template<typename Handler>
+            static void dispatch(
+                Handler &handler,
+                std::string_view id,
+                std::string_view payload,
+                WireFormat format,
+                const MessageExtensions &extensions)
+            {
+                if constexpr (std::is_invocable<Handler &, std::string_view, std::string_view, WireFormat,
+                    const MessageExtensions &>::value)
+                {
+                    handler(id, payload, format, extensions);
+                }
+                else
+                {
+                    handler(id, payload, format);
+                }
+            }
+        };
+    }
+}
+
+#endif /* _UTIL_NETWORK_MESSAGE_CODEC_H_ */
@@ -0,0 +1,90 @@
+/**
+ * @file MessageTracer.hpp
+ *
+ * @brief Stamps the MessageTrace of the messages a node sends and keeps
+ *        statistics of the traced messages it receives, per id: latency
+ *        of the last hop, latency since the origin, hop count, and the
+ *        messages missed or received out of order, told by the sequence
+ *        numbers of each origin.
+ *        Times are read from the monotonic clock, which processes of a
+ *        host share; latencies measured between hosts include the offset
+ *        of their clocks.
+ *
+ * @author Nicolae Natea
+ * Contact: nicu@natea.ro
+ */
+
+#ifndef _UTIL_NETWORK_MESSAGE_TRACER_H_
+#define _UTIL_NETWORK_MESSAGE_TRACER_H_
+
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+
+#include <core/util/LatencyHistogram.hpp>
+#include <util/network/BinaryMessage.hpp>
+
+namespace util
+{
+    namespace network
+    {
+        /** Statistics of the traced messages received with one id */
+        struct TraceStatistics
+        {
+            TraceStatistics() : received(0), gaps(0), reordered(0), maxHops(0)
+            {
+            }
+
+            core::util::LatencyHistogram hopLatency; ///< From the previous node sending to this one receiving
+            core::util::LatencyHistogram latency;    ///< From the origin sending to this node receiving
+            uint64_t received;
+            uint64_t gaps;      ///< Messages missed, skipped sequence numbers
+            uint64_t reordered; ///< Messages older than one received before
+            uint16_t maxHops;
+        };
+
+        class MessageTracer
+        {
+        public:
+            /** @param[in] nodeId origin of the messages this node publishes */
+            explicit MessageTracer(uint32_t nodeId);
+
+            /** @return a node id, random unless configured */
+            static uint32_t makeNodeId();
+
+            /** @return time of the monotonic clock, in ns */
+            static uint64_t now();
+
+            uint32_t getNodeId() const;
+
+            /** @return trace of a message published by this node, next in the sequence of its id */
+            MessageTrace start(std::string_view id);
+
+            /** @return trace of a received message this node sends further, one hop later */
+            MessageTrace forward(const MessageTrace &trace) const;
+
+            /** Records a traced message received by this node */
+            void receive(std::string_view id, const MessageTrace &trace);
+
+            /** @return statistics per id, since the start */
+            std::map<std::string, TraceStatistics> getStatistics() const;
+
+            /** @return human readable statistics, one line per id */
+            std::string toString() const;
+
+        private:
+            uint32_t m_nodeId;
+
+            mutable std::mutex m_mutex;
+            std::unordered_map<std::string, uint32_t> m_sequences;                ///< Next sequence number per published id
+            std::map<std::pair<uint32_t, std::string>, uint32_t> m_expected;      ///< Next sequence number per origin and id
+            std::map<std::string, TraceStatistics> m_statistics;
+        };
+    }
+}
+
+#endif /* _UTIL_NETWORK_MESSAGE_TRACER_H_ */
@@ -1,4 +1,3 @@
-
 /**
  * @file Attributes.cpp
  *
@@ -9,31 +8,32 @@
 #include <core/util/Attributes.hpp>
 
 namespace core
-{   
+{
     namespace util
     {
-        std::map<const std::string, std::any>::const_iterator Attributes::begin() const noexcept
+        Attributes::EntryList::const_iterator Attributes::begin() const noexcept
         {
             return m_attributes.begin();
         }
 
-        std::map<const std::string, std::any>::const_iterator Attributes::end() const noexcept
+        Attributes::EntryList::const_iterator Attributes::end() const noexcept
         {
             return m_attributes.end();
         }
-        std::map<const std::string, std::any>::const_iterator Attributes::cbegin() const noexcept
+
+        Attributes::EntryList::const_iterator Attributes::cbegin() const noexcept
         {
             return m_attributes.begin();
         }
 
-        std::map<const std::string, std::any>::const_iterator Attributes::cend() const noexcept
+        Attributes::EntryList::const_iterator Attributes::cend() const noexcept
         {
             return m_attributes.end();
         }
 
-        size_t Attributes::count()
+        size_t Attributes::count() const
         {
             return m_attributes.size();
         }
     }
-}
\ No newline at end of file
+}
@@ -0,0 +1,96 @@
+/**
+ * @file ClockOffsetEstimator.cpp
+ *
+ * @author Nicolae Natea
+ * Contact: nicu@natea.ro
+ */
+
+#include <util/network/ClockOffsetEstimator.hpp>
+
+#include <algorithm>
+
+namespace util
+{
+    namespace network
+    {
+        ClockOffsetEstimator::ClockOffsetEstimator(size_t window) :
+            m_window(std::max<size_t>(window, 1)),
+            m_selected{0, 0}
+        {
+        }
+
+        bool ClockOffsetEstimator::add(uint64_t t1, uint64_t t2, uint64_t t3, uint64_t t4)
+        {
+            // Differences of unsigned times, read as signed, stay right across a wrap
+            int64_t roundTrip = static_cast<int64_t>(t4 - t1);
+            int64_t remoteTime = static_cast<int64_t>(t3 - t2);
+
+            if ((roundTrip < 0) or (remoteTime < 0) or (remoteTime > roundTrip))
+            {
+                return false;
+            }
+
+            Sample sample;
+            sample.delay = roundTrip - remoteTime;
+            sample.offset = (static_cast<int64_t>(t2 - t1) + static_cast<int64_t>(t3 - t4)) / 2;
+
+            std::scoped_lock<std::mutex> lock(m_mutex);
+
+            m_samples.push_back(sample);
+            if (m_samples.size() > m_window)
+            {
+                m_samples.pop_front();
+            }
+
+            select();
+            return true;
+        }
+
+        void ClockOffsetEstimator::reset()
+        {
+            std::scoped_lock<std::mutex> lock(m_mutex);
+
+            m_samples.clear();
+            m_selected = Sample{0, 0};
+        }
+
+        bool ClockOffsetEstimator::isSynchronized() const
+        {
+            std::scoped_lock<std::mutex> lock(m_mutex);
+            return not m_samples.empty();
+        }
+
+        std::chrono::nanoseconds ClockOffsetEstimator::getOffset() const
+        {
+            std::scoped_lock<std::mutex> lock(m_mutex);
+            return std::chrono::nanoseconds(m_selected.offset);
+        }
+
+        std::chrono::nanoseconds ClockOffsetEstimator::getDelay() const
+        {
+            std::scoped_lock<std::mutex> lock(m_mutex);
+            return std::chrono::nanoseconds(m_selected.delay);
+        }
+
+        uint64_t ClockOffsetEstimator::toRemote(uint64_t local) const
+        {
+            std::scoped_lock<std::mutex> lock(m_mutex);
+            return local + static_cast<uint64_t>(m_selected.offset);
+        }
+
+        uint64_t ClockOffsetEstimator::toLocal(uint64_t remote) const
+        {
+            std::scoped_lock<std::mutex> lock(m_mutex);
+            return remote - static_cast<uint64_t>(m_selected.offset);
+        }
+
+        void ClockOffsetEstimator::select()
+        {
+            m_selected = *std::min_element(m_samples.begin(), m_samples.end(),
+                [](const Sample &left, const Sample &right)
+                {
+                    return left.delay < right.delay;
+                });
+        }
+    }
+}
@@ -0,0 +1,72 @@
+/**
+ * @file FramePool.cpp
+ *
+ * @author Nicolae Natea
+ * Contact: nicu@natea.ro
+ */
+
+#include <util/network/FramePool.hpp>
+
+#include <algorithm>
+#include <atomic>
+
+namespace util
+{
+    namespace network
+    {
+        FramePool::FramePool(size_t size, size_t maxFrameCapacity) :
+            m_maxFrameCapacity(maxFrameCapacity),
+            m_size(std::max<size_t>(size, 1)),
+            m_next(0),
+            m_allocations(0)
+        {
+            m_frames.reserve(m_size);
+        }
+
+        std::shared_ptr<std::string> FramePool::acquire()
+        {
+            std::scoped_lock<std::mutex> lock(m_mutex);
+
+            for (size_t i = 0; i < m_frames.size(); ++i)
+            {
+                size_t index = (m_next + i) % m_frames.size();
+                std::shared_ptr<std::string> &frame = m_frames[index];
+
+                // Only copies of held frames are ever made, so nobody can take it back now
+                if (frame.use_count() != 1)
+                {
+                    continue;
+                }
+
+                // The last reader released it, its reads happen before the caller writes
+                std::atomic_thread_fence(std::memory_order_acquire);
+
+                if (frame->capacity() > m_maxFrameCapacity)
+                {
+                    frame = std::make_shared<std::string>();
+                    ++m_allocations;
+                }
+
+                m_next = index + 1;
+                frame->clear();
+                return frame;
+            }
+
+            std::shared_ptr<std::string> frame = std::make_shared<std::string>();
+            ++m_allocations;
+
+            if (m_frames.size() < m_size)
+            {
+                m_frames.push_back(frame);
+            }
+
+            return frame;
+        }
+
+        size_t FramePool::getAllocations() const
+        {
+            std::scoped_lock<std::mutex> lock(m_mutex);
+            return m_allocations;
+        }
+    }
+}
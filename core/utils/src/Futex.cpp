@@ -0,0 +1,38 @@
+/**
+ * @file Futex.cpp
+ *
+ * @author Nicolae Natea
+ * Contact: nicu@natea.ro
+ */
+
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <core/util/Futex.hpp>
+
+namespace core
+{
+    namespace util
+    {
+        namespace futex
+        {
+            static_assert(sizeof(std::atomic<uint32_t>) == sizeof(uint32_t), "atomic is not usable as a futex word");
+
+            void wait(std::atomic<uint32_t> &word, uint32_t expected, const std::chrono::nanoseconds &timeout)
+            {
+                struct timespec ts;
+                ts.tv_sec = std::chrono::duration_cast<std::chrono::seconds>(timeout).count();
+                ts.tv_nsec = (timeout - std::chrono::seconds(ts.tv_sec)).count();
+
+                syscall(SYS_futex, reinterpret_cast<uint32_t *>(&word), FUTEX_WAIT_PRIVATE, expected, &ts, nullptr, 0);
+            }
+
+            void wake(std::atomic<uint32_t> &word, uint32_t count)
+            {
+                syscall(SYS_futex, reinterpret_cast<uint32_t *>(&word), FUTEX_WAKE_PRIVATE, count, nullptr, nullptr, 0);
+            }
+        }
+    }
+}
@@ -0,0 +1,159 @@
+/**
+ * @file LatencyHistogram.cpp
+ *
+ * @author Nicolae Natea
+ * Contact: nicu@natea.ro
+ */
+
+#include <core/util/LatencyHistogram.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+
+namespace core
+{
+    namespace util
+    {
+        namespace
+        {
+            const uint32_t SUB_BUCKETS = 1u << (LatencyHistogram::PRECISION_BITS - 1);
+            const uint64_t MAX_VALUE = (1ull << LatencyHistogram::MAX_VALUE_BITS) - 1;
+
+            /** @return position of the highest bit set, value must not be 0 */
+            uint32_t getHighestBit(uint64_t value)
+            {
+                return 63 - __builtin_clzll(value);
+            }
+        }
+
+        LatencyHistogram::LatencyHistogram() :
+            m_buckets(getBucket(MAX_VALUE) + 1, 0),
+            m_count(0),
+            m_sum(0),
+            m_min(UINT64_MAX),
+            m_max(0)
+        {
+        }
+
+        uint32_t LatencyHistogram::getBucket(uint64_t value)
+        {
+            if (value < (1ull << PRECISION_BITS))
+            {
+                return static_cast<uint32_t>(value);
+            }
+
+            // The top PRECISION_BITS bits of the value select the bucket within its power of two
+            uint32_t shift = getHighestBit(value) - (PRECISION_BITS - 1);
+            return (shift * SUB_BUCKETS) + static_cast<uint32_t>(value >> shift);
+        }
+
+        uint64_t LatencyHistogram::getBucketEnd(uint32_t bucket)
+        {
+            if (bucket < (1u << PRECISION_BITS))
+            {
+                return bucket;
+            }
+
+            uint32_t shift = (bucket / SUB_BUCKETS) - 1;
+            uint64_t mantissa = bucket - (shift * SUB_BUCKETS);
+            return ((mantissa + 1) << shift) - 1;
+        }
+
+        void LatencyHistogram::add(const std::chrono::nanoseconds &value)
+        {
+            uint64_t ns = std::min<uint64_t>(std::max<int64_t>(value.count(), 0), MAX_VALUE);
+
+            ++m_buckets[getBucket(ns)];
+            ++m_count;
+            m_sum += ns;
+            m_min = std::min(m_min, ns);
+            m_max = std::max(m_max, ns);
+        }
+
+        void LatencyHistogram::merge(const LatencyHistogram &other)
+        {
+            for (size_t i = 0; i < m_buckets.size(); ++i)
+            {
+                m_buckets[i] += other.m_buckets[i];
+            }
+
+            m_count += other.m_count;
+            m_sum += other.m_sum;
+            m_min = std::min(m_min, other.m_min);
+            m_max = std::max(m_max, other.m_max);
+        }
+
+        void LatencyHistogram::clear()
+        {
+            std::fill(m_buckets.begin(), m_buckets.end(), 0);
+            m_count = 0;
+            m_sum = 0;
+            m_min = UINT64_MAX;
+            m_max = 0;
+        }
+
+        uint64_t LatencyHistogram::getCount() const
+        {
+            return m_count;
+        }
+
+        std::chrono::nanoseconds LatencyHistogram::getMin() const
+        {
+            return std::chrono::nanoseconds((m_count == 0) ? 0 : m_min);
+        }
+
+        std::chrono::nanoseconds LatencyHistogram::getMax() const
+        {
+            return std::chrono::nanoseconds(m_max);
+        }
+
+        std::chrono::nanoseconds LatencyHistogram::getMean() const
+        {
+            return std::chrono::nanoseconds((m_count == 0) ? 0 : m_sum / m_count);
+        }
+
+        std::chrono::nanoseconds LatencyHistogram::getPercentile(double percentile) const
+        {
+            if (m_count == 0)
+            {
+                return std::chrono::nanoseconds(0);
+            }
+
+            // Rank of the value, 1 based
+            uint64_t rank = static_cast<uint64_t>(std::ceil(std::clamp(percentile, 0.0, 100.0) / 100.0 * m_count));
+            rank = std::max<uint64_t>(rank, 1);
+
+            uint64_t seen = 0;
+            for (uint32_t bucket = 0; bucket < m_buckets.size(); ++bucket)
+            {
+                seen += m_buckets[bucket];
+
+                if (seen >= rank)
+                {
+                    return std::chrono::nanoseconds(std::clamp(getBucketEnd(bucket), m_min, m_max));
+                }
+            }
+
+            return std::chrono::nanoseconds(m_max);
+        }
+
+        std::string LatencyHistogram::toString() const
+        {
+            auto us = [](const std::chrono::nanoseconds &value) { return value.count() / 1000.0; };
+
+            char summary[256];
+            std::snprintf(summary, sizeof(summary),
+                "count: %llu, min: %.1fus, mean: %.1fus, p50: %.1fus, p99: %.1fus, p99.9: %.1fus, max: %.1fus",
+                static_cast<unsigned long long>(m_count),
+                us(getMin()),
+                us(getMean()),
+                us(getPercentile(50)),
+                us(getPercentile(99)),
+                us(getPercentile(99.9)),
+                us(getMax()));
+
+            return summary;
+        }
+    }
+}
@@ -0,0 +1,119 @@
+/**
+ * @file MessageTracer.cpp
+ *
+ * @author Nicolae Natea
+ * Contact: nicu@natea.ro
+ */
+
+#include <util/network/MessageTracer.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <random>
+
+namespace util
+{
+    namespace network
+    {
+        MessageTracer::MessageTracer(uint32_t nodeId) :
+            m_nodeId(nodeId)
+        {
+        }
+
+        uint32_t MessageTracer::makeNodeId()
+        {
+            return std::random_device()();
+        }
+
+        uint64_t MessageTracer::now()
+        {
+            return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now().time_since_epoch()).count();
+        }
+
+        uint32_t MessageTracer::getNodeId() const
+        {
+            return m_nodeId;
+        }
+
+        MessageTrace MessageTracer::start(std::string_view id)
+        {
+            uint32_t sequence;
+            {
+                std::scoped_lock<std::mutex> lock(m_mutex);
+                sequence = m_sequences[std::string(id)]++;
+            }
+
+            uint64_t time = now();
+            return MessageTrace{m_nodeId, sequence, time, time, 0};
+        }
+
+        MessageTrace MessageTracer::forward(const MessageTrace &trace) const
+        {
+            MessageTrace forwarded = trace;
+            forwarded.sendTime = now();
+            forwarded.hops = static_cast<uint16_t>(std::min<uint32_t>(trace.hops + 1, UINT16_MAX));
+
+            return forwarded;
+        }
+
+        void MessageTracer::receive(std::string_view id, const MessageTrace &trace)
+        {
+            uint64_t time = now();
+            std::string key(id);
+
+            std::scoped_lock<std::mutex> lock(m_mutex);
+
+            TraceStatistics &statistics = m_statistics[key];
+            statistics.hopLatency.add(std::chrono::nanoseconds(static_cast<int64_t>(time - trace.sendTime)));
+            statistics.latency.add(std::chrono::nanoseconds(static_cast<int64_t>(time - trace.originTime)));
+            statistics.maxHops = std::max(statistics.maxHops, trace.hops);
+            ++statistics.received;
+
+            auto expected = m_expected.try_emplace(std::make_pair(trace.origin, std::move(key)), trace.sequence);
+            uint32_t &next = expected.first->second;
+
+            // A sequence starting over is a restarted origin, anything else behind is late
+            if ((trace.sequence == 0) or (trace.sequence >= next))
+            {
+                statistics.gaps += trace.sequence - std::min(trace.sequence, next);
+                next = trace.sequence + 1;
+            }
+            else
+            {
+                ++statistics.reordered;
+            }
+        }
+
+        std::map<std::string, TraceStatistics> MessageTracer::getStatistics() const
+        {
+            std::scoped_lock<std::mutex> lock(m_mutex);
+            return m_statistics;
+        }
+
+        std::string MessageTracer::toString() const
+        {
+            std::scoped_lock<std::mutex> lock(m_mutex);
+
+            std::string summary;
+            for (auto &entry : m_statistics)
+            {
+                const TraceStatistics &statistics = entry.second;
+
+                if (not summary.empty())
+                {
+                    summary += "\n";
+                }
+
+                summary += "[" + entry.first + "] received: " + std::to_string(statistics.received) +
+                    ", gaps: " + std::to_string(statistics.gaps) +
+                    ", reordered: " + std::to_string(statistics.reordered) +
+                    ", max hops: " + std::to_string(statistics.maxHops) +
+                    "; last hop " + statistics.hopLatency.toString() +
+                    "; from origin " + statistics.latency.toString();
+            }
+
+            return summary;
+        }
+    }
+}
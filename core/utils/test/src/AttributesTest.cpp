@@ -0,0 +1,105 @@
+/**
+ * @file AttributesTest.cpp
+ *
+ * @author Nicolae Natea
+ * Contact: nicu@natea.ro
+ */
+
+#include <array>
+#include <memory>
+#include <string>
+
+#include <gtest/gtest.h>
+
+#include <core/util/Attributes.hpp>
+#include <core/util/SharedBuffer.hpp>
+
+TEST(AttributesTest, SetAndGet)
+{
+    core::util::Attributes attrs;
+    attrs.set("id", 42u).set("name", std::string("cube"));
+
+    EXPECT_EQ(2u, attrs.count());
+    EXPECT_EQ(42u, attrs.get<uint32_t>("id"));
+    EXPECT_EQ("cube", attrs.get<std::string>("name"));
+
+    attrs.set("id", 7u);
+    EXPECT_EQ(2u, attrs.count());
+    EXPECT_EQ(7u, attrs.get<uint32_t>("id"));
+}
+
+TEST(AttributesTest, MissingKeyOrWrongType)
+{
+    core::util::Attributes attrs("id", 42u);
+    std::optional<std::string> name;
+
+    EXPECT_THROW(attrs.get<uint32_t>("missing"), std::out_of_range);
+    EXPECT_THROW(attrs.get<std::string>("id"), std::bad_any_cast);
+    EXPECT_FALSE(attrs.get_optional("id", name));
+    EXPECT_FALSE(attrs.get_optional("missing", name));
+}
+
+TEST(AttributesTest, LargeAndSharedValues)
+{
+    std::array<uint64_t, 16> large;
+    large.fill(3);
+    auto shared = std::make_shared<int>(5);
+
+    core::util::Attributes attrs;
+    attrs.set("large", large).set("shared", shared);
+
+    core::util::Attributes copy = attrs;
+    EXPECT_EQ(3u, copy.get<decltype(large)>("large")[15]);
+    EXPECT_EQ(3, shared.use_count());
+
+    core::util::Attributes moved = std::move(copy);
+    EXPECT_EQ(3, shared.use_count());
+    EXPECT_EQ(5, *moved.get<std::shared_ptr<int>>("shared"));
+}
+
+TEST(AttributesTest, Iteration)
+{
+    core::util::Attributes attrs;
+    attrs.set("a", 1).set("b", 2).set("c", 3).set("d", 4).set("e", 5);
+
+    int sum = 0;
+    std::string keys;
+    for (const auto &entry : attrs)
+    {
+        keys += entry.key();
+        sum += entry.value().get<int>();
+    }
+
+    EXPECT_EQ("abcde", keys);
+    EXPECT_EQ(15, sum);
+}
+
+TEST(AttributesTest, IterationFollowsInsertionOrder)
+{
+    core::util::Attributes attrs;
+    attrs.set("c", 1).set("a", 2).set("b", 3).set("a", 4);
+
+    std::string keys;
+    for (const auto &entry : attrs)
+    {
+        keys += entry.key();
+    }
+
+    // Setting a key again keeps its place
+    EXPECT_EQ("cab", keys);
+    EXPECT_EQ(4, attrs.get<int>("a"));
+}
+
+TEST(AttributesTest, SharedPayloadIsNotCopied)
+{
+    core::util::SharedBuffer payload(std::string(1024, 'x'));
+    const char *bytes = payload.data();
+
+    core::util::Attributes attrs("data", payload);
+    core::util::Attributes copy = attrs;
+
+    core::util::SharedBuffer received = copy.get<core::util::SharedBuffer>("data");
+    EXPECT_EQ(bytes, received.data());
+    EXPECT_EQ(1024u, received.size());
+    EXPECT_EQ(4, payload.useCount());
+}
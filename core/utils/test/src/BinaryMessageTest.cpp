@@ -0,0 +1,211 @@
+/**
+ * @file BinaryMessageTest.cpp
+ *
+ * @author Nicolae Natea
+ * Contact: nicu@natea.ro
+ */
+
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include <util/network/BinaryMessage.hpp>
+#include <util/network/MessageCodec.hpp>
+
+using util::network::BinaryMessage;
+using util::network::BinaryMessageView;
+
+TEST(BinaryMessageTest, EncodeDecode)
+{
+    char buffer[64];
+    size_t size = BinaryMessage::encode("updateCube", "payload", buffer, sizeof(buffer));
+    ASSERT_EQ(BinaryMessage::encodedSize(10, 7), size);
+    EXPECT_TRUE(BinaryMessage::isBinary(buffer, size));
+    EXPECT_EQ(size, BinaryMessage::frameSize(buffer, size));
+
+    BinaryMessageView view;
+    size_t consumed;
+    ASSERT_EQ(BinaryMessage::Status::OK, BinaryMessage::decode(buffer, size, view, consumed));
+    EXPECT_EQ(size, consumed);
+    EXPECT_EQ("updateCube", view.id);
+    EXPECT_EQ("payload", view.payload);
+}
+
+TEST(BinaryMessageTest, IncompleteAndCorrupted)
+{
+    char buffer[64];
+    size_t size = BinaryMessage::encode("id", "data", buffer, sizeof(buffer));
+
+    BinaryMessageView view;
+    size_t consumed;
+    EXPECT_EQ(BinaryMessage::Status::INCOMPLETE, BinaryMessage::decode(buffer, 4, view, consumed));
+    EXPECT_EQ(BinaryMessage::Status::INCOMPLETE, BinaryMessage::decode(buffer, size - 1, view, consumed));
+
+    buffer[size - 1] ^= 0x01;
+    EXPECT_EQ(BinaryMessage::Status::INVALID, BinaryMessage::decode(buffer, size, view, consumed));
+    EXPECT_EQ(0u, BinaryMessage::encode("id", "data", buffer, size - 1));
+}
+
+TEST(BinaryMessageTest, OtherVersionIsRejected)
+{
+    char buffer[64];
+    size_t size = BinaryMessage::encode(BinaryMessage::HELLO_ID, "", buffer, sizeof(buffer));
+
+    // Frames of peers that predate the extensions
+    buffer[1] = static_cast<char>(BinaryMessage::VERSION - 1);
+
+    BinaryMessageView view;
+    size_t consumed;
+    EXPECT_EQ(BinaryMessage::Status::INVALID, BinaryMessage::decode(buffer, size, view, consumed));
+    EXPECT_THROW(util::network::MessageCodec::decode(buffer, size,
+        [](std::string_view, std::string_view, util::network::WireFormat) {}), std::invalid_argument);
+}
+
+TEST(BinaryMessageTest, CodecAcceptsBothFormats)
+{
+    std::vector<std::string> received;
+    auto handler = [&received](std::string_view id, std::string_view payload, util::network::WireFormat format)
+    {
+        received.push_back(std::string(id) + "=" + std::string(payload));
+    };
+
+    std::string text = *util::network::MessageCodec::encode(util::network::WireFormat::TEXT, "a", "1");
+    EXPECT_EQ(text.size(), util::network::MessageCodec::decode(text.data(), text.size(), handler));
+
+    std::string binary = *util::network::MessageCodec::encode(util::network::WireFormat::BINARY, "b", "2");
+    binary += *util::network::MessageCodec::encode(util::network::WireFormat::BINARY, "c", "3");
+    EXPECT_EQ(binary.size(), util::network::MessageCodec::decode(binary.data(), binary.size(), handler));
+
+    ASSERT_EQ(3u, received.size());
+    EXPECT_EQ("a=1", received[0]);
+    EXPECT_EQ("b=2", received[1]);
+    EXPECT_EQ("c=3", received[2]);
+}
+
+TEST(BinaryMessageTest, CodecRejectsCoalescedText)
+{
+    size_t count = 0;
+    auto handler = [&count](std::string_view, std::string_view, util::network::WireFormat) { ++count; };
+
+    std::string text = *util::network::MessageCodec::encode(util::network::WireFormat::TEXT, "a", "1") + "\n";
+    EXPECT_EQ(text.size(), util::network::MessageCodec::decode(text.data(), text.size(), handler));
+
+    // Nothing of a read holding several archives is delivered
+    text += text;
+    EXPECT_THROW(util::network::MessageCodec::decode(text.data(), text.size(), handler), std::invalid_argument);
+    EXPECT_EQ(1u, count);
+}
+
+TEST(BinaryMessageTest, TraceRoundTrip)
+{
+    util::network::MessageTrace trace{0xDEADBEEF, 42, 0x0123456789ABCDEFull, 0xFEDCBA9876543210ull, 3};
+    util::network::MessageExtensions extensions{trace, std::nullopt};
+
+    char buffer[128];
+    size_t size = BinaryMessage::encode("updateCube", "payload", buffer, sizeof(buffer), 0, extensions);
+    ASSERT_EQ(BinaryMessage::encodedSize(10, 7, BinaryMessage::TRACE_SIZE), size);
+    EXPECT_EQ(size, BinaryMessage::frameSize(buffer, size));
+
+    BinaryMessageView view;
+    size_t consumed;
+    ASSERT_EQ(BinaryMessage::Status::OK, BinaryMessage::decode(buffer, size, view, consumed));
+    EXPECT_EQ(size, consumed);
+    EXPECT_EQ("updateCube", view.id);
+    EXPECT_EQ("payload", view.payload);
+    EXPECT_TRUE(view.flags & BinaryMessage::FLAG_TRACE);
+    ASSERT_TRUE(view.extensions.trace.has_value());
+    EXPECT_EQ(trace.origin, view.extensions.trace->origin);
+    EXPECT_EQ(trace.sequence, view.extensions.trace->sequence);
+    EXPECT_EQ(trace.originTime, view.extensions.trace->originTime);
+    EXPECT_EQ(trace.sendTime, view.extensions.trace->sendTime);
+    EXPECT_EQ(trace.hops, view.extensions.trace->hops);
+    EXPECT_FALSE(view.extensions.presentAt.has_value());
+
+    // Reusing the view for an untraced frame clears the trace
+    size = BinaryMessage::encode("id", "data", buffer, sizeof(buffer));
+    ASSERT_EQ(BinaryMessage::Status::OK, BinaryMessage::decode(buffer, size, view, consumed));
+    EXPECT_FALSE(view.extensions.trace.has_value());
+}
+
+TEST(BinaryMessageTest, PresentationTimeRoundTrip)
+{
+    util::network::MessageExtensions extensions{std::nullopt, 0x1122334455667788ull};
+
+    char buffer[128];
+    size_t size = BinaryMessage::encode("updateCube", "payload", buffer, sizeof(buffer), 0, extensions);
+    ASSERT_EQ(BinaryMessage::encodedSize(10, 7, BinaryMessage::PRESENTATION_SIZE), size);
+
+    BinaryMessageView view;
+    size_t consumed;
+    ASSERT_EQ(BinaryMessage::Status::OK, BinaryMessage::decode(buffer, size, view, consumed));
+    EXPECT_EQ("updateCube", view.id);
+    EXPECT_EQ("payload", view.payload);
+    EXPECT_FALSE(view.extensions.trace.has_value());
+    ASSERT_TRUE(view.extensions.presentAt.has_value());
+    EXPECT_EQ(0x1122334455667788ull, *view.extensions.presentAt);
+
+    // Both extensions, the presentation time follows the trace
+    extensions.trace = util::network::MessageTrace{1, 2, 3, 4, 5};
+    size = BinaryMessage::encode("id", "data", buffer, sizeof(buffer), 0, extensions);
+    ASSERT_EQ(BinaryMessage::encodedSize(2, 4, BinaryMessage::TRACE_SIZE + BinaryMessage::PRESENTATION_SIZE), size);
+    ASSERT_EQ(BinaryMessage::Status::OK, BinaryMessage::decode(buffer, size, view, consumed));
+    EXPECT_EQ("id", view.id);
+    EXPECT_EQ("data", view.payload);
+    ASSERT_TRUE(view.extensions.trace.has_value());
+    EXPECT_EQ(2u, view.extensions.trace->sequence);
+    ASSERT_TRUE(view.extensions.presentAt.has_value());
+    EXPECT_EQ(0x1122334455667788ull, *view.extensions.presentAt);
+}
+
+TEST(BinaryMessageTest, UnknownExtensionIsSkipped)
+{
+    util::network::MessageExtensions extensions{util::network::MessageTrace{1, 2, 3, 4, 5}, std::nullopt};
+
+    char buffer[64];
+    size_t size = BinaryMessage::encode("id", "data", buffer, sizeof(buffer), 0, extensions);
+
+    // Same extension, flag unknown to the receiver
+    BinaryMessage::put16(buffer + 2, 0x8000);
+
+    BinaryMessageView view;
+    size_t consumed;
+    ASSERT_EQ(BinaryMessage::Status::OK, BinaryMessage::decode(buffer, size, view, consumed));
+    EXPECT_EQ("id", view.id);
+    EXPECT_EQ("data", view.payload);
+    EXPECT_FALSE(view.extensions.trace.has_value());
+
+    // Trace announced without room for it
+    BinaryMessage::put16(buffer + 2, BinaryMessage::FLAG_TRACE);
+    BinaryMessage::put16(buffer + 6, 4);
+    EXPECT_EQ(BinaryMessage::Status::INVALID, BinaryMessage::decode(buffer, size, view, consumed));
+}
+
+TEST(BinaryMessageTest, CodecHandsTraceOver)
+{
+    util::network::MessageExtensions extensions{util::network::MessageTrace{7, 8, 9, 10, 1}, std::nullopt};
+    std::vector<std::string> received;
+
+    auto handler = [&received](
+        std::string_view id,
+        std::string_view payload,
+        util::network::WireFormat format,
+        const util::network::MessageExtensions &extensions)
+    {
+        received.push_back(std::string(id) + "=" +
+            (extensions.trace ? std::to_string(extensions.trace->sequence) : "none"));
+    };
+
+    std::string binary = *util::network::MessageCodec::encode(util::network::WireFormat::BINARY, "a", "1", extensions);
+    binary += *util::network::MessageCodec::encode(util::network::WireFormat::BINARY, "b", "2");
+    EXPECT_EQ(binary.size(), util::network::MessageCodec::decode(binary.data(), binary.size(), handler));
+
+    // Text archives have no room for it
+    std::string text = *util::network::MessageCodec::encode(util::network::WireFormat::TEXT, "c", "3", extensions);
+    EXPECT_EQ(text.size(), util::network::MessageCodec::decode(text.data(), text.size(), handler));
+
+    ASSERT_EQ(3u, received.size());
+    EXPECT_EQ("a=8", received[0]);
+    EXPECT_EQ("b=none", received[1]);
+    EXPECT_EQ("c=none", received[2]);
+}
@@ -0,0 +1,74 @@
+/**
+ * @file ClockOffsetEstimatorTest.cpp
+ *
+ * @author Nicolae Natea
+ * Contact: nicu@natea.ro
+ */
+
+#include <gtest/gtest.h>
+
+#include <util/network/ClockOffsetEstimator.hpp>
+
+using util::network::ClockOffsetEstimator;
+
+namespace
+{
+    /** Exchange with a remote clock ahead by offset, each direction taking its own time */
+    bool exchange(ClockOffsetEstimator &estimator, uint64_t t1, int64_t offset, uint64_t there, uint64_t back)
+    {
+        uint64_t t2 = t1 + there + offset;
+        uint64_t t3 = t2 + 10;
+        uint64_t t4 = t3 - offset + back;
+
+        return estimator.add(t1, t2, t3, t4);
+    }
+}
+
+TEST(ClockOffsetEstimatorTest, SymmetricExchangeIsExact)
+{
+    ClockOffsetEstimator estimator;
+    EXPECT_FALSE(estimator.isSynchronized());
+    EXPECT_EQ(0, estimator.getOffset().count());
+
+    ASSERT_TRUE(exchange(estimator, 100, 1000000, 50, 50));
+    EXPECT_TRUE(estimator.isSynchronized());
+    EXPECT_EQ(1000000, estimator.getOffset().count());
+    EXPECT_EQ(100, estimator.getDelay().count());
+
+    EXPECT_EQ(1005000u, estimator.toRemote(5000));
+    EXPECT_EQ(5000u, estimator.toLocal(1005000));
+}
+
+TEST(ClockOffsetEstimatorTest, SmallestRoundTripWins)
+{
+    ClockOffsetEstimator estimator(2);
+
+    ASSERT_TRUE(exchange(estimator, 100, -5000, 50, 50));
+
+    // A request queued on the way is off by half the queuing delay
+    ASSERT_TRUE(exchange(estimator, 1000, -5000, 450, 50));
+    EXPECT_EQ(-5000, estimator.getOffset().count());
+
+    // Out of the window, the estimate comes from the queued one
+    ASSERT_TRUE(exchange(estimator, 2000, -5000, 850, 50));
+    EXPECT_EQ(-5000 + 200, estimator.getOffset().count());
+    EXPECT_EQ(500, estimator.getDelay().count());
+
+    EXPECT_EQ(10000u, estimator.toLocal(estimator.toRemote(10000)));
+
+    estimator.reset();
+    EXPECT_FALSE(estimator.isSynchronized());
+}
+
+TEST(ClockOffsetEstimatorTest, InconsistentExchangeIsIgnored)
+{
+    ClockOffsetEstimator estimator;
+
+    // Response sent before the request arrived
+    EXPECT_FALSE(estimator.add(100, 500, 400, 200));
+
+    // Remote took longer than the whole round trip
+    EXPECT_FALSE(estimator.add(100, 500, 700, 200));
+
+    EXPECT_FALSE(estimator.isSynchronized());
+}
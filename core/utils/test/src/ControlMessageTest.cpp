@@ -0,0 +1,37 @@
+/**
+ * @file ControlMessageTest.cpp
+ *
+ * @author Nicolae Natea
+ * Contact: nicu@natea.ro
+ */
+
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include <util/network/ControlMessage.hpp>
+
+TEST(ControlMessageTest, ListRoundTrip)
+{
+    std::vector<std::string> topics = {"updateCube", "cubeState", "NETWORK_BROADCAST"};
+
+    std::string payload = util::network::ControlMessage::encodeList(topics);
+
+    EXPECT_EQ(topics, util::network::ControlMessage::decodeList(payload));
+}
+
+TEST(ControlMessageTest, EmptySet)
+{
+    std::string payload = util::network::ControlMessage::encodeList({});
+
+    EXPECT_TRUE(payload.empty());
+    EXPECT_TRUE(util::network::ControlMessage::decodeList(payload).empty());
+}
+
+TEST(ControlMessageTest, SkipsEmptyLines)
+{
+    std::vector<std::string> expected = {"updateCube", "cubeState"};
+
+    EXPECT_EQ(expected, util::network::ControlMessage::decodeList("\nupdateCube\n\ncubeState"));
+}
@@ -0,0 +1,133 @@
+/**
+ * @file DatagramTest.cpp
+ *
+ * @author Nicolae Natea
+ * Contact: nicu@natea.ro
+ */
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include <util/network/Datagram.hpp>
+
+namespace
+{
+    std::vector<std::string> fragment(uint32_t sequence, const std::string &frame, size_t mtu)
+    {
+        std::vector<std::string> datagrams;
+
+        util::network::Datagram::fragment(sequence, frame, mtu,
+            [&datagrams](std::string_view header, std::string_view data)
+            {
+                datagrams.push_back(std::string(header).append(data));
+            });
+
+        return datagrams;
+    }
+
+    /** Adds the datagrams and collects the frames handed out */
+    std::vector<std::string> add(util::network::DatagramReassembler &reassembler, const std::vector<std::string> &datagrams)
+    {
+        std::vector<std::string> frames;
+
+        for (const std::string &datagram : datagrams)
+        {
+            reassembler.add(datagram.data(), datagram.size(),
+                [&frames](std::string_view frame) { frames.emplace_back(frame); });
+        }
+
+        return frames;
+    }
+}
+
+TEST(DatagramTest, FragmentsFitTheMtu)
+{
+    std::string frame(1000, 'a');
+
+    std::vector<std::string> datagrams = fragment(1, frame, 300);
+
+    ASSERT_EQ(4u, datagrams.size());
+    for (const std::string &datagram : datagrams)
+    {
+        EXPECT_LE(datagram.size(), 300u);
+    }
+}
+
+TEST(DatagramTest, ReassemblesReorderedFragments)
+{
+    util::network::DatagramReassembler reassembler(4096);
+    std::string frame;
+    for (int i = 0; i < 1000; ++i)
+    {
+        frame.push_back(static_cast<char>(i));
+    }
+
+    std::vector<std::string> datagrams = fragment(7, frame, 128);
+    std::reverse(datagrams.begin(), datagrams.end());
+    datagrams.push_back(datagrams.front()); // duplicate
+
+    std::vector<std::string> frames = add(reassembler, datagrams);
+
+    ASSERT_EQ(1u, frames.size());
+    EXPECT_EQ(frame, frames[0]);
+
+    uint32_t from, to;
+    EXPECT_FALSE(reassembler.takeGap(from, to));
+}
+
+TEST(DatagramTest, ReportsSkippedFrames)
+{
+    util::network::DatagramReassembler reassembler(4096);
+
+    add(reassembler, fragment(10, "first", 128));
+    std::vector<std::string> lost = fragment(11, std::string(300, 'b'), 128);
+    add(reassembler, {lost[0]});
+    std::vector<std::string> frames = add(reassembler, fragment(13, "last", 128));
+
+    ASSERT_EQ(1u, frames.size());
+    EXPECT_EQ("last", frames[0]);
+
+    uint32_t from, to;
+    ASSERT_TRUE(reassembler.takeGap(from, to));
+    EXPECT_EQ(11u, from);
+    EXPECT_EQ(12u, to);
+    EXPECT_FALSE(reassembler.takeGap(from, to));
+
+    // The rest of the abandoned frame arrives too late
+    lost.erase(lost.begin());
+    EXPECT_TRUE(add(reassembler, lost).empty());
+}
+
+TEST(DatagramTest, DropsStaleFrames)
+{
+    util::network::DatagramReassembler reassembler(4096);
+
+    add(reassembler, fragment(5, "new", 128));
+
+    EXPECT_TRUE(add(reassembler, fragment(4, "old", 128)).empty());
+}
+
+TEST(DatagramTest, FollowsSenderRestart)
+{
+    util::network::DatagramReassembler reassembler(4096);
+
+    add(reassembler, fragment(100000, "before", 128));
+    std::vector<std::string> frames = add(reassembler, fragment(0, "after", 128));
+
+    ASSERT_EQ(1u, frames.size());
+    EXPECT_EQ("after", frames[0]);
+}
+
+TEST(DatagramTest, RejectsInvalidDatagrams)
+{
+    util::network::DatagramReassembler reassembler(16);
+    std::string garbage(40, 'x');
+    std::vector<std::string> tooLarge = fragment(1, std::string(100, 'a'), 128);
+
+    EXPECT_FALSE(reassembler.add(garbage.data(), garbage.size(), [](std::string_view) {}));
+    EXPECT_FALSE(reassembler.add(tooLarge[0].data(), tooLarge[0].size(), [](std::string_view) {}));
+    EXPECT_EQ(2u, reassembler.getInvalidCount());
+}
@@ -0,0 +1,66 @@
+/**
+ * @file FramePoolTest.cpp
+ *
+ * @author Nicolae Natea
+ * Contact: nicu@natea.ro
+ */
+
+#include <memory>
+#include <string>
+
+#include <gtest/gtest.h>
+
+#include <util/network/FramePool.hpp>
+
+TEST(FramePoolTest, ReusesReleasedFrames)
+{
+    util::network::FramePool pool(2);
+
+    std::shared_ptr<std::string> first = pool.acquire();
+    first->assign(100, 'a');
+    const char *storage = first->data();
+    first.reset();
+
+    std::shared_ptr<std::string> second = pool.acquire();
+    EXPECT_TRUE(second->empty());
+    EXPECT_GE(second->capacity(), 100u);
+    second->assign(100, 'b');
+    EXPECT_EQ(storage, second->data());
+    EXPECT_EQ(1u, pool.getAllocations());
+}
+
+TEST(FramePoolTest, HeldFramesAreNotHandedOut)
+{
+    util::network::FramePool pool(2);
+
+    std::shared_ptr<std::string> first = pool.acquire();
+    std::shared_ptr<std::string> copy = first;
+    std::shared_ptr<std::string> second = pool.acquire();
+    EXPECT_NE(first, second);
+
+    // Past the pool size frames are still given, only not kept
+    std::shared_ptr<std::string> third = pool.acquire();
+    EXPECT_NE(first, third);
+    EXPECT_NE(second, third);
+    EXPECT_EQ(3u, pool.getAllocations());
+
+    // Still queued somewhere through the copy
+    first.reset();
+    EXPECT_NE(copy, pool.acquire());
+    EXPECT_EQ(4u, pool.getAllocations());
+
+    copy.reset();
+    EXPECT_NE(second, pool.acquire());
+    EXPECT_EQ(4u, pool.getAllocations());
+}
+
+TEST(FramePoolTest, GrownFramesAreReplaced)
+{
+    util::network::FramePool pool(1, 64);
+
+    pool.acquire()->assign(1024, 'x');
+
+    std::shared_ptr<std::string> frame = pool.acquire();
+    EXPECT_LT(frame->capacity(), 1024u);
+    EXPECT_EQ(2u, pool.getAllocations());
+}
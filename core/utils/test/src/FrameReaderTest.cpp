@@ -0,0 +1,86 @@
+/**
+ * @file FrameReaderTest.cpp
+ *
+ * @author Nicolae Natea
+ * Contact: nicu@natea.ro
+ */
+
+#include <algorithm>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include <util/network/FrameReader.hpp>
+#include <util/network/MessageCodec.hpp>
+
+namespace
+{
+    std::string encode(const std::string &id, const std::string &payload)
+    {
+        return *util::network::MessageCodec::encode(util::network::WireFormat::BINARY, id, payload);
+    }
+
+    /** Feeds the stream in chunks of the given size and collects the frames */
+    std::vector<std::string> feed(util::network::FrameReader &reader, const std::string &stream, size_t chunk)
+    {
+        std::vector<std::string> frames;
+
+        for (size_t offset = 0; offset < stream.size(); offset += chunk)
+        {
+            size_t size = std::min(chunk, stream.size() - offset);
+            std::memcpy(reader.prepare(), stream.data() + offset, size);
+            reader.commit(size);
+
+            std::string_view frame;
+            while (reader.next(frame))
+            {
+                frames.emplace_back(frame);
+            }
+        }
+
+        return frames;
+    }
+}
+
+TEST(FrameReaderTest, SplitFrames)
+{
+    util::network::FrameReader reader(1024);
+    std::string first = encode("updateCube", std::string(300, 'a'));
+    std::string second = encode("updateLed", "b");
+
+    std::vector<std::string> frames = feed(reader, first + second, 7);
+
+    ASSERT_EQ(2u, frames.size());
+    EXPECT_EQ(first, frames[0]);
+    EXPECT_EQ(second, frames[1]);
+}
+
+TEST(FrameReaderTest, CoalescedFrames)
+{
+    util::network::FrameReader reader(1024);
+    std::string stream;
+
+    for (int i = 0; i < 20; ++i)
+    {
+        stream += encode("id", std::to_string(i));
+    }
+
+    std::vector<std::string> frames = feed(reader, stream, stream.size());
+
+    ASSERT_EQ(20u, frames.size());
+    EXPECT_EQ(encode("id", "19"), frames[19]);
+}
+
+TEST(FrameReaderTest, OversizedFrame)
+{
+    util::network::FrameReader reader(256);
+    std::string frame = encode("id", std::string(512, 'x'));
+
+    std::memcpy(reader.prepare(), frame.data(), util::network::BinaryMessage::HEADER_SIZE);
+    reader.commit(util::network::BinaryMessage::HEADER_SIZE);
+
+    std::string_view view;
+    EXPECT_THROW(reader.next(view), std::length_error);
+}
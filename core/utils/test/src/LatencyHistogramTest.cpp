@@ -0,0 +1,81 @@
+/**
+ * @file LatencyHistogramTest.cpp
+ *
+ * @author Nicolae Natea
+ * Contact: nicu@natea.ro
+ */
+
+#include <chrono>
+
+#include <gtest/gtest.h>
+
+#include <core/util/LatencyHistogram.hpp>
+
+using namespace std::chrono_literals;
+
+TEST(LatencyHistogramTest, EmptyReportsZero)
+{
+    core::util::LatencyHistogram histogram;
+
+    EXPECT_EQ(0u, histogram.getCount());
+    EXPECT_EQ(0ns, histogram.getMin());
+    EXPECT_EQ(0ns, histogram.getMax());
+    EXPECT_EQ(0ns, histogram.getPercentile(99));
+}
+
+TEST(LatencyHistogramTest, SmallValuesAreExact)
+{
+    core::util::LatencyHistogram histogram;
+
+    for (int i = 1; i <= 50; ++i)
+    {
+        histogram.add(std::chrono::nanoseconds(i));
+    }
+
+    EXPECT_EQ(50u, histogram.getCount());
+    EXPECT_EQ(1ns, histogram.getMin());
+    EXPECT_EQ(50ns, histogram.getMax());
+    EXPECT_EQ(25ns, histogram.getPercentile(50));
+    EXPECT_EQ(50ns, histogram.getPercentile(100));
+}
+
+TEST(LatencyHistogramTest, PercentilesWithinPrecision)
+{
+    core::util::LatencyHistogram histogram;
+
+    // 1us .. 1000us, one value each
+    for (int i = 1; i <= 1000; ++i)
+    {
+        histogram.add(std::chrono::microseconds(i));
+    }
+
+    auto near = [](const std::chrono::nanoseconds &value, const std::chrono::nanoseconds &expected)
+    {
+        return (value >= expected) and (value <= expected + expected / 32);
+    };
+
+    EXPECT_TRUE(near(histogram.getPercentile(50), 500us));
+    EXPECT_TRUE(near(histogram.getPercentile(99), 990us));
+    EXPECT_TRUE(near(histogram.getPercentile(99.9), 999us));
+    EXPECT_EQ(1000us, histogram.getPercentile(100));
+    EXPECT_EQ(std::chrono::nanoseconds(500500), histogram.getMean());
+}
+
+TEST(LatencyHistogramTest, MergeAndClear)
+{
+    core::util::LatencyHistogram first;
+    core::util::LatencyHistogram second;
+
+    first.add(10us);
+    second.add(-5us);
+    second.add(20ms);
+    first.merge(second);
+
+    EXPECT_EQ(3u, first.getCount());
+    EXPECT_EQ(0ns, first.getMin());
+    EXPECT_EQ(20ms, first.getMax());
+
+    first.clear();
+    EXPECT_EQ(0u, first.getCount());
+    EXPECT_EQ(0ns, first.getMax());
+}
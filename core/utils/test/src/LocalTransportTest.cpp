@@ -0,0 +1,34 @@
+/**
+ * @file LocalTransportTest.cpp
+ *
+ * @author Nicolae Natea
+ * Contact: nicu@natea.ro
+ */
+
+#include <string>
+
+#include <gtest/gtest.h>
+
+#include <util/network/LocalTransport.hpp>
+
+TEST(LocalTransportTest, DefaultPathIsAbstract)
+{
+    std::string path = util::network::LocalTransport::getDefaultPath(3000);
+
+    EXPECT_EQ("@breadcrumbs-3000", path);
+    EXPECT_TRUE(util::network::LocalTransport::isAbstract(path));
+}
+
+TEST(LocalTransportTest, AbstractNameStartsWithNull)
+{
+    std::string socketPath = util::network::LocalTransport::toSocketPath("@breadcrumbs-3000");
+
+    EXPECT_EQ(std::string("\0breadcrumbs-3000", 17), socketPath);
+}
+
+TEST(LocalTransportTest, FilesystemPathIsKept)
+{
+    EXPECT_FALSE(util::network::LocalTransport::isAbstract("/run/breadcrumbs.sock"));
+    EXPECT_EQ("/run/breadcrumbs.sock", util::network::LocalTransport::toSocketPath("/run/breadcrumbs.sock"));
+    EXPECT_FALSE(util::network::LocalTransport::isAbstract(""));
+}
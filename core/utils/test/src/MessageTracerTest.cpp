@@ -0,0 +1,75 @@
+/**
+ * @file MessageTracerTest.cpp
+ *
+ * @author Nicolae Natea
+ * Contact: nicu@natea.ro
+ */
+
+#include <gtest/gtest.h>
+
+#include <util/network/MessageTracer.hpp>
+
+using util::network::MessageTrace;
+using util::network::MessageTracer;
+
+TEST(MessageTracerTest, StartAndForward)
+{
+    MessageTracer tracer(5);
+
+    MessageTrace first = tracer.start("a");
+    MessageTrace second = tracer.start("a");
+    MessageTrace other = tracer.start("b");
+
+    EXPECT_EQ(5u, first.origin);
+    EXPECT_EQ(0u, first.sequence);
+    EXPECT_EQ(1u, second.sequence);
+    EXPECT_EQ(0u, other.sequence);
+    EXPECT_EQ(0u, first.hops);
+    EXPECT_EQ(first.originTime, first.sendTime);
+
+    MessageTrace forwarded = tracer.forward(first);
+    EXPECT_EQ(first.origin, forwarded.origin);
+    EXPECT_EQ(first.sequence, forwarded.sequence);
+    EXPECT_EQ(first.originTime, forwarded.originTime);
+    EXPECT_GE(forwarded.sendTime, first.sendTime);
+    EXPECT_EQ(1u, forwarded.hops);
+}
+
+TEST(MessageTracerTest, CountsGapsPerOrigin)
+{
+    MessageTracer tracer(1);
+    uint64_t now = MessageTracer::now();
+
+    for (uint32_t sequence : {0u, 1u, 4u, 3u, 5u})
+    {
+        tracer.receive("a", MessageTrace{7, sequence, now, now, 1});
+    }
+
+    // Another origin has its own sequence
+    tracer.receive("a", MessageTrace{8, 10, now, now, 2});
+    tracer.receive("a", MessageTrace{8, 11, now, now, 2});
+
+    auto statistics = tracer.getStatistics();
+    ASSERT_EQ(1u, statistics.count("a"));
+    EXPECT_EQ(7u, statistics["a"].received);
+    EXPECT_EQ(2u, statistics["a"].gaps);
+    EXPECT_EQ(1u, statistics["a"].reordered);
+    EXPECT_EQ(2u, statistics["a"].maxHops);
+    EXPECT_EQ(7u, statistics["a"].hopLatency.getCount());
+    EXPECT_EQ(7u, statistics["a"].latency.getCount());
+}
+
+TEST(MessageTracerTest, RestartedOriginIsNotAGap)
+{
+    MessageTracer tracer(1);
+    uint64_t now = MessageTracer::now();
+
+    for (uint32_t sequence : {0u, 1u, 2u, 0u, 1u})
+    {
+        tracer.receive("a", MessageTrace{7, sequence, now, now, 0});
+    }
+
+    auto statistics = tracer.getStatistics();
+    EXPECT_EQ(0u, statistics["a"].gaps);
+    EXPECT_EQ(0u, statistics["a"].reordered);
+}
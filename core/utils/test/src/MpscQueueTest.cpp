@@ -0,0 +1,127 @@
+/**
+ * @file MpscQueueTest.cpp
+ *
+ * @author Nicolae Natea
+ * Contact: nicu@natea.ro
+ */
+
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include <core/util/MpscQueue.hpp>
+
+TEST(MpscQueueTest, PushPopInOrder)
+{
+    core::util::MpscQueue<int> queue(4);
+
+    EXPECT_TRUE(queue.empty());
+    EXPECT_TRUE(queue.push(1));
+    EXPECT_TRUE(queue.push(2));
+
+    int value = 0;
+    EXPECT_TRUE(queue.pop(value));
+    EXPECT_EQ(1, value);
+    EXPECT_TRUE(queue.pop(value));
+    EXPECT_EQ(2, value);
+    EXPECT_FALSE(queue.pop(value));
+}
+
+TEST(MpscQueueTest, RejectsWhenFull)
+{
+    core::util::MpscQueue<int> queue(3);
+
+    ASSERT_EQ(4u, queue.capacity());
+
+    for (int i = 0; i < 4; ++i)
+    {
+        EXPECT_TRUE(queue.push(i));
+    }
+
+    EXPECT_FALSE(queue.push(4));
+
+    int value = 0;
+    EXPECT_TRUE(queue.pop(value));
+    EXPECT_TRUE(queue.push(4));
+}
+
+TEST(MpscQueueTest, PopBatch)
+{
+    core::util::MpscQueue<int> queue(16);
+    std::vector<int> values;
+
+    for (int i = 0; i < 10; ++i)
+    {
+        queue.push(i);
+    }
+
+    EXPECT_EQ(4u, queue.popBatch(std::back_inserter(values), 4));
+    EXPECT_EQ(6u, queue.popBatch(std::back_inserter(values), 16));
+    ASSERT_EQ(10u, values.size());
+
+    for (int i = 0; i < 10; ++i)
+    {
+        EXPECT_EQ(i, values[i]);
+    }
+}
+
+TEST(MpscQueueTest, WaitTimesOutWhenEmpty)
+{
+    core::util::MpscQueue<int> queue(4);
+
+    EXPECT_FALSE(queue.wait(std::chrono::milliseconds(1)));
+    queue.push(1);
+    EXPECT_TRUE(queue.wait(std::chrono::milliseconds(1)));
+}
+
+TEST(MpscQueueTest, MultipleProducers)
+{
+    const int PRODUCERS = 4;
+    const int ITEMS = 20000;
+
+    core::util::MpscQueue<int> queue(64);
+    std::vector<std::thread> producers;
+
+    for (int p = 0; p < PRODUCERS; ++p)
+    {
+        producers.emplace_back([&queue, p]
+        {
+            for (int i = 0; i < ITEMS; ++i)
+            {
+                while (not queue.push(p * ITEMS + i))
+                {
+                    std::this_thread::yield();
+                }
+            }
+        });
+    }
+
+    // Every producer's items must arrive exactly once and in order
+    std::vector<int> last(PRODUCERS, -1);
+    int received = 0;
+
+    while (received < PRODUCERS * ITEMS)
+    {
+        int value;
+
+        if (not queue.pop(value))
+        {
+            queue.wait(std::chrono::milliseconds(10));
+            continue;
+        }
+
+        int producer = value / ITEMS;
+        EXPECT_GT(value % ITEMS, last[producer]);
+        last[producer] = value % ITEMS;
+        ++received;
+    }
+
+    for (auto &producer : producers)
+    {
+        producer.join();
+    }
+
+    EXPECT_TRUE(queue.empty());
+}
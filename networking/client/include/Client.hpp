@@ -3,6 +3,28 @@
  *
  * @brief Implementation of a network client used
  *        to dispatch messages between systems.
+ *        The connection is handled asynchronously on the client
+ *        io_context; publishers only queue messages. A lost connection
+ *        is reestablished with jittered exponential backoff, after which
+ *        the handshake and subscriptions are sent again. SERVER_CONNECTION
+ *        reports every change, with the time it took to recover.
+ *        Discovered servers are cached with the time they last answered
+ *        and their round trip time, so the list is published right away
+ *        and refreshed in the background; with auto-connect the fastest
+ *        server is used, and another one taken over during an outage.
+ *        Each listed server keeps the id it was first published with, and
+ *        a full list replaces its slowest server with a faster one.
+ *        A server on the same host is reached through its unix domain
+ *        socket, falling back to TCP if it does not offer one.
+ *        Heartbeats measure the round trip time of the connection, which
+ *        SERVER_HEARTBEAT reports and server selection then uses, and
+ *        tear down a connection the server stopped answering on. Their
+ *        answers also carry the server time, from which the offset of the
+ *        server clock is estimated; presentation times of received frames
+ *        are converted to the local clock with it.
+ *        Messages waiting to be written to the server are bounded like
+ *        the queues of the server clients: past the limits the oldest
+ *        are dropped, or the connection is reestablished.
  *
  * @author Nicolae Natea
  * Contact: nicu@natea.ro
@@ -11,22 +33,89 @@
 #ifndef _CORE_NETWORKING_CLIENT_
 #define _CORE_NETWORKING_CLIENT_
 
+#include <atomic>
+#include <chrono>
 #include <cstdint>
+#include <deque>
 #include <memory>
+#include <mutex>
 #include <optional>
+#include <random>
 #include <string>
+#include <string_view>
 #include <thread>
 #include <vector>
 
 #include <boost/asio.hpp>
 
+#include <BatchUdpSocket.hpp>
 #include <core/Component.hpp>
+#include <core/util/EnumCast.hpp>
+#include <util/network/BinaryMessage.hpp>
+#include <util/network/ClockOffsetEstimator.hpp>
+#include <util/network/Datagram.hpp>
+#include <util/network/FramePool.hpp>
+#include <util/network/FrameReader.hpp>
+#include <util/network/MessageTracer.hpp>
 
 namespace networking
 {
+    namespace
+    {
+        const uint32_t DATA_CHANNEL_BATCH_SIZE = 16;
+        const uint32_t DATA_CHANNEL_MAX_DATAGRAM_SIZE = 9000; ///< Jumbo frames
+        const uint32_t DISCOVERY_BATCH_SIZE = 16;
+        const uint32_t DISCOVERY_MAX_DATAGRAM_SIZE = 64;
+        const uint32_t DEFAULT_SERVER_MAX_QUEUED_KB = 1024;
+        const uint32_t DEFAULT_SERVER_MAX_QUEUED_MESSAGES = 256;
+    }
+
+    /** Action taken when the queue towards the server exceeds its limits */
+    enum struct SendQueuePolicy
+    {
+        DROP_OLDEST, ///< Drop the oldest queued messages, control messages are kept
+        DISCONNECT   ///< Close the connection, then reconnect
+    };
+
+    static const core::util::EnumCast<SendQueuePolicy> send_queue_policy_map =
+        core::util::EnumCast<SendQueuePolicy>
+            (SendQueuePolicy::DROP_OLDEST, "drop-oldest")
+            (SendQueuePolicy::DISCONNECT,  "disconnect");
+
     class Client : public core::Component
     {
     private:
+        /** Server which answered discovery */
+        struct DiscoveredServer
+        {
+            uint32_t id;                                ///< Given once, stays valid while the server is listed
+            std::string address;
+            std::chrono::steady_clock::time_point lastSeen;
+            std::chrono::microseconds rtt;
+        };
+
+        /** Multicast data channel, used on the m_ioContext thread once joined */
+        struct DataChannel
+        {
+            DataChannel(boost::asio::io_context &context, size_t maxFrameSize) :
+                socket(context),
+                batch(socket, DATA_CHANNEL_BATCH_SIZE, DATA_CHANNEL_MAX_DATAGRAM_SIZE),
+                reassembler(maxFrameSize)
+            {
+            }
+
+            boost::asio::ip::udp::socket socket;
+            BatchUdpSocket batch;
+            util::network::DatagramReassembler reassembler;
+        };
+
+        /** Message waiting to be written to the server */
+        struct Outgoing
+        {
+            std::shared_ptr<std::string> buf;
+            bool control; ///< Control messages are never dropped
+        };
+
         Client();
         Client(const Client &other);
 
@@ -42,36 +131,144 @@ namespace networking
         void refreshServerList();
         void sendBroadcast(const core::MessageId &id, const core::MessageData &attrs);
 
+        /** Replaces the topics received from the server, "topics" lists them one per line */
+        void updateSubscriptions(const core::MessageData &attrs);
+
     protected:
         void disconnect();
-        void getServerList();
-        void receiveData(std::shared_ptr<boost::asio::ip::tcp::socket> socket);
+        void sendSubscriptions();
+        void sendToServer(
+            std::string_view id,
+            std::string_view payload,
+            const util::network::MessageExtensions &extensions = util::network::MessageExtensions());
+
+        // Discovery, on the m_ioContext thread
+        void sendPing();
+        void receivePongs();
+        void handlePong(const boost::asio::ip::udp::endpoint &sender, std::string_view pong);
+        bool expireServers();
+        void publishServerList();
+
+        /** Connects to the fastest server, or fails over to one which answered during an outage */
+        bool autoConnect();
+
+        // Connection handling, on the m_ioContext thread
+        void connectTo(const boost::asio::ip::tcp::endpoint &endpoint);
+        void connect();
+        void connect(bool local);
+        void handleConnect(const boost::system::error_code &ec);
+        void handleConnectionLost();
+        void scheduleReconnect();
+        void closeConnection();
+        void queue(std::shared_ptr<std::string> buf, bool control = false);
+        void write();
+        void read();
+        void handleRead(const boost::system::error_code &ec, size_t readSize);
+
+        // Heartbeats, on the m_ioContext thread
+        void scheduleHeartbeat();
+        void sendHeartbeat();
+        void handleHeartbeat(std::string_view payload);
+
+        /** Handles a message received from the server */
+        void handleMessage(
+            const std::string &remoteIp,
+            std::string_view id,
+            std::string_view payload,
+            const util::network::MessageExtensions &extensions);
+
+        /** Posts a message received from the server on the bus */
+        void publish(std::string_view id, std::string_view payload, const util::network::MessageExtensions &extensions);
+
+        /** Logs the statistics of the traced messages received so far */
+        void reportTraces();
+
+        /** Receives the multicast topics over the data channel the server offered */
+        void joinMulticast(const std::string &remoteIp, std::string_view payload);
+        void receiveDatagrams(std::shared_ptr<DataChannel> channel);
+
+        /** @return true if the topic is received from the server */
+        bool isSubscribed(std::string_view id);
 
     private:
         static Client _prototype;
 
-        std::thread m_refreshServerListThread;
         std::thread m_broadcastThread;
-        std::thread m_recvData;
 
         std::shared_ptr<boost::asio::io_context> m_ioContext;
         std::unique_ptr<boost::asio::executor_work_guard<boost::asio::io_context::executor_type>> m_workGuard;
 
-        std::vector<std::string> m_detectedServers;
+        // Discovery, used on the m_ioContext thread
+        std::mutex m_serversMutex;
+        std::vector<DiscoveredServer> m_servers;                        ///< At most m_maxNbrOfServers, the slowest is replaced
+        uint32_t m_nextServerId;                                        ///< Id of the next discovered server
+        std::unique_ptr<boost::asio::ip::udp::socket> m_discoverySocket;
+        std::unique_ptr<BatchUdpSocket> m_discoveryBatch;
+        std::unique_ptr<boost::asio::steady_timer> m_discoveryTimer;    ///< End of the current ping
+        std::chrono::steady_clock::time_point m_pingSentAt;
+        uint32_t m_pingId;                                              ///< Echoed back by servers
 
         std::string m_multicastAddress;
         uint16_t m_multicastPort;
 
         uint32_t m_serverRefreshTimeoutMs;
+        uint32_t m_serverTtlMs;                                         ///< Cached servers expire after
         uint32_t m_serverCheckPeriodMs;
         uint32_t m_serverMaxRxMsgSizeKb;
         uint16_t m_serverTcpPort;
-        std::shared_ptr<boost::asio::ip::tcp::socket> m_serverSocket;
         uint8_t m_maxNbrOfServers;
         bool m_autoConnect;
 
+        // Connection, used on the m_ioContext thread
+        std::shared_ptr<boost::asio::generic::stream_protocol::socket> m_serverSocket; ///< Connected or connecting socket
+        std::optional<boost::asio::ip::tcp::endpoint> m_serverEndpoint; ///< Server to stay connected to
+        std::string m_remoteIp;
+        bool m_isLocal;                                                 ///< m_serverSocket is a unix domain socket
+        std::unique_ptr<util::network::FrameReader> m_reader;
+        std::deque<Outgoing> m_writeQueue;                              ///< Front is being written
+        util::network::FramePool m_framePool;                           ///< Encoded messages, reused once written or dropped
+        size_t m_writeQueueBytes;                                       ///< Size of the messages in m_writeQueue
+        uint64_t m_droppedMessages;                                     ///< Dropped from the queue on this connection
+        std::unique_ptr<boost::asio::steady_timer> m_connectTimer;
+        std::unique_ptr<boost::asio::steady_timer> m_reconnectTimer;
+        std::chrono::steady_clock::time_point m_disconnectedAt;         ///< Start of the current outage
+        std::unique_ptr<boost::asio::steady_timer> m_heartbeatTimer;
+        std::chrono::steady_clock::time_point m_lastReceived;           ///< Last data from the server
+        std::optional<std::chrono::microseconds> m_rtt;                 ///< Smoothed round trip time of the connection
+        util::network::ClockOffsetEstimator m_serverClock;              ///< Offset of the server clock, from the heartbeats
+        uint32_t m_connectAttempts;                                     ///< Failed attempts since then
+        std::mt19937 m_random;                                          ///< Reconnect jitter
+        std::atomic<bool> m_isConnected;
+
+        uint32_t m_connectTimeoutMs;
+        bool m_local;                                                   ///< Same host servers are reached over a unix domain socket
+        std::string m_localPath;                                        ///< Its path, '@' for abstract names
+        bool m_reconnect;
+        uint32_t m_reconnectMinMs;
+        uint32_t m_reconnectMaxMs;
+        uint32_t m_heartbeatPeriodMs;                                   ///< No heartbeats if 0
+        uint32_t m_heartbeatTimeoutMs;                                  ///< Silence after which the server is considered dead
+        size_t m_maxQueuedBytes;                                        ///< Bytes waiting to be written to the server
+        size_t m_maxQueuedMessages;                                     ///< Messages waiting to be written to the server
+        SendQueuePolicy m_queuePolicy;                                  ///< Action taken when a bound is exceeded
+
+        util::network::WireFormat m_wireFormat;                 ///< Format offered to the server
+        std::atomic<util::network::WireFormat> m_serverFormat;  ///< Format the server agreed to
+
         std::optional<core::TimerId> m_serverCheckTimer;
 
+        std::mutex m_subscriptionsMutex;
+        std::optional<std::vector<std::string>> m_subscriptions; ///< Topics received from the server, all if unset
+
+        bool m_multicastData;                                         ///< Join the data channel if offered
+        std::shared_ptr<DataChannel> m_dataChannel;                   ///< Joined multicast data channel
+
+        bool m_trace;                                                 ///< Messages carry a MessageTrace, stamped here
+        uint32_t m_traceNodeId;                                       ///< Origin of the messages published here, random if 0
+        uint32_t m_traceReportPeriodMs;                               ///< Statistics are logged on stop only if 0
+        std::unique_ptr<util::network::MessageTracer> m_tracer;       ///< Set by init when m_trace is
+        std::optional<core::TimerId> m_traceReportTimer;
+
         uint32_t m_updateId;
         bool m_isActive;
     };
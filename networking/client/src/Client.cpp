@@ -7,28 +7,78 @@
 
 #include <Client.hpp>
 
+#include <algorithm>
+#include <iterator>
+
 #include <core/logger/event_logger.h>
-#include <util/network/Message.hpp>
+#include <util/network/ControlMessage.hpp>
+#include <util/network/Datagram.hpp>
+#include <util/network/FrameReader.hpp>
+#include <util/network/LocalTransport.hpp>
+#include <util/network/MessageCodec.hpp>
 
 namespace networking
 {
     namespace
     {
         const char *DOMAIN = "Client";
+
+        /** @return true if the address belongs to this host */
+        bool isLocalAddress(boost::asio::io_context &context, const boost::asio::ip::address &address, uint16_t port)
+        {
+            if (address.is_loopback())
+            {
+                return true;
+            }
+
+            // Connecting a UDP socket sends nothing, it only lets the kernel pick
+            // a source address, which is the destination itself when it is local
+            boost::system::error_code error;
+            boost::asio::ip::udp::socket probe(context);
+            probe.open(address.is_v6() ? boost::asio::ip::udp::v6() : boost::asio::ip::udp::v4(), error);
+            probe.connect(boost::asio::ip::udp::endpoint(address, port), error);
+
+            boost::asio::ip::udp::endpoint source = probe.local_endpoint(error);
+            return not error and (source.address() == address);
+        }
     }
 
     Client Client::_prototype;
 
     Client::Client() :
+        m_nextServerId(1),
+        m_pingId(0),
         m_multicastPort(5000),
-        m_serverTcpPort(3000),
         m_serverRefreshTimeoutMs(5000),
+        m_serverTtlMs(15000),
         m_serverCheckPeriodMs(0),
         m_serverMaxRxMsgSizeKb(16),
+        m_serverTcpPort(3000),
         m_maxNbrOfServers(2),
+        m_autoConnect(false),
+        m_isLocal(false),
+        m_writeQueueBytes(0),
+        m_droppedMessages(0),
+        m_connectAttempts(0),
+        m_isConnected(false),
+        m_connectTimeoutMs(2000),
+        m_local(true),
+        m_reconnect(true),
+        m_reconnectMinMs(100),
+        m_reconnectMaxMs(5000),
+        m_heartbeatPeriodMs(1000),
+        m_heartbeatTimeoutMs(3000),
+        m_maxQueuedBytes(DEFAULT_SERVER_MAX_QUEUED_KB * 1024),
+        m_maxQueuedMessages(DEFAULT_SERVER_MAX_QUEUED_MESSAGES),
+        m_queuePolicy(SendQueuePolicy::DROP_OLDEST),
+        m_wireFormat(util::network::WireFormat::BINARY),
+        m_serverFormat(util::network::WireFormat::TEXT),
+        m_multicastData(true),
+        m_trace(false),
+        m_traceNodeId(0),
+        m_traceReportPeriodMs(0),
         m_updateId(0),
-        m_isActive(true),
-        m_autoConnect(false)
+        m_isActive(true)
     {
         addPrototype("Client", this);
     }
@@ -38,12 +88,38 @@ namespace networking
         m_multicastPort          = other.m_multicastPort;
         m_serverTcpPort          = other.m_serverTcpPort;
         m_serverRefreshTimeoutMs = other.m_serverRefreshTimeoutMs;
+        m_serverTtlMs            = other.m_serverTtlMs;
         m_serverCheckPeriodMs    = other.m_serverCheckPeriodMs;
         m_serverMaxRxMsgSizeKb   = other.m_serverMaxRxMsgSizeKb;
         m_maxNbrOfServers        = other.m_maxNbrOfServers;
         m_updateId               = other.m_updateId;
         m_isActive               = other.m_isActive;
         m_autoConnect            = other.m_autoConnect;
+        m_wireFormat             = other.m_wireFormat;
+        m_serverFormat           = util::network::WireFormat::TEXT;
+        m_subscriptions          = other.m_subscriptions;
+        m_multicastData          = other.m_multicastData;
+        m_isConnected            = false;
+        m_connectTimeoutMs       = other.m_connectTimeoutMs;
+        m_local                  = other.m_local;
+        m_localPath              = other.m_localPath;
+        m_isLocal                = false;
+        m_reconnect              = other.m_reconnect;
+        m_reconnectMinMs         = other.m_reconnectMinMs;
+        m_reconnectMaxMs         = other.m_reconnectMaxMs;
+        m_heartbeatPeriodMs      = other.m_heartbeatPeriodMs;
+        m_heartbeatTimeoutMs     = other.m_heartbeatTimeoutMs;
+        m_maxQueuedBytes         = other.m_maxQueuedBytes;
+        m_maxQueuedMessages      = other.m_maxQueuedMessages;
+        m_queuePolicy            = other.m_queuePolicy;
+        m_writeQueueBytes        = 0;
+        m_droppedMessages        = 0;
+        m_connectAttempts        = 0;
+        m_pingId                 = 0;
+        m_nextServerId           = 1;
+        m_trace                  = other.m_trace;
+        m_traceNodeId            = other.m_traceNodeId;
+        m_traceReportPeriodMs    = other.m_traceReportPeriodMs;
     }
 
     Client *Client::clone() const
@@ -61,13 +137,49 @@ namespace networking
         m_multicastPort          = conf.get<uint16_t>("multicast.port", m_multicastPort);
         m_serverTcpPort          = conf.get<uint16_t>("server.tcp.port", m_serverTcpPort);
         m_serverRefreshTimeoutMs = conf.get<uint32_t>("server.max.timeout-ms", m_serverRefreshTimeoutMs);
+        m_serverTtlMs            = conf.get<uint32_t>("server.discovery.ttl-ms", m_serverTtlMs);
         m_serverMaxRxMsgSizeKb   = conf.get<uint32_t>("server.max.rx-size-kb", m_serverMaxRxMsgSizeKb);
         m_maxNbrOfServers        = conf.get<uint8_t>("server.max.count", m_maxNbrOfServers);
         m_serverCheckPeriodMs    = conf.get<uint32_t>("server.check-period-ms", m_serverCheckPeriodMs);
         m_autoConnect            = conf.get<bool>("server.auto-connect", m_autoConnect);
+        m_wireFormat             = util::network::wire_format_map(
+            conf.get<std::string>("server.wire-format", util::network::wire_format_map(m_wireFormat)));
+        m_multicastData          = conf.get<bool>("server.multicast-data.enabled", m_multicastData);
+        m_connectTimeoutMs       = conf.get<uint32_t>("server.connect-timeout-ms", m_connectTimeoutMs);
+        m_local                  = conf.get<bool>("server.local.enabled", m_local);
+        m_localPath              = conf.get<std::string>(
+            "server.local.path", util::network::LocalTransport::getDefaultPath(m_serverTcpPort));
+        m_reconnect              = conf.get<bool>("server.reconnect.enabled", m_reconnect);
+        m_reconnectMinMs         = std::max<uint32_t>(1, conf.get<uint32_t>("server.reconnect.min-delay-ms", m_reconnectMinMs));
+        m_reconnectMaxMs         = std::max(m_reconnectMinMs, conf.get<uint32_t>("server.reconnect.max-delay-ms", m_reconnectMaxMs));
+        m_heartbeatPeriodMs      = conf.get<uint32_t>("server.heartbeat.period-ms", m_heartbeatPeriodMs);
+        m_heartbeatTimeoutMs     = std::max(m_heartbeatPeriodMs, conf.get<uint32_t>("server.heartbeat.timeout-ms", m_heartbeatTimeoutMs));
+        m_maxQueuedBytes         = 1024 * conf.get<size_t>("server.max-queued-kb", m_maxQueuedBytes / 1024);
+        m_maxQueuedMessages      = conf.get<size_t>("server.max-queued-messages", m_maxQueuedMessages);
+        m_queuePolicy            = send_queue_policy_map(
+            conf.get<std::string>("server.slow-policy", send_queue_policy_map(m_queuePolicy)));
+        m_trace                  = conf.get<bool>("trace.enabled", m_trace);
+        m_traceNodeId            = conf.get<uint32_t>("trace.node-id", m_traceNodeId);
+        m_traceReportPeriodMs    = conf.get<uint32_t>("trace.report-period-ms", m_traceReportPeriodMs);
+
+        if (m_wireFormat == util::network::WireFormat::TEXT)
+        {
+            LOG_WARNING(DOMAIN, "Text wire format is deprecated, unframed messages sharing a read are dropped");
+        }
 
         subscribe("CONNECT_TO_SERVER", std::bind(&Client::connectToServer, this, std::placeholders::_1));
         subscribe("REFRESH_SERVER_LIST", std::bind(&Client::refreshServerList, this));
+        subscribe("UPDATE_NETWORK_SUBSCRIPTIONS", std::bind(&Client::updateSubscriptions, this, std::placeholders::_1));
+
+        // Topics wanted from the server; without the list it sends everything
+        if (auto receive = conf.get_child_optional("receive"))
+        {
+            m_subscriptions.emplace();
+            for (auto &topic : *receive)
+            {
+                m_subscriptions->push_back(topic.second.get<std::string>(""));
+            }
+        }
 
         // Broascast message
         boost::property_tree::ptree defaultSubscribe;
@@ -89,6 +201,21 @@ namespace networking
             );
         }
 
+        if (m_trace)
+        {
+            m_tracer = std::make_unique<util::network::MessageTracer>(
+                m_traceNodeId ? m_traceNodeId : util::network::MessageTracer::makeNodeId());
+            LOG_INFO(DOMAIN, "Tracing messages as node %u", m_tracer->getNodeId());
+
+            if (m_traceReportPeriodMs)
+            {
+                m_traceReportTimer = setPeriodicTimer(
+                    [this](const boost::system::error_code &e) { reportTraces(); },
+                    std::chrono::milliseconds{m_traceReportPeriodMs}
+                );
+            }
+        }
+
         LOG_DEBUG(DOMAIN, "Exited %s", __PRETTY_FUNCTION__);
     }
 
@@ -100,6 +227,37 @@ namespace networking
 
         m_workGuard = std::make_unique<boost::asio::executor_work_guard<boost::asio::io_context::executor_type>>(
             m_ioContext->get_executor());
+        m_connectTimer = std::make_unique<boost::asio::steady_timer>(*m_ioContext);
+        m_reconnectTimer = std::make_unique<boost::asio::steady_timer>(*m_ioContext);
+        m_heartbeatTimer = std::make_unique<boost::asio::steady_timer>(*m_ioContext);
+        m_random.seed(std::random_device()());
+
+        // Servers answer the multicast ping to this socket
+        boost::system::error_code error;
+        boost::asio::ip::udp::endpoint discoveryEndpoint(
+            boost::asio::ip::make_address(m_multicastAddress).is_v6() ?
+                boost::asio::ip::udp::v6() : boost::asio::ip::udp::v4(),
+            0);
+        m_discoveryTimer = std::make_unique<boost::asio::steady_timer>(*m_ioContext);
+        m_discoverySocket = std::make_unique<boost::asio::ip::udp::socket>(*m_ioContext);
+        m_discoverySocket->open(discoveryEndpoint.protocol(), error);
+        if (not error)
+        {
+            m_discoverySocket->bind(discoveryEndpoint, error);
+        }
+
+        m_discoveryBatch = std::make_unique<BatchUdpSocket>(
+            *m_discoverySocket, DISCOVERY_BATCH_SIZE, DISCOVERY_MAX_DATAGRAM_SIZE);
+
+        if (error)
+        {
+            LOG_ERROR(DOMAIN, "Unable to open the discovery socket: [%s]", error.message().c_str());
+        }
+        else
+        {
+            receivePongs();
+        }
+
         m_broadcastThread = std::thread(
             [this] { this->m_ioContext->run(); });
 
@@ -114,16 +272,22 @@ namespace networking
 
         m_isActive = false;
 
-        disconnect();
-
-        if (m_serverCheckTimer != std::nullopt)
+        if (m_ioContext)
         {
-            cancelTimer(*m_serverCheckTimer);
+            boost::asio::post(*m_ioContext, [this]
+            {
+                disconnect();
+
+                // Ends the pending receive, so the io_context runs out of work
+                boost::system::error_code error;
+                m_discoveryTimer->cancel();
+                m_discoverySocket->close(error);
+            });
         }
 
-        if (m_refreshServerListThread.joinable())
+        if (m_serverCheckTimer != std::nullopt)
         {
-            m_refreshServerListThread.join();
+            cancelTimer(*m_serverCheckTimer);
         }
 
         m_workGuard.reset();
@@ -133,6 +297,14 @@ namespace networking
             m_broadcastThread.join();
         }
 
+        if (m_traceReportTimer != std::nullopt)
+        {
+            cancelTimer(*m_traceReportTimer);
+            m_traceReportTimer.reset();
+        }
+
+        reportTraces();
+
         LOG_DEBUG(DOMAIN, "Exited %s", __PRETTY_FUNCTION__);
     }
 
@@ -140,253 +312,1026 @@ namespace networking
     {
         LOG_DEBUG(DOMAIN, "Entered %s", __PRETTY_FUNCTION__);
 
-        if (m_isActive and not m_refreshServerListThread.joinable())
+        if (m_isActive and m_ioContext)
         {
-            m_refreshServerListThread = std::thread(
-                [&]
+            boost::asio::post(*m_ioContext, [this]
+            {
+                // The cache is answered right away, the ping only updates it
+                expireServers();
+                if (not m_servers.empty())
                 {
-                    getServerList();
+                    publishServerList();
+                    autoConnect();
+                }
 
-                    // Idea is to make it so that the thread is not joinable anymore
-                    // so that we don't run multiple refreshes at the same time
-                    m_refreshServerListThread.detach();
-                });
+                sendPing();
+            });
         }
 
         LOG_DEBUG(DOMAIN, "Exited %s", __PRETTY_FUNCTION__);
     }
 
-    void Client::getServerList()
+    void Client::sendPing()
     {
-        LOG_DEBUG(DOMAIN, "Entered %s", __PRETTY_FUNCTION__);
+        if (not m_discoverySocket->is_open())
+        {
+            return;
+        }
+
+        // Servers echo the id, so late answers to an older ping are not timed
+        std::string ping = "ping " + std::to_string(++m_pingId);
+        boost::asio::ip::udp::endpoint multicastEndpoint(
+            boost::asio::ip::make_address(m_multicastAddress), m_multicastPort);
+
+        boost::system::error_code error;
+        m_pingSentAt = std::chrono::steady_clock::now();
+        m_discoverySocket->send_to(boost::asio::buffer(ping), multicastEndpoint, 0, error);
 
-        boost::asio::io_context io_context;
-        boost::asio::ip::udp::endpoint multicastEndpoint =
-            boost::asio::ip::udp::endpoint(
-                boost::asio::ip::address::from_string(m_multicastAddress), m_multicastPort);
-        boost::asio::ip::udp::socket socket(io_context, multicastEndpoint.protocol());
-        socket.set_option(boost::asio::ip::udp::socket::reuse_address(true));
-        socket.set_option(boost::asio::ip::multicast::join_group(
-            boost::asio::ip::address::from_string(m_multicastAddress)));
-
-        core::TimerId timer = setOneShotTimer(
-            [this, &socket](const boost::system::error_code &ec)
+        if (error)
+        {
+            LOG_ERROR(DOMAIN, "Unable to send [%s]: [%s]", ping.c_str(), error.message().c_str());
+            return;
+        }
+
+        // Servers which stopped answering are dropped once the ping is over
+        m_discoveryTimer->expires_after(std::chrono::milliseconds(m_serverRefreshTimeoutMs));
+        m_discoveryTimer->async_wait(
+            [this](const boost::system::error_code &ec)
+            {
+                if (not ec and expireServers())
+                {
+                    publishServerList();
+                }
+            });
+    }
+
+    void Client::receivePongs()
+    {
+        m_discoveryBatch->asyncReceive(
+            [this](const boost::system::error_code &ec, size_t count)
+            {
+                if (ec)
+                {
+                    if (ec != boost::asio::error::operation_aborted)
+                    {
+                        LOG_ERROR(DOMAIN, "Discovery stopped: [%s]", ec.message().c_str());
+                    }
+
+                    return;
+                }
+
+                for (size_t i = 0; i < count; ++i)
+                {
+                    handlePong(m_discoveryBatch->getSender(i), m_discoveryBatch->getDatagram(i));
+                }
+
+                receivePongs();
+            });
+    }
+
+    void Client::handlePong(const boost::asio::ip::udp::endpoint &sender, std::string_view pong)
+    {
+        if (pong.substr(0, 4) != "pong")
+        {
+            return;
+        }
+
+        // Servers which do not echo the id are timed against the last ping
+        std::string_view id = pong.substr(4);
+        id.remove_prefix(std::min(id.find_first_not_of(' '), id.size()));
+        bool isTimed = id.empty() or (id == std::to_string(m_pingId));
+
+        std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+        std::chrono::microseconds rtt = std::chrono::duration_cast<std::chrono::microseconds>(now - m_pingSentAt);
+        std::string address = sender.address().to_string();
+        bool isNew = false;
+
+        {
+            std::lock_guard<std::mutex> lock(m_serversMutex);
+
+            auto server = std::find_if(m_servers.begin(), m_servers.end(),
+                [&address](const DiscoveredServer &known) { return known.address == address; });
+
+            if (server != m_servers.end())
+            {
+                server->lastSeen = now;
+                server->rtt = isTimed ? rtt : server->rtt;
+            }
+            else if (m_servers.size() < m_maxNbrOfServers)
             {
-                LOG_DEBUG(DOMAIN, "Timeout on server refresh");
-                if (socket.is_open())
+                m_servers.push_back({m_nextServerId++, address, now, rtt});
+                isNew = true;
+            }
+            else
+            {
+                // A full list only takes servers closer than the slowest one
+                auto slowest = std::max_element(m_servers.begin(), m_servers.end(),
+                    [](const DiscoveredServer &a, const DiscoveredServer &b) { return a.rtt < b.rtt; });
+
+                if (not isTimed or (slowest == m_servers.end()) or (rtt >= slowest->rtt))
                 {
-                    boost::system::error_code err;
-                    socket.shutdown(boost::asio::ip::tcp::socket::shutdown_both, err);
+                    return;
                 }
-            },
-            std::chrono::milliseconds(m_serverRefreshTimeoutMs)
-        );
 
-        socket.send_to(boost::asio::buffer("ping"), multicastEndpoint);
+                LOG_INFO(DOMAIN, "Server [%s] replaces [%s], %lld us instead of %lld us away",
+                    address.c_str(),
+                    slowest->address.c_str(),
+                    static_cast<long long>(rtt.count()),
+                    static_cast<long long>(slowest->rtt.count()));
+
+                *slowest = {m_nextServerId++, address, now, rtt};
+                isNew = true;
+            }
+        }
 
+        LOG_DEBUG(DOMAIN, "Received advertise from: [%s] after %lld us",
+            address.c_str(),
+            static_cast<long long>(rtt.count()));
+
+        if (isNew)
+        {
+            publishServerList();
+        }
+
+        autoConnect();
+    }
+
+    bool Client::expireServers()
+    {
+        std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+        std::lock_guard<std::mutex> lock(m_serversMutex);
+        size_t count = m_servers.size();
+
+        m_servers.erase(
+            std::remove_if(m_servers.begin(), m_servers.end(),
+                [this, now](const DiscoveredServer &server)
+                {
+                    return now - server.lastSeen > std::chrono::milliseconds(m_serverTtlMs);
+                }),
+            m_servers.end());
+
+        return m_servers.size() != count;
+    }
+
+    void Client::publishServerList()
+    {
         core::MessageData attr;
         attr.set<uint32_t>("update_id", ++m_updateId);
-        m_detectedServers.clear();
-        int serverCount = 0;
 
-        while (serverCount < m_maxNbrOfServers)
         {
-            char somedata[16];
-            boost::asio::ip::udp::endpoint destinationEndpoint = multicastEndpoint;
-            size_t bytes = socket.receive_from(
-                boost::asio::buffer(somedata, sizeof(somedata)), destinationEndpoint);
+            std::lock_guard<std::mutex> lock(m_serversMutex);
 
-            if (bytes && strncmp("pong", somedata, 4) == 0)
+            for (const DiscoveredServer &server : m_servers)
             {
-                std::string ipAddress(destinationEndpoint.address().to_string());
-                LOG_DEBUG(DOMAIN, "Received advertise from: [%s]", ipAddress.c_str());
+                attr.set<std::string>(std::to_string(server.id), server.address);
+            }
+        }
 
-                if (std::find(
-                        this->m_detectedServers.begin(),
-                        this->m_detectedServers.end(),
-                        ipAddress) == m_detectedServers.end())
-                {
-                    attr.set<std::string>(std::to_string(serverCount + 1), ipAddress);
-                    this->m_detectedServers.push_back(ipAddress);
+        post("UPDATE_SERVER_LIST", attr);
+    }
+
+    bool Client::autoConnect()
+    {
+        if (not m_autoConnect or not m_isActive or m_isConnected)
+        {
+            return false;
+        }
 
-                    post("UPDATE_SERVER_LIST", attr);
-                    ++serverCount;
+        // Once connecting, only a failed attempt makes another server worth trying
+        bool isRecovering = m_serverEndpoint.has_value();
+        if (isRecovering and (m_serverSocket or (m_connectAttempts == 0)))
+        {
+            return false;
+        }
 
-                    if (m_autoConnect and ((m_serverSocket == nullptr) or not m_serverSocket->is_open()))
-                    {
-                        // Auto connect to the first server in the list
-                        core::MessageData connectDetails;
-                        connectDetails.set<int>("update_id", m_updateId);
-                        connectDetails.set<int>("id", 1);
-                        connectToServer(connectDetails);
-                    }
-                }
+        const DiscoveredServer *best = nullptr;
+
+        for (const DiscoveredServer &server : m_servers)
+        {
+            if (isRecovering and
+                ((server.lastSeen < m_disconnectedAt) or
+                 (server.address == m_serverEndpoint->address().to_string())))
+            {
+                continue;
             }
-            else
+
+            if (not best or (server.rtt < best->rtt))
             {
-                // Probably timeout. exiting.
-                break;
+                best = &server;
             }
         }
 
-        cancelTimer(timer);
-        if (socket.is_open())
+        if (not best)
         {
-            socket.close();
+            return false;
         }
 
-        LOG_DEBUG(DOMAIN, "Exited %s", __PRETTY_FUNCTION__);
+        LOG_INFO(DOMAIN, "Auto connecting to [%s], %lld us away",
+            best->address.c_str(),
+            static_cast<long long>(best->rtt.count()));
+
+        connectTo(boost::asio::ip::tcp::endpoint(boost::asio::ip::make_address(best->address), m_serverTcpPort));
+        return true;
     }
 
     void Client::sendBroadcast(const core::MessageId &id, const core::MessageData &attrs)
     {
         LOG_DEBUG(DOMAIN, "Entered %s", __PRETTY_FUNCTION__);
-        if (not m_isActive or not m_serverSocket or not m_serverSocket->is_open())
+        if (not m_isActive or not m_isConnected)
         {
-            LOG_DEBUG(DOMAIN, "Exited %sactive, [%p] %s",
+            LOG_DEBUG(DOMAIN, "Exited %sactive, %sconnected %s",
                 m_isActive ? "" : "not ",
-                m_serverSocket.get(),
+                m_isConnected ? "" : "not ",
                 __PRETTY_FUNCTION__);
             return;
         }
 
-        util::network::Message message(id, attrs.get<std::string>("data"));
-        std::shared_ptr<std::string> buf = std::make_shared<std::string>(message.toString());
+        // Messages received from another server carry on with their trace, the ones published here start one
+        util::network::MessageExtensions extensions;
+        if (m_tracer)
+        {
+            attrs.get_optional("trace", extensions.trace);
+            extensions.trace = extensions.trace ? m_tracer->forward(*extensions.trace) : m_tracer->start(id);
+        }
 
-        auto broadcast_handler = [this, buf](const boost::system::error_code &error, size_t bytes_sent)
+        // Scheduled frames keep their presentation time, moved to the clock of the server
+        std::optional<std::chrono::steady_clock::time_point> presentAt;
+        attrs.get_optional("present_at", presentAt);
+        if (presentAt and m_serverClock.isSynchronized())
         {
-            if (error)
-            {
-                LOG_ERROR(DOMAIN, "Error[%d] on broadcast.", error.value());
-            }
-        };
-        m_serverSocket->async_send(boost::asio::buffer(*buf), broadcast_handler);
+            extensions.presentAt = m_serverClock.toRemote(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                presentAt->time_since_epoch()).count());
+        }
+
+        sendToServer(id, attrs.get<core::util::SharedBuffer>("data").str(), extensions);
 
         LOG_DEBUG(DOMAIN, "Exited %s", __PRETTY_FUNCTION__);
     }
 
-    void Client::receiveData(std::shared_ptr<boost::asio::ip::tcp::socket> sock)
+    void Client::updateSubscriptions(const core::MessageData &attrs)
     {
         LOG_DEBUG(DOMAIN, "Entered %s", __PRETTY_FUNCTION__);
 
-        std::string data;
-        data.resize(m_serverMaxRxMsgSizeKb * 1024);
-        std::string remoteIp = sock.get()->remote_endpoint().address().to_string().c_str();
-        LOG_INFO(DOMAIN, "Remote[%s]: connected", remoteIp.c_str());
+        {
+            std::scoped_lock<std::mutex> lock(m_subscriptionsMutex);
+            m_subscriptions = util::network::ControlMessage::decodeList(attrs.get<std::string>("topics"));
+        }
+
+        if (m_isActive and m_isConnected)
+        {
+            sendSubscriptions();
+        }
+
+        LOG_DEBUG(DOMAIN, "Exited %s", __PRETTY_FUNCTION__);
+    }
 
-        auto buffer = boost::asio::buffer(data);
+    void Client::sendSubscriptions()
+    {
+        std::string payload;
 
-        while (sock->is_open() and m_isActive)
         {
-            boost::system::error_code error;
-            size_t readSize = sock->read_some(buffer, error);
+            std::scoped_lock<std::mutex> lock(m_subscriptionsMutex);
 
-            if (readSize != 0)
+            if (m_subscriptions == std::nullopt)
             {
-                LOG_DEBUG(DOMAIN, "Remote[%s]: Received %d bytes", remoteIp.c_str(), readSize);
+                return;
             }
-            else if (error == boost::asio::error::eof)
+
+            payload = util::network::ControlMessage::encodeList(*m_subscriptions);
+        }
+
+        sendToServer(util::network::ControlMessage::SUBSCRIBE_ID, payload);
+    }
+
+    void Client::sendToServer(
+        std::string_view id,
+        std::string_view payload,
+        const util::network::MessageExtensions &extensions)
+    {
+        std::shared_ptr<std::string> buf = m_framePool.acquire();
+        util::network::MessageCodec::encode(m_serverFormat, id, payload, *buf, extensions);
+
+        // Control message ids all start with two underscores
+        bool control = (id.substr(0, 2) == "__");
+
+        // Publishers never wait for the network
+        boost::asio::post(*m_ioContext, [this, buf, control] { queue(buf, control); });
+    }
+
+    void Client::queue(std::shared_ptr<std::string> buf, bool control)
+    {
+        if (not m_isConnected)
+        {
+            return;
+        }
+
+        m_writeQueue.push_back(Outgoing{buf, control});
+        m_writeQueueBytes += buf->size();
+
+        // Otherwise picked up when the write in flight completes
+        if (m_writeQueue.size() == 1)
+        {
+            write();
+            return;
+        }
+
+        auto overflow = [this]
+        {
+            return (m_writeQueue.size() > m_maxQueuedMessages) or (m_writeQueueBytes > m_maxQueuedBytes);
+        };
+
+        if (not overflow())
+        {
+            return;
+        }
+
+        if (m_queuePolicy == SendQueuePolicy::DISCONNECT)
+        {
+            LOG_WARNING(DOMAIN, "Remote[%s]: Not keeping up, %zu messages (%zu bytes) queued. Reconnecting",
+                m_remoteIp.c_str(),
+                m_writeQueue.size(),
+                m_writeQueueBytes);
+
+            // Later, the caller may still use the connection
+            m_isConnected = false;
+            boost::asio::post(*m_ioContext,
+                [this, socket = m_serverSocket]
+                {
+                    if (socket == m_serverSocket)
+                    {
+                        handleConnectionLost();
+                    }
+                });
+            return;
+        }
+
+        // Oldest first, the front is being written and control messages are kept
+        uint64_t dropped = 0;
+        for (auto it = std::next(m_writeQueue.begin()); (it != m_writeQueue.end()) and overflow();)
+        {
+            if (it->control)
             {
+                ++it;
                 continue;
             }
-            else
+
+            m_writeQueueBytes -= it->buf->size();
+            it = m_writeQueue.erase(it);
+            ++dropped;
+        }
+
+        if ((dropped != 0) and (m_droppedMessages == 0))
+        {
+            LOG_WARNING(DOMAIN, "Remote[%s]: Not keeping up, dropping messages", m_remoteIp.c_str());
+        }
+
+        m_droppedMessages += dropped;
+    }
+
+    void Client::write()
+    {
+        boost::asio::async_write(
+            *m_serverSocket,
+            boost::asio::buffer(*m_writeQueue.front().buf),
+            [this, socket = m_serverSocket](const boost::system::error_code &ec, size_t bytesSent)
             {
-                LOG_ERROR(DOMAIN, "Remote[%s]: Error on read: [%d]", remoteIp.c_str(), error);
-                break;
+                if (socket != m_serverSocket)
+                {
+                    return;
+                }
+
+                if (ec)
+                {
+                    LOG_ERROR(DOMAIN, "Remote[%s]: Error[%d] on broadcast.", m_remoteIp.c_str(), ec.value());
+                    handleConnectionLost();
+                    return;
+                }
+
+                m_writeQueueBytes -= m_writeQueue.front().buf->size();
+                m_writeQueue.pop_front();
+
+                if (not m_writeQueue.empty())
+                {
+                    write();
+                }
+            });
+    }
+
+    void Client::read()
+    {
+        m_serverSocket->async_read_some(
+            boost::asio::buffer(m_reader->prepare(), m_reader->writable()),
+            [this, socket = m_serverSocket](const boost::system::error_code &ec, size_t readSize)
+            {
+                if (socket == m_serverSocket)
+                {
+                    handleRead(ec, readSize);
+                }
+            });
+    }
+
+    void Client::handleRead(const boost::system::error_code &ec, size_t readSize)
+    {
+        if (ec)
+        {
+            if ((ec != boost::asio::error::eof) and (ec != boost::asio::error::operation_aborted))
+            {
+                LOG_ERROR(DOMAIN, "Remote[%s]: Error on read: [%d]", m_remoteIp.c_str(), ec.value());
             }
 
-            util::network::Message message;
-            try
+            handleConnectionLost();
+            return;
+        }
+
+        LOG_DEBUG(DOMAIN, "Remote[%s]: Received %d bytes", m_remoteIp.c_str(), readSize);
+        m_reader->commit(readSize);
+        m_lastReceived = std::chrono::steady_clock::now();
+
+        try
+        {
+            std::string_view frame;
+            while (m_reader->next(frame))
             {
-                message.fromString(std::string(&data[0], readSize));
+                util::network::MessageCodec::decode(frame.data(), frame.size(),
+                    [this](
+                        std::string_view id,
+                        std::string_view payload,
+                        util::network::WireFormat format,
+                        const util::network::MessageExtensions &extensions)
+                    {
+                        handleMessage(m_remoteIp, id, payload, extensions);
+                    });
             }
-            catch (std::exception e)
+        }
+        catch (const std::length_error &e)
+        {
+            LOG_ERROR(DOMAIN, "Remote[%s]: Frame larger than %u KB. Disconnecting[%s]",
+                m_remoteIp.c_str(),
+                m_serverMaxRxMsgSizeKb,
+                e.what());
+            handleConnectionLost();
+            return;
+        }
+        catch (const std::exception &e)
+        {
+            LOG_ERROR(DOMAIN, "Remote[%s]: Unable to deserialize message received. Skipping[%s]",
+                m_remoteIp.c_str(),
+                e.what());
+            m_reader->clear();
+        }
+
+        if (m_serverSocket)
+        {
+            read();
+        }
+    }
+
+    void Client::handleMessage(
+        const std::string &remoteIp,
+        std::string_view id,
+        std::string_view payload,
+        const util::network::MessageExtensions &extensions)
+    {
+        if (id == util::network::BinaryMessage::HELLO_ID)
+        {
+            LOG_INFO(DOMAIN, "Remote[%s]: Switching to binary frames", remoteIp.c_str());
+            m_serverFormat = util::network::WireFormat::BINARY;
+            return;
+        }
+
+        if (id == util::network::ControlMessage::MULTICAST_ID)
+        {
+            joinMulticast(remoteIp, payload);
+            return;
+        }
+
+        if (id == util::network::ControlMessage::PONG_ID)
+        {
+            handleHeartbeat(payload);
+            return;
+        }
+
+        LOG_DEBUG(DOMAIN, "Remote[%s]: Received message with id [%.*s]",
+            remoteIp.c_str(),
+            static_cast<int>(id.size()),
+            id.data());
+        publish(id, payload, extensions);
+    }
+
+    void Client::publish(std::string_view id, std::string_view payload, const util::network::MessageExtensions &extensions)
+    {
+        core::MessageData attrs;
+        attrs.set("data", core::util::SharedBuffer(payload.data(), payload.size()));
+
+        if (m_tracer and extensions.trace)
+        {
+            m_tracer->receive(id, *extensions.trace);
+            attrs.set("trace", *extensions.trace);
+        }
+
+        // Until the server clock is known the time is dropped, receivers handle the frame as a local one
+        if (extensions.presentAt and m_serverClock.isSynchronized())
+        {
+            attrs.set("present_at", std::chrono::steady_clock::time_point(
+                std::chrono::nanoseconds(m_serverClock.toLocal(*extensions.presentAt))));
+        }
+
+        post(std::string(id), attrs);
+    }
+
+    void Client::reportTraces()
+    {
+        if (not m_tracer)
+        {
+            return;
+        }
+
+        std::string statistics = m_tracer->toString();
+        if (not statistics.empty())
+        {
+            LOG_INFO(DOMAIN, "Traced messages received by node %u:\n%s", m_tracer->getNodeId(), statistics.c_str());
+        }
+    }
+
+    void Client::joinMulticast(const std::string &remoteIp, std::string_view payload)
+    {
+        std::vector<std::string> channel = util::network::ControlMessage::decodeList(payload);
+
+        if (not m_multicastData or (channel.size() != 2))
+        {
+            return;
+        }
+
+        try
+        {
+            boost::asio::ip::address group = boost::asio::ip::make_address(channel[0]);
+            uint16_t port = static_cast<uint16_t>(std::stoul(channel[1]));
+
+            // Bound to the group port so that every viewer on the host receives the frames
+            std::shared_ptr<DataChannel> channel = std::make_shared<DataChannel>(
+                *m_ioContext, m_serverMaxRxMsgSizeKb * 1024);
+            boost::asio::ip::udp::endpoint endpoint(group, port);
+            channel->socket.open(endpoint.protocol());
+            channel->socket.set_option(boost::asio::ip::udp::socket::reuse_address(true));
+            channel->socket.bind(boost::asio::ip::udp::endpoint(endpoint.protocol(), port));
+            channel->socket.set_option(boost::asio::ip::multicast::join_group(group));
+
+            receiveDatagrams(channel);
+            m_dataChannel = channel;
+        }
+        catch (const std::exception &e)
+        {
+            LOG_ERROR(DOMAIN, "Remote[%s]: Unable to join multicast data channel %s:%s. Staying on TCP[%s]",
+                remoteIp.c_str(),
+                channel[0].c_str(),
+                channel[1].c_str(),
+                e.what());
+            return;
+        }
+
+        LOG_INFO(DOMAIN, "Remote[%s]: Receiving over multicast data channel %s:%s",
+            remoteIp.c_str(),
+            channel[0].c_str(),
+            channel[1].c_str());
+
+        sendToServer(util::network::ControlMessage::MULTICAST_ID, "");
+    }
+
+    void Client::receiveDatagrams(std::shared_ptr<DataChannel> channel)
+    {
+        channel->batch.asyncReceive(
+            [this, channel](const boost::system::error_code &ec, size_t count)
             {
-                LOG_ERROR(DOMAIN, "Remote[%s]: Unable to deserialize message received. Skipping[%s]",
-                    remoteIp.c_str(),
-                    e.what());
-                continue;
+                if (ec)
+                {
+                    if (ec != boost::asio::error::operation_aborted)
+                    {
+                        LOG_ERROR(DOMAIN, "Error[%d] on multicast data channel", ec.value());
+                    }
+                    return;
+                }
+
+                for (size_t i = 0; i < count; ++i)
+                {
+                    std::string_view datagram = channel->batch.getDatagram(i);
+
+                    channel->reassembler.add(datagram.data(), datagram.size(),
+                        [this](std::string_view frame)
+                        {
+                            try
+                            {
+                                util::network::MessageCodec::decode(frame.data(), frame.size(),
+                                    [this](
+                                        std::string_view id,
+                                        std::string_view payload,
+                                        util::network::WireFormat format,
+                                        const util::network::MessageExtensions &extensions)
+                                    {
+                                        if (isSubscribed(id))
+                                        {
+                                            publish(id, payload, extensions);
+                                        }
+                                    });
+                            }
+                            catch (const std::exception &e)
+                            {
+                                LOG_ERROR(DOMAIN, "Unable to deserialize multicast frame. Skipping[%s]", e.what());
+                            }
+                        });
+                }
+
+                uint32_t from;
+                uint32_t to;
+                if (channel->reassembler.takeGap(from, to))
+                {
+                    LOG_WARNING(DOMAIN, "Lost multicast frames %u to %u, requesting resync", from, to);
+                    sendToServer(util::network::ControlMessage::NACK_ID,
+                        util::network::ControlMessage::encodeList({std::to_string(from), std::to_string(to)}));
+                }
+
+                receiveDatagrams(channel);
+            });
+    }
+
+    bool Client::isSubscribed(std::string_view id)
+    {
+        std::scoped_lock<std::mutex> lock(m_subscriptionsMutex);
+
+        return (m_subscriptions == std::nullopt) or
+            (std::find(m_subscriptions->begin(), m_subscriptions->end(), id) != m_subscriptions->end());
+    }
+
+    void Client::connectToServer(core::MessageData attrs)
+    {
+        LOG_DEBUG(DOMAIN, "Entered %s", __PRETTY_FUNCTION__);
+        int serverId = attrs.get<int>("id");
+        std::string address;
+
+        {
+            std::lock_guard<std::mutex> lock(m_serversMutex);
+
+            auto server = std::find_if(m_servers.begin(), m_servers.end(),
+                [serverId](const DiscoveredServer &known) { return static_cast<int>(known.id) == serverId; });
+
+            if (server == m_servers.end())
+            {
+                LOG_DEBUG(DOMAIN, "Exited because of unknown server id => [%d] %s", serverId, __PRETTY_FUNCTION__);
+                return;
             }
 
-            if (not message.isValid())
+            address = server->address;
+        }
+
+        boost::asio::ip::tcp::endpoint endpoint = boost::asio::ip::tcp::endpoint(
+            boost::asio::ip::make_address(address),
+            m_serverTcpPort);
+
+        // Connects in the background, the caller never waits for the network
+        boost::asio::post(*m_ioContext, [this, endpoint] { connectTo(endpoint); });
+
+        LOG_DEBUG(DOMAIN, "Exited %s", __PRETTY_FUNCTION__);
+    }
+
+    void Client::connectTo(const boost::asio::ip::tcp::endpoint &endpoint)
+    {
+        if ((m_serverEndpoint == endpoint) and (m_serverSocket or m_isConnected))
+        {
+            LOG_DEBUG(DOMAIN, "Already connected to [%s]", endpoint.address().to_string().c_str());
+            return;
+        }
+
+        // Failing over keeps measuring the outage from its start
+        if (m_isConnected or not m_serverEndpoint)
+        {
+            m_disconnectedAt = std::chrono::steady_clock::now();
+        }
+
+        disconnect();
+
+        m_serverEndpoint = endpoint;
+        m_connectAttempts = 0;
+        connect();
+    }
+
+    void Client::connect()
+    {
+        if (not m_isActive or not m_serverEndpoint)
+        {
+            return;
+        }
+
+        // Same host peers skip the TCP/IP stack
+        connect(m_local and isLocalAddress(*m_ioContext, m_serverEndpoint->address(), m_serverTcpPort));
+    }
+
+    void Client::connect(bool local)
+    {
+        LOG_DEBUG(DOMAIN, "Connecting to [%s] over %s, attempt %u",
+            local ? m_localPath.c_str() : m_serverEndpoint->address().to_string().c_str(),
+            local ? "unix domain socket" : "TCP",
+            m_connectAttempts + 1);
+
+        m_isLocal = local;
+        m_serverSocket = std::make_shared<boost::asio::generic::stream_protocol::socket>(*m_ioContext);
+        boost::asio::generic::stream_protocol::endpoint endpoint = local ?
+            boost::asio::generic::stream_protocol::endpoint(boost::asio::local::stream_protocol::endpoint(
+                util::network::LocalTransport::toSocketPath(m_localPath))) :
+            boost::asio::generic::stream_protocol::endpoint(*m_serverEndpoint);
+
+        m_connectTimer->expires_after(std::chrono::milliseconds(m_connectTimeoutMs));
+        m_connectTimer->async_wait(
+            [socket = m_serverSocket](const boost::system::error_code &ec)
             {
-                LOG_ERROR(DOMAIN, "Remote[%s]: Invalid message received. Skipping.",
-                    remoteIp.c_str());
-                continue;
+                if (not ec)
+                {
+                    // Fails the pending connect with operation_aborted
+                    boost::system::error_code error;
+                    socket->close(error);
+                }
+            });
+
+        m_serverSocket->async_connect(endpoint,
+            [this, socket = m_serverSocket](const boost::system::error_code &ec)
+            {
+                if (socket == m_serverSocket)
+                {
+                    handleConnect(ec);
+                }
+            });
+    }
+
+    void Client::handleConnect(const boost::system::error_code &ec)
+    {
+        m_connectTimer->cancel();
+
+        if (ec)
+        {
+            LOG_DEBUG(DOMAIN, "Unable to connect to [%s]: [%s]",
+                m_serverEndpoint->address().to_string().c_str(),
+                (ec == boost::asio::error::operation_aborted) ? "timeout" : ec.message().c_str());
+
+            boost::system::error_code error;
+            m_serverSocket->close(error);
+            m_serverSocket.reset();
+
+            // Servers without a unix domain socket are still reachable over TCP
+            if (m_isLocal)
+            {
+                connect(false);
+                return;
             }
 
-            // Publish message
+            ++m_connectAttempts;
+
+            // Another server may have answered discovery in the meantime
+            if (not autoConnect())
             {
-                core::MessageData attrs;
-                attrs.set<std::string>("data", message.getData());
-                LOG_DEBUG(DOMAIN, "Remote[%s]: Received message with id [%s]",
-                    remoteIp.c_str(),
-                    message.getId().c_str());
-                post(message.getId(), attrs);
+                scheduleReconnect();
             }
+
+            return;
         }
 
+        boost::system::error_code error;
+        if (not m_isLocal)
         {
-            LOG_INFO(DOMAIN, "Remote[%s]: Disconecting", remoteIp.c_str());
-            disconnect();
+            m_serverSocket->set_option(boost::asio::ip::tcp::no_delay(true), error);
         }
 
-        LOG_DEBUG(DOMAIN, "Exited %s", __PRETTY_FUNCTION__);
+        m_remoteIp = m_serverEndpoint->address().to_string();
+        m_reader = std::make_unique<util::network::FrameReader>(m_serverMaxRxMsgSizeKb * 1024);
+        m_writeQueue.clear();
+        m_writeQueueBytes = 0;
+        m_droppedMessages = 0;
+        m_isConnected = true;
+
+        uint32_t recoveryMs = std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now() - m_disconnectedAt).count();
+
+        LOG_INFO(DOMAIN, "Remote[%s]: connected over %s after %u ms and %u failed attempts",
+            m_remoteIp.c_str(),
+            m_isLocal ? "unix domain socket" : "TCP",
+            recoveryMs,
+            m_connectAttempts);
+
+        // Text until the server answers the hello; servers without binary
+        // support drop the hello as an undecodable message
+        m_serverFormat = util::network::WireFormat::TEXT;
+        if (m_wireFormat == util::network::WireFormat::BINARY)
+        {
+            queue(util::network::MessageCodec::encode(
+                util::network::WireFormat::BINARY, util::network::BinaryMessage::HELLO_ID, ""), true);
+        }
+
+        // A new connection starts from scratch, the server is told again what to send
+        sendSubscriptions();
+
+        core::MessageData status;
+        status.set<bool>("connected", true);
+        status.set<std::string>("address", m_remoteIp);
+        status.set<uint32_t>("attempts", m_connectAttempts);
+        status.set<uint32_t>("recovery_ms", recoveryMs);
+        status.set<std::string>("transport", m_isLocal ? "local" : "tcp");
+        post("SERVER_CONNECTION", status);
+
+        m_connectAttempts = 0;
+        m_lastReceived = std::chrono::steady_clock::now();
+        m_rtt.reset();
+        m_serverClock.reset();
+        read();
+        scheduleHeartbeat();
     }
 
-    void Client::connectToServer(core::MessageData attrs)
+    void Client::scheduleHeartbeat()
     {
-        LOG_DEBUG(DOMAIN, "Entered %s", __PRETTY_FUNCTION__);
-        int serverIndex = attrs.get<int>("id") - 1;
+        if (m_heartbeatPeriodMs == 0)
+        {
+            return;
+        }
 
-        if (serverIndex >= m_detectedServers.size())
+        m_heartbeatTimer->expires_after(std::chrono::milliseconds(m_heartbeatPeriodMs));
+        m_heartbeatTimer->async_wait(
+            [this, socket = m_serverSocket](const boost::system::error_code &ec)
+            {
+                if (not ec and (socket == m_serverSocket))
+                {
+                    sendHeartbeat();
+                }
+            });
+    }
+
+    void Client::sendHeartbeat()
+    {
+        auto now = std::chrono::steady_clock::now();
+        uint32_t silenceMs = std::chrono::duration_cast<std::chrono::milliseconds>(now - m_lastReceived).count();
+
+        // Half open connections never fail a write, only the missing answers tell
+        if (silenceMs > m_heartbeatTimeoutMs)
         {
-            LOG_DEBUG(DOMAIN, "Exited because of invalid server index => [%d] %s", serverIndex, __PRETTY_FUNCTION__);
+            LOG_WARNING(DOMAIN, "Remote[%s]: Nothing received for %u ms, connection is dead",
+                m_remoteIp.c_str(),
+                silenceMs);
+
+            core::MessageData heartbeat;
+            heartbeat.set<bool>("alive", false);
+            heartbeat.set<std::string>("address", m_remoteIp);
+            heartbeat.set<uint32_t>("silence_ms", silenceMs);
+            post("SERVER_HEARTBEAT", heartbeat);
+
+            handleConnectionLost();
             return;
         }
 
-        int updateId = attrs.get<int>("update_id");
+        int64_t sentAt = std::chrono::duration_cast<std::chrono::nanoseconds>(now.time_since_epoch()).count();
+        int64_t rttUs = m_rtt ? m_rtt->count() : 0;
 
-        boost::asio::ip::tcp::endpoint endpoint = boost::asio::ip::tcp::endpoint(
-            boost::asio::ip::make_address(m_detectedServers.at(serverIndex)),
-            m_serverTcpPort);
+        queue(util::network::MessageCodec::encode(
+            m_serverFormat,
+            util::network::ControlMessage::PING_ID,
+            util::network::ControlMessage::encodeList({std::to_string(sentAt), std::to_string(rttUs)})), true);
 
-        disconnect(); // if connected
+        scheduleHeartbeat();
+    }
 
-        LOG_DEBUG(DOMAIN, "Connecting to [%s]", endpoint.address().to_string().c_str());
+    void Client::handleHeartbeat(std::string_view payload)
+    {
+        uint64_t receivedAt = util::network::MessageTracer::now();
+        std::vector<std::string> values = util::network::ControlMessage::decodeList(payload);
+        int64_t sentAt;
 
-        m_serverSocket = std::make_shared<boost::asio::ip::tcp::socket>(*m_ioContext);
-        m_serverSocket->connect(endpoint);
-        m_serverSocket->set_option(boost::asio::ip::tcp::no_delay(true));
+        try
+        {
+            sentAt = std::stoll(values.at(0));
 
-        m_recvData = std::thread([this] { receiveData(m_serverSocket); });
+            // Servers predating clock sync only echo the ping
+            if (values.size() >= 4)
+            {
+                m_serverClock.add(sentAt, std::stoull(values[2]), std::stoull(values[3]), receivedAt);
+            }
+        }
+        catch (const std::exception &e)
+        {
+            LOG_ERROR(DOMAIN, "Remote[%s]: Invalid heartbeat answer[%s]", m_remoteIp.c_str(), e.what());
+            return;
+        }
 
-        LOG_DEBUG(DOMAIN, "Exited %s", __PRETTY_FUNCTION__);
+        std::chrono::microseconds rtt = std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::nanoseconds(receivedAt - sentAt));
+
+        // Smoothed like the TCP estimator, a single late answer barely moves it
+        m_rtt = m_rtt ? (*m_rtt + (rtt - *m_rtt) / 8) : rtt;
+
+        {
+            std::scoped_lock<std::mutex> lock(m_serversMutex);
+            for (DiscoveredServer &server : m_servers)
+            {
+                if (server.address == m_remoteIp)
+                {
+                    server.rtt = *m_rtt;
+                }
+            }
+        }
+
+        core::MessageData heartbeat;
+        heartbeat.set<bool>("alive", true);
+        heartbeat.set<std::string>("address", m_remoteIp);
+        heartbeat.set<uint32_t>("rtt_us", static_cast<uint32_t>(rtt.count()));
+        heartbeat.set<uint32_t>("smoothed_rtt_us", static_cast<uint32_t>(m_rtt->count()));
+
+        if (m_serverClock.isSynchronized())
+        {
+            heartbeat.set<int64_t>("clock_offset_ns", m_serverClock.getOffset().count());
+        }
+
+        post("SERVER_HEARTBEAT", heartbeat);
     }
 
-    void Client::disconnect()
+    void Client::handleConnectionLost()
     {
-        LOG_DEBUG(DOMAIN, "Entered %s", __PRETTY_FUNCTION__);
+        LOG_INFO(DOMAIN, "Remote[%s]: Disconecting, dropped %llu queued messages",
+            m_remoteIp.c_str(),
+            static_cast<unsigned long long>(m_droppedMessages));
+
+        closeConnection();
+        m_disconnectedAt = std::chrono::steady_clock::now();
+
+        core::MessageData status;
+        status.set<bool>("connected", false);
+        status.set<std::string>("address", m_remoteIp);
+        post("SERVER_CONNECTION", status);
+
+        // Finds out which servers are still around, in case this one is gone
+        if (m_autoConnect)
+        {
+            sendPing();
+        }
+
+        scheduleReconnect();
+    }
+
+    void Client::scheduleReconnect()
+    {
+        if (not m_isActive or not m_reconnect or not m_serverEndpoint)
+        {
+            return;
+        }
+
+        // Exponential backoff with jitter, so the clients of a failed server do not reconnect in lockstep
+        uint32_t shift = std::min<uint32_t>(m_connectAttempts, 16);
+        uint32_t ceiling = static_cast<uint32_t>(
+            std::min<uint64_t>(m_reconnectMaxMs, static_cast<uint64_t>(m_reconnectMinMs) << shift));
+        uint32_t delayMs = std::uniform_int_distribution<uint32_t>(ceiling / 2, ceiling)(m_random);
+
+        LOG_DEBUG(DOMAIN, "Reconnecting to [%s] in %u ms",
+            m_serverEndpoint->address().to_string().c_str(),
+            delayMs);
+
+        m_reconnectTimer->expires_after(std::chrono::milliseconds(delayMs));
+        m_reconnectTimer->async_wait(
+            [this](const boost::system::error_code &ec)
+            {
+                if (not ec and not m_serverSocket)
+                {
+                    connect();
+                }
+            });
+    }
+
+    void Client::closeConnection()
+    {
+        m_isConnected = false;
+        m_writeQueue.clear();
+        m_writeQueueBytes = 0;
+        m_heartbeatTimer->cancel();
 
         if (m_serverSocket)
         {
             LOG_DEBUG(DOMAIN, "Socket %p is closing", m_serverSocket.get());
+
             // Force shutdown
-            if (m_serverSocket->is_open())
-            {
-                boost::system::error_code err;
-                m_serverSocket->shutdown(
-                    boost::asio::ip::tcp::socket::shutdown_both, err);
-                m_serverSocket->close();
-            }
+            boost::system::error_code err;
+            m_serverSocket->shutdown(boost::asio::ip::tcp::socket::shutdown_both, err);
+            m_serverSocket->close(err);
             m_serverSocket.reset();
         }
 
-        if (m_recvData.joinable() and
-            std::this_thread::get_id() != m_recvData.get_id())
+        if (m_dataChannel)
         {
-            m_recvData.join();
+            boost::system::error_code error;
+            m_dataChannel->socket.close(error);
+            m_dataChannel.reset();
         }
+    }
+
+    void Client::disconnect()
+    {
+        LOG_DEBUG(DOMAIN, "Entered %s", __PRETTY_FUNCTION__);
+
+        // Stays disconnected until asked to connect again
+        m_serverEndpoint.reset();
+        m_connectTimer->cancel();
+        m_reconnectTimer->cancel();
+        closeConnection();
 
         LOG_DEBUG(DOMAIN, "Exited %s", __PRETTY_FUNCTION__);
     }
@@ -0,0 +1,433 @@
+/**
+ * @file main.cpp
+ *
+ * @brief Throughput benchmark of networking::Server.
+ *        Connects a number of clients over loopback, publishes messages
+ *        on the bus and measures how fast the server fans them out,
+ *        along with the number of threads the process needed to do so.
+ *        Stalled clients, which never read, show that one slow viewer
+ *        does not hold back the others nor grow the server memory.
+ *        Filtered clients subscribe to another topic and must cost the
+ *        server nothing. With the multicast data channel enabled, every
+ *        client receives a single send of each frame. Local clients
+ *        connect through the unix domain socket instead of TCP.
+ *
+ * @author Nicolae Natea
+ * Contact: nicu@natea.ro
+ */
+
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <boost/asio.hpp>
+#include <boost/program_options.hpp>
+#include <boost/property_tree/ptree.hpp>
+
+#include <core/Component.hpp>
+#include <core/Scheduler.hpp>
+#include <util/network/ControlMessage.hpp>
+#include <util/network/Datagram.hpp>
+#include <util/network/FrameReader.hpp>
+#include <util/network/LocalTransport.hpp>
+#include <util/network/MessageCodec.hpp>
+
+namespace
+{
+    const char *APP_NAME = "ServerBenchmark";
+    const char *TOPIC = "NETWORK_BROADCAST";
+
+    /** Publishes benchmark messages on the bus */
+    class Publisher : public core::Component
+    {
+    public:
+        Publisher *clone() const override
+        {
+            return new Publisher(*this);
+        }
+
+        void init(const boost::property_tree::ptree::value_type &component) override
+        {
+            m_topic = advertise(TOPIC);
+        }
+
+        void publish(const core::util::SharedBuffer &data)
+        {
+            core::MessageData attrs("data", data);
+            post(m_topic, attrs);
+        }
+
+    private:
+        core::TopicId m_topic;
+    };
+
+    /** Viewer connection counting the messages it receives */
+    class BenchmarkClient : public std::enable_shared_from_this<BenchmarkClient>
+    {
+    public:
+        BenchmarkClient(
+            boost::asio::io_context &context,
+            std::atomic<uint64_t> &received,
+            std::atomic<uint32_t> &negotiated) :
+            m_socket(boost::asio::make_strand(context)),
+            m_dataSocket(m_socket.get_executor()),
+            m_reader(64 * 1024),
+            m_reassembler(64 * 1024),
+            m_datagram(UINT16_MAX),
+            m_received(received),
+            m_negotiated(negotiated)
+        {
+        }
+
+        void connect(const boost::asio::generic::stream_protocol::endpoint &endpoint, bool stalled, bool filtered)
+        {
+            boost::system::error_code error;
+            m_socket.connect(endpoint);
+            m_socket.set_option(boost::asio::ip::tcp::no_delay(true), error);
+
+            std::shared_ptr<std::string> hello = util::network::MessageCodec::encode(
+                util::network::WireFormat::BINARY, util::network::BinaryMessage::HELLO_ID, "");
+            boost::asio::write(m_socket, boost::asio::buffer(*hello));
+
+            if (filtered)
+            {
+                std::shared_ptr<std::string> subscription = util::network::MessageCodec::encode(
+                    util::network::WireFormat::BINARY,
+                    util::network::ControlMessage::SUBSCRIBE_ID,
+                    util::network::ControlMessage::encodeList({"updateLed"}));
+                boost::asio::write(m_socket, boost::asio::buffer(*subscription));
+            }
+
+            if (stalled)
+            {
+                // Never reads; the kernel buffers fill up and the server queue with them
+                m_socket.set_option(boost::asio::socket_base::receive_buffer_size(4096));
+                ++m_negotiated;
+                return;
+            }
+
+            read();
+        }
+
+        void close()
+        {
+            boost::asio::post(m_socket.get_executor(), [self = shared_from_this()]
+            {
+                boost::system::error_code error;
+                self->m_socket.close(error);
+                self->m_dataSocket.close(error);
+            });
+        }
+
+    private:
+        void read()
+        {
+            m_socket.async_read_some(
+                boost::asio::buffer(m_reader.prepare(), m_reader.writable()),
+                [self = shared_from_this()](const boost::system::error_code &ec, size_t readSize)
+                {
+                    if (ec)
+                    {
+                        return;
+                    }
+
+                    self->m_reader.commit(readSize);
+
+                    std::string_view frame;
+                    while (self->m_reader.next(frame))
+                    {
+                        util::network::MessageCodec::decode(frame.data(), frame.size(),
+                            [&self](std::string_view id, std::string_view payload, util::network::WireFormat format)
+                            {
+                                if (id == util::network::BinaryMessage::HELLO_ID)
+                                {
+                                    ++self->m_negotiated;
+                                }
+                                else if (id == util::network::ControlMessage::MULTICAST_ID)
+                                {
+                                    self->joinMulticast(payload);
+                                }
+                                else
+                                {
+                                    ++self->m_received;
+                                }
+                            });
+                    }
+
+                    self->read();
+                });
+        }
+
+        void joinMulticast(std::string_view payload)
+        {
+            std::vector<std::string> channel = util::network::ControlMessage::decodeList(payload);
+            boost::asio::ip::address group = boost::asio::ip::make_address(channel.at(0));
+            boost::asio::ip::udp::endpoint endpoint(group, std::stoul(channel.at(1)));
+
+            m_dataSocket.open(endpoint.protocol());
+            m_dataSocket.set_option(boost::asio::ip::udp::socket::reuse_address(true));
+            m_dataSocket.set_option(boost::asio::socket_base::receive_buffer_size(4 * 1024 * 1024));
+            m_dataSocket.bind(boost::asio::ip::udp::endpoint(endpoint.protocol(), endpoint.port()));
+            m_dataSocket.set_option(boost::asio::ip::multicast::join_group(group));
+            receiveDatagram();
+
+            std::shared_ptr<std::string> joined = util::network::MessageCodec::encode(
+                util::network::WireFormat::BINARY, util::network::ControlMessage::MULTICAST_ID, "");
+            boost::asio::write(m_socket, boost::asio::buffer(*joined));
+        }
+
+        void receiveDatagram()
+        {
+            m_dataSocket.async_receive(
+                boost::asio::buffer(m_datagram),
+                [self = shared_from_this()](const boost::system::error_code &ec, size_t readSize)
+                {
+                    if (ec)
+                    {
+                        return;
+                    }
+
+                    self->m_reassembler.add(self->m_datagram.data(), readSize,
+                        [&self](std::string_view frame) { ++self->m_received; });
+
+                    self->receiveDatagram();
+                });
+        }
+
+        boost::asio::generic::stream_protocol::socket m_socket;
+        boost::asio::ip::udp::socket m_dataSocket;
+        util::network::FrameReader m_reader;
+        util::network::DatagramReassembler m_reassembler;
+        std::vector<char> m_datagram;
+        std::atomic<uint64_t> &m_received;
+        std::atomic<uint32_t> &m_negotiated;
+    };
+
+    /** @return value of a numeric field of /proc/self/status */
+    uint64_t getProcessStatus(const std::string &field)
+    {
+        std::ifstream status("/proc/self/status");
+        std::string key;
+
+        while (status >> key)
+        {
+            if (key == field)
+            {
+                uint64_t value = 0;
+                status >> value;
+                return value;
+            }
+        }
+
+        return 0;
+    }
+
+    /** @return number of threads of the process */
+    uint32_t getThreadCount()
+    {
+        return getProcessStatus("Threads:");
+    }
+
+    /** Waits until the predicate holds or the timeout expires */
+    template<typename Predicate>
+    bool waitFor(Predicate predicate, const std::chrono::steady_clock::duration &timeout)
+    {
+        auto deadline = std::chrono::steady_clock::now() + timeout;
+
+        while (not predicate())
+        {
+            if (std::chrono::steady_clock::now() > deadline)
+            {
+                return false;
+            }
+
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+
+        return true;
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    uint32_t clientCount;
+    uint32_t stalledCount;
+    uint32_t filteredCount;
+    bool multicast;
+    bool local;
+    std::string policy;
+    std::string backend;
+    uint32_t serverThreads;
+    uint32_t messageCount;
+    uint32_t messageSize;
+    uint32_t queuedMessages = 0;
+    uint16_t port;
+
+    try
+    {
+        boost::program_options::options_description options{APP_NAME};
+        options.add_options()
+            ("help,h", "Help")
+            ("clients,c", boost::program_options::value<uint32_t>(&clientCount)->default_value(200), "Connected clients")
+            ("stalled", boost::program_options::value<uint32_t>(&stalledCount)->default_value(0), "Clients that never read")
+            ("filtered", boost::program_options::value<uint32_t>(&filteredCount)->default_value(0),
+                "Clients subscribed to another topic")
+            ("multicast", boost::program_options::bool_switch(&multicast), "Send frames over the multicast data channel")
+            ("local", boost::program_options::bool_switch(&local), "Connect through the unix domain socket")
+            ("backend", boost::program_options::value<std::string>(&backend)->default_value("asio"),
+                "Server backend: asio or io-uring")
+            ("policy", boost::program_options::value<std::string>(&policy)->default_value("drop-oldest"),
+                "Slow consumer policy: drop-oldest, conflate or disconnect")
+            ("queue,q", boost::program_options::value<uint32_t>(&queuedMessages),
+                "Messages queued per client before the slow consumer policy applies")
+            ("threads,t", boost::program_options::value<uint32_t>(&serverThreads)->default_value(2), "Server threads")
+            ("messages,m", boost::program_options::value<uint32_t>(&messageCount)->default_value(2000), "Published messages")
+            ("size,s", boost::program_options::value<uint32_t>(&messageSize)->default_value(512), "Payload size in bytes")
+            ("port,p", boost::program_options::value<uint16_t>(&port)->default_value(3100), "Server port");
+
+        boost::program_options::variables_map vm;
+        boost::program_options::store(boost::program_options::parse_command_line(argc, argv, options), vm);
+        boost::program_options::notify(vm);
+
+        if (vm.count("help"))
+        {
+            options.print(std::cout);
+            return 0;
+        }
+    }
+    catch (const boost::program_options::error &e)
+    {
+        std::cerr << e.what() << std::endl;
+        return -1;
+    }
+
+    uint32_t baseThreads = getThreadCount();
+
+    // Server under test, created the way the launcher does it
+    boost::property_tree::ptree conf;
+    conf.put("multicast.group", "239.255.0.1");
+    conf.put("multicast.port", port + 1);
+    conf.put("server.tcp.address", "127.0.0.1");
+    conf.put("server.tcp.port", port);
+    conf.put("server.threads", serverThreads);
+    conf.put("server.backend", backend);
+    conf.put("server.max.rx-size-kb", 64);
+    conf.put("server.client.slow-policy", policy);
+    if (queuedMessages != 0)
+    {
+        conf.put("server.client.max-queued-messages", queuedMessages);
+        conf.put("server.client.max-queued-kb", queuedMessages * (messageSize + 64) / 1024 + 1);
+    }
+    conf.put("server.multicast-data.enabled", multicast);
+    conf.put("server.multicast-data.port", port + 2);
+    boost::property_tree::ptree::value_type serverConf("Server", conf);
+
+    core::Component *server = core::Component::makeComponent(serverConf);
+    server->init(serverConf);
+
+    Publisher publisher;
+    publisher.init(serverConf);
+
+    server->start();
+
+    uint32_t serverThreadCount = getThreadCount() - baseThreads;
+
+    // Clients share a small pool of their own
+    std::atomic<uint64_t> received(0);
+    std::atomic<uint32_t> negotiated(0);
+    boost::asio::io_context clientContext;
+    auto clientGuard = boost::asio::make_work_guard(clientContext);
+    std::vector<std::thread> clientThreads;
+    std::vector<std::shared_ptr<BenchmarkClient>> clients;
+
+    for (int i = 0; i < 2; ++i)
+    {
+        clientThreads.emplace_back([&clientContext] { clientContext.run(); });
+    }
+
+    boost::asio::generic::stream_protocol::endpoint endpoint = local ?
+        boost::asio::generic::stream_protocol::endpoint(boost::asio::local::stream_protocol::endpoint(
+            util::network::LocalTransport::toSocketPath(util::network::LocalTransport::getDefaultPath(port)))) :
+        boost::asio::generic::stream_protocol::endpoint(
+            boost::asio::ip::tcp::endpoint(boost::asio::ip::make_address("127.0.0.1"), port));
+    std::atomic<uint64_t> stalledReceived(0);
+    std::atomic<uint64_t> filteredReceived(0);
+    uint32_t connectionCount = clientCount + stalledCount + filteredCount;
+    for (uint32_t i = 0; i < connectionCount; ++i)
+    {
+        bool stalled = (i >= clientCount) and (i < clientCount + stalledCount);
+        bool filtered = (i >= clientCount + stalledCount);
+        clients.push_back(std::make_shared<BenchmarkClient>(
+            clientContext, stalled ? stalledReceived : (filtered ? filteredReceived : received), negotiated));
+        clients.back()->connect(endpoint, stalled, filtered);
+    }
+
+    if (not waitFor([&] { return negotiated == connectionCount; }, std::chrono::seconds(10)))
+    {
+        std::cerr << "Only " << negotiated << " of " << connectionCount << " clients negotiated" << std::endl;
+    }
+
+    // Publish and wait for every client to receive every message
+    core::util::SharedBuffer payload(std::string(messageSize, 'x'));
+    uint64_t expected = static_cast<uint64_t>(clientCount) * messageCount;
+
+    auto start = std::chrono::steady_clock::now();
+
+    for (uint32_t i = 0; i < messageCount; ++i)
+    {
+        publisher.publish(payload);
+    }
+
+    auto published = std::chrono::steady_clock::now();
+
+    // Dropped messages never arrive, so stop once deliveries stall
+    uint64_t lastReceived;
+    do
+    {
+        lastReceived = received;
+        waitFor([&] { return received == expected; }, std::chrono::seconds(1));
+    } while ((received != expected) and (received != lastReceived));
+
+    bool complete = (received == expected) and (filteredReceived == 0);
+    auto end = std::chrono::steady_clock::now();
+
+    double publishSeconds = std::chrono::duration<double>(published - start).count();
+    double totalSeconds = std::chrono::duration<double>(end - start).count();
+
+    std::cout << "transport               " << (multicast ? "multicast" : (local ? "unix domain socket" : "tcp")) << std::endl;
+    std::cout << "backend                 " << backend << std::endl;
+    std::cout << "clients                 " << clientCount << " (+" << stalledCount << " stalled, " << policy << ")"
+              << " (+" << filteredCount << " filtered, received " << filteredReceived << ")" << std::endl;
+    std::cout << "server threads          " << serverThreadCount
+              << " (" << serverThreads << " io threads + advertising)" << std::endl;
+    std::cout << "connections per thread  " << clientCount / serverThreads << std::endl;
+    std::cout << "payload size            " << messageSize << " bytes" << std::endl;
+    std::cout << "published               " << messageCount << " in " << publishSeconds << " s ("
+              << messageCount / publishSeconds << " msg/s)" << std::endl;
+    std::cout << "delivered               " << received << " of " << expected << " in " << totalSeconds << " s ("
+              << received / totalSeconds << " msg/s)" << (complete ? "" : " INCOMPLETE") << std::endl;
+    std::cout << "peak resident memory    " << getProcessStatus("VmHWM:") << " kB" << std::endl;
+
+    for (auto &client : clients)
+    {
+        client->close();
+    }
+
+    server->stop();
+    delete server;
+
+    clientGuard.reset();
+    for (auto &thread : clientThreads)
+    {
+        thread.join();
+    }
+
+    core::Scheduler::getInstance().stop();
+
+    return complete ? 0 : 1;
+}
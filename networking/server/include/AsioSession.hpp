@@ -0,0 +1,61 @@
+/**
+ * @file AsioSession.hpp
+ *
+ * @brief Session whose socket is driven by the server io_context.
+ *        All operations of a session run on its own strand, so any
+ *        number of sessions share the fixed set of server threads
+ *        without blocking any of them. The socket is a generic stream,
+ *        so clients connected over TCP and over the local unix domain
+ *        socket are handled alike.
+ *
+ * @author Nicolae Natea
+ * Contact: nicu@natea.ro
+ */
+
+#ifndef _CORE_NETWORKING_ASIO_SESSION_
+#define _CORE_NETWORKING_ASIO_SESSION_
+
+#include <memory>
+#include <string>
+
+#include <boost/asio.hpp>
+
+#include <Session.hpp>
+
+namespace networking
+{
+    class AsioSession : public Session
+    {
+    public:
+        /**
+         * @param[in] socket connected socket, bound to a strand
+         * @param[in] remoteIp address of the client, used in logs
+         * @param[in] maxFrameSize largest accepted frame
+         * @param[in] limits bounds of the outgoing queue
+         * @param[in] onMessage handler of received messages
+         * @param[in] onClose handler of the disconnection
+         */
+        AsioSession(
+            boost::asio::generic::stream_protocol::socket socket,
+            const std::string &remoteIp,
+            size_t maxFrameSize,
+            const SessionLimits &limits,
+            MessageCallback onMessage,
+            CloseCallback onClose);
+
+        void start() override;
+        void send(core::TopicId topic, std::shared_ptr<std::string> buf) override;
+        void close() override;
+
+    protected:
+        void read() override;
+        void startWrite() override;
+        void closeSocket() override;
+        void closeLater() override;
+
+    private:
+        boost::asio::generic::stream_protocol::socket m_socket;
+    };
+}
+
+#endif /* _CORE_NETWORKING_ASIO_SESSION_ */
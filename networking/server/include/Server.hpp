@@ -3,6 +3,20 @@
  *
  * @brief Implementation of a network server used
  *        to dispatch messages between systems.
+ *        Besides TCP, clients on the same host connect through a unix
+ *        domain socket, which skips the TCP/IP stack.
+ *        The last message of each state topic is kept, so a client gets
+ *        the current state as soon as its wire format is known (its hello,
+ *        or its first text message) instead of waiting for the producer
+ *        to publish again.
+ *        Clients sending heartbeats are answered, and disconnected once
+ *        nothing arrived from them for longer than the heartbeat timeout; their
+ *        liveness and round trip time are published as CLIENT_HEARTBEAT.
+ *        The outgoing queue counters of every client are published
+ *        periodically as CLIENT_STATISTICS.
+ *        The monotonic clock of the server is the reference its clients
+ *        sync to: heartbeat answers carry its time, and frames of the
+ *        presentation topics the time every client is to show them at.
  *
  * @author Nicolae Natea
  * Contact: nicu@natea.ro
@@ -12,22 +26,76 @@
 #define _CORE_NETWORKING_SERVER_
 
 #include <array>
+#include <chrono>
 #include <cstdint>
+#include <map>
 #include <memory>
 #include <mutex>
+#include <optional>
 #include <set>
 #include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <vector>
 
 #include <boost/asio.hpp>
 
 #include <core/Component.hpp>
+#include <core/util/EnumCast.hpp>
+#include <util/network/BinaryMessage.hpp>
+#include <util/network/FramePool.hpp>
+#include <util/network/MessageTracer.hpp>
+
+#include <AsioSession.hpp>
+#include <BatchUdpSocket.hpp>
+#include <Session.hpp>
+
+#ifdef BREADCRUMBS_IO_URING
+#include <UringBackend.hpp>
+#include <UringSession.hpp>
+#endif
 
 namespace networking
 {
+    namespace
+    {
+        const uint32_t DEFAULT_SERVER_THREADS = 2;
+        const uint32_t DEFAULT_CLIENT_MAX_QUEUED_KB = 1024;
+        const uint32_t DEFAULT_CLIENT_MAX_QUEUED_MESSAGES = 256;
+        const uint32_t DEFAULT_MULTICAST_DATA_MTU = 1400;
+        const uint32_t UDP_BATCH_SIZE = 64;
+    }
+
+    /** Engine serving the client sockets */
+    enum struct ServerBackend
+    {
+        ASIO,    ///< Reactor run by the server threads
+        IO_URING ///< Single ring thread, needs BREADCRUMBS_IO_URING and Linux 5.19+
+    };
+
+    static const core::util::EnumCast<ServerBackend> server_backend_map =
+        core::util::EnumCast<ServerBackend>
+            (ServerBackend::ASIO,     "asio")
+            (ServerBackend::IO_URING, "io-uring");
 
     class Server : public core::Component
     {
     private:
+        /** Client sending heartbeats, whose liveness is its last received message */
+        struct ClientHeartbeat
+        {
+            std::chrono::microseconds rtt; ///< As measured by the client
+        };
+
+        /** Last message of a topic, encoded for each wire format when first needed */
+        struct Snapshot
+        {
+            core::MessageId id;
+            core::util::SharedBuffer data;
+            std::array<std::shared_ptr<std::string>, 2> frames; ///< Indexed by WireFormat
+        };
+
         Server();
         Server(const Server &other);
 
@@ -39,38 +107,157 @@ namespace networking
         void stop() override;
 
     protected:
-        void sendBroadcast(const core::MessageId &id, const core::MessageData &attrs);
+        void sendBroadcast(const core::MessageId &id, core::TopicId topic, const core::MessageData &attrs);
+
+        /** Replaces the last message kept for a topic, with the frames already encoded for it */
+        void keepSnapshot(
+            core::TopicId topic,
+            const core::MessageId &id,
+            const core::util::SharedBuffer &data,
+            std::shared_ptr<std::string> textFrame,
+            std::shared_ptr<std::string> binaryFrame);
+
+        /** Sends a client the last message kept for each of the topics */
+        void sendSnapshots(const std::shared_ptr<Session> &session, const std::set<core::TopicId> &topics);
+
+        /**
+         * Sends a client the snapshots it waits for, once its wire format is known.
+         * Caller must hold m_clientsMutex.
+         */
+        void sendPendingSnapshots(const std::shared_ptr<Session> &session);
+
+        /** Sends a frame once, to every client listening to the multicast data channel */
+        void sendMulticast(
+            const core::MessageId &id,
+            core::TopicId topic,
+            const core::util::SharedBuffer &data,
+            const std::string &frame);
 
         void startAdvertising();
         void startListeningTcp();
+        void startListeningLocal();
+
+        /** Serves a newly connected client */
+        void addSession(boost::asio::generic::stream_protocol::socket socket, const std::string &remoteIp);
+
+#ifdef BREADCRUMBS_IO_URING
+        /** Serves a client accepted by the io_uring backend */
+        void addUringSession(int fd, const std::string &remoteIp);
+#endif
+
+        /** Tracks a new client and starts reading from it */
+        void registerSession(const std::shared_ptr<Session> &session);
 
         void advertise();
-        void receiveData(std::shared_ptr<boost::asio::ip::tcp::socket> sock);
+
+        /** Publishes a message received from a client */
+        void handleMessage(
+            const std::shared_ptr<Session> &session,
+            std::string_view id,
+            std::string_view payload,
+            const util::network::MessageExtensions &extensions);
+
+        /** Forgets a disconnected client */
+        void handleClose(const std::shared_ptr<Session> &session);
+
+        /** Switches a client to binary frames once it announced support for them */
+        void handleHello(const std::shared_ptr<Session> &session);
+
+        /** Replaces the set of topics a client receives */
+        void handleSubscribe(const std::shared_ptr<Session> &session, std::string_view payload);
+
+        /** Stops sending the multicast topics to a client that joined the data channel */
+        void handleMulticast(const std::shared_ptr<Session> &session);
+
+        /** Resynchronizes a client that lost multicast frames */
+        void handleNack(const std::shared_ptr<Session> &session, std::string_view payload);
+
+        /** Answers a client heartbeat */
+        void handlePing(const std::shared_ptr<Session> &session, std::string_view payload);
+
+        /** Publishes the liveness of the clients sending heartbeats, disconnecting the silent ones */
+        void checkHeartbeats();
+
+        /** Publishes the queue counters of each client, logging the ones which lost messages since the last time */
+        void reportClients();
+
+        /** Logs the statistics of the traced messages received so far */
+        void reportTraces();
 
     private:
         static Server _prototype;
 
         std::shared_ptr<boost::asio::ip::udp::socket> m_multicastSocket;
+        std::unique_ptr<BatchUdpSocket> m_discoveryBatch; ///< Pings and pongs, used on the advertising thread
         std::shared_ptr<boost::asio::ip::tcp::acceptor> m_acceptor;
+        std::shared_ptr<boost::asio::local::stream_protocol::acceptor> m_localAcceptor;
 
         std::thread m_advertisingThread;
-        std::thread m_broadcastThread;
 
         std::string m_multicastAddress;
         uint16_t m_multicastPort;
         std::string m_serverListenAddress;
         uint16_t m_serverListenPort;
         uint32_t m_serverMaxRxMsgSizeKb;
+        uint32_t m_serverThreads;
+        ServerBackend m_backend;
+        SessionLimits m_sessionLimits;
+        util::network::WireFormat m_wireFormat;
+        bool m_local;                         ///< Same host clients may use the unix domain socket
+        std::string m_localPath;              ///< Path of the unix domain socket, '@' for abstract names
+
+        bool m_multicastData;                 ///< Multicast topics are sent over the data channel
+        std::string m_multicastDataAddress;   ///< Group of the data channel
+        uint16_t m_multicastDataPort;         ///< Port of the data channel
+        uint32_t m_multicastDataMtu;          ///< Largest datagram sent
+        uint8_t m_multicastDataTtl;           ///< Hops datagrams may travel
+        std::set<core::TopicId> m_multicastTopics; ///< Topics sent over the data channel, set by init
+        std::shared_ptr<boost::asio::ip::udp::socket> m_multicastDataSocket;
+        std::unique_ptr<BatchUdpSocket> m_multicastDataBatch; ///< Fragments of a frame, under m_multicastMutex
+        boost::asio::ip::udp::endpoint m_multicastDataEndpoint;
+        std::mutex m_multicastMutex;          ///< Orders the frames of the data channel
+        uint32_t m_multicastSequence;         ///< Sequence number of the next frame, under m_multicastMutex
+        uint64_t m_multicastNacks;            ///< Gaps reported by clients, under m_multicastMutex
+
+        std::set<core::TopicId> m_snapshotTopics; ///< State topics new clients receive after their hello, set by init
+        std::mutex m_snapshotsMutex;
+        std::unordered_map<core::TopicId, Snapshot>
+            m_snapshots;                      ///< Last message of the state and multicast topics, under m_snapshotsMutex
+
+        bool m_trace;                         ///< Messages carry a MessageTrace, stamped here
+        uint32_t m_traceNodeId;               ///< Origin of the messages published here, random if 0
+        uint32_t m_traceReportPeriodMs;       ///< Statistics are logged on stop only if 0
+        std::unique_ptr<util::network::MessageTracer> m_tracer; ///< Set by init when m_trace is
+        std::optional<core::TimerId> m_traceReportTimer;
+
+        uint32_t m_presentationDelayMs;       ///< Lead of the presentation time stamped on the presentation topics
+        std::set<core::TopicId> m_presentationTopics; ///< Frames clients present together, set by init
 
         std::shared_ptr<boost::asio::io_context> m_ioContext;
         std::unique_ptr<boost::asio::executor_work_guard<boost::asio::io_context::executor_type>> m_workGuard;
+#ifdef BREADCRUMBS_IO_URING
+        std::unique_ptr<UringBackend> m_uring; ///< Serves the clients instead of m_ioContext when set
+#endif
 
-        std::set<std::shared_ptr<boost::asio::ip::tcp::socket>> m_connectedClients;
+        std::set<std::shared_ptr<Session>> m_sessions;
+        std::set<std::shared_ptr<Session>> m_unfilteredSessions; ///< Clients that never subscribed, receive every topic
+        std::set<std::shared_ptr<Session>> m_snapshotSessions;   ///< Clients owed the snapshots, until their wire format is known
+        std::unordered_map<core::TopicId, std::set<std::shared_ptr<Session>>> m_topicSessions; ///< Subscribed clients per topic
+        std::map<std::shared_ptr<Session>, std::set<core::TopicId>> m_subscriptions;          ///< Topics per subscribed client
+        std::unordered_map<core::MessageId, core::TopicId> m_forwardedTopics; ///< Topics broadcast to clients, set by init
+        std::set<std::shared_ptr<Session>> m_multicastSessions; ///< Clients receiving the multicast topics over the data channel
+        std::map<std::shared_ptr<Session>, ClientHeartbeat> m_heartbeats; ///< Clients sending heartbeats
+        util::network::FramePool m_framePool; ///< Broadcast frames, reused once every client queue sent them
         std::shared_ptr<std::mutex> m_clientsMutex;
-        std::vector<std::thread> m_runners;
+        std::vector<std::thread> m_runners; ///< Threads running m_ioContext
+        uint64_t m_evictions;               ///< Clients disconnected for being too slow, under m_clientsMutex
+        uint32_t m_heartbeatTimeoutMs;      ///< Silence after which a client is considered dead, never if 0
+        std::optional<core::TimerId> m_heartbeatTimer;
+        uint32_t m_clientReportPeriodMs;    ///< Queue counters of the clients are published this often, never if 0
+        std::optional<core::TimerId> m_clientReportTimer;
+        std::map<std::shared_ptr<Session>, uint64_t> m_reportedLosses; ///< Messages dropped or conflated at the last report
+        uint64_t m_reportedEvictions;       ///< Evictions at the last report, under m_clientsMutex
         bool m_isActive;
-
-        boost::asio::ip::udp::endpoint multicast_client_endpoint;
     };
 }
 
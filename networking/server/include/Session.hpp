@@ -0,0 +1,195 @@
+/**
+ * @file Session.hpp
+ *
+ * @brief Connection of a client to the network server.
+ *        Outgoing messages are queued and written in order; everything
+ *        queued while a write is in flight goes out in the next single
+ *        gather write. The queue is bounded: a client that does not keep
+ *        up is handled according to its SlowConsumerPolicy.
+ *        The socket I/O is left to the transport deriving from Session,
+ *        which also runs all operations of a session one at a time.
+ *
+ * @author Nicolae Natea
+ * Contact: nicu@natea.ro
+ */
+
+#ifndef _CORE_NETWORKING_SESSION_
+#define _CORE_NETWORKING_SESSION_
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <boost/asio.hpp>
+
+#include <core/Component.hpp>
+#include <core/util/EnumCast.hpp>
+#include <util/network/BinaryMessage.hpp>
+#include <util/network/FrameReader.hpp>
+
+namespace networking
+{
+    /** Action taken when a client queue exceeds its limits */
+    enum struct SlowConsumerPolicy
+    {
+        DROP_OLDEST, ///< Drop the oldest queued messages
+        CONFLATE,    ///< Replace the queued message of the same topic, else drop the oldest
+        DISCONNECT   ///< Close the connection
+    };
+
+    static const core::util::EnumCast<SlowConsumerPolicy> slow_consumer_policy_map =
+        core::util::EnumCast<SlowConsumerPolicy>
+            (SlowConsumerPolicy::DROP_OLDEST, "drop-oldest")
+            (SlowConsumerPolicy::CONFLATE,    "conflate")
+            (SlowConsumerPolicy::DISCONNECT,  "disconnect");
+
+    /** Bounds of the outgoing queue of a client */
+    struct SessionLimits
+    {
+        size_t maxQueuedBytes;     ///< Bytes waiting to be written
+        size_t maxQueuedMessages;  ///< Messages waiting to be written
+        SlowConsumerPolicy policy; ///< Action taken when a bound is exceeded
+    };
+
+    /** Outgoing queue counters of a client */
+    struct SessionStatistics
+    {
+        uint64_t queuedBytes;    ///< Bytes waiting or being written
+        uint64_t queuedMessages; ///< Messages waiting or being written
+        uint64_t sentMessages;   ///< Messages written to the socket
+        uint64_t writeCount;     ///< Write operations used to send them
+        uint64_t dropped;        ///< Messages dropped by DROP_OLDEST
+        uint64_t conflated;      ///< Messages replaced by a newer one of the same topic
+        bool evicted;            ///< Disconnected by the DISCONNECT policy
+    };
+
+    class Session : public std::enable_shared_from_this<Session>
+    {
+    public:
+        /** Called on the session strand for each received message, with its extensions */
+        typedef std::function<void (
+            const std::shared_ptr<Session> &,
+            std::string_view,
+            std::string_view,
+            const util::network::MessageExtensions &)> MessageCallback;
+
+        /** Called once, when the connection is closed */
+        typedef std::function<void (const std::shared_ptr<Session> &)> CloseCallback;
+
+        /** Topic of control messages, which are never dropped */
+        static const core::TopicId CONTROL_TOPIC = UINT32_MAX;
+
+        /**
+         * @param[in] remoteIp address of the client, used in logs
+         * @param[in] maxFrameSize largest accepted frame
+         * @param[in] limits bounds of the outgoing queue
+         * @param[in] onMessage handler of received messages
+         * @param[in] onClose handler of the disconnection
+         */
+        Session(
+            const std::string &remoteIp,
+            size_t maxFrameSize,
+            const SessionLimits &limits,
+            MessageCallback onMessage,
+            CloseCallback onClose);
+
+        virtual ~Session() = default;
+
+        /** Starts reading from the client */
+        virtual void start() = 0;
+
+        /**
+         * Queues an encoded message for sending, may be called from any thread
+         *
+         *  @param[in] topic topic of the message, used for conflation
+         *  @param[in] buf encoded message
+         */
+        virtual void send(core::TopicId topic, std::shared_ptr<std::string> buf) = 0;
+
+        /** Closes the connection, may be called from any thread */
+        virtual void close() = 0;
+
+        /** @return address of the client */
+        const std::string &getRemoteIp() const;
+
+        /** @return wire format used towards the client */
+        util::network::WireFormat getWireFormat() const;
+
+        /** Selects the wire format used towards the client */
+        void setWireFormat(util::network::WireFormat format);
+
+        /** @return true once the client sent a text message, only read on the session strand */
+        bool isTextPeer() const;
+
+        /** @return copy of the outgoing queue counters */
+        SessionStatistics getStatistics() const;
+
+        /** @return when data was last received from the client, or the session created */
+        std::chrono::steady_clock::time_point getLastReceived() const;
+
+    protected:
+        // Transport, called one at a time
+        /** Reads more from the client into m_reader, then calls handleRead() */
+        virtual void read() = 0;
+
+        /** Writes m_writeBuffers in full, then calls handleWrite() */
+        virtual void startWrite() = 0;
+
+        /** Closes the socket, pending operations complete with an error */
+        virtual void closeSocket() = 0;
+
+        /**
+         * Closes the connection once the current operation returned, never
+         * inline: the sender may hold locks the close handler takes
+         */
+        virtual void closeLater() = 0;
+
+        /** Queues a message and starts writing if idle */
+        void doSend(core::TopicId topic, std::shared_ptr<std::string> buf);
+
+        void handleRead(const boost::system::error_code &ec, size_t readSize);
+        void doClose();
+        void enqueue(core::TopicId topic, std::shared_ptr<std::string> buf);
+        void write();
+        void handleWrite(const boost::system::error_code &ec, size_t bytesSent);
+
+        util::network::FrameReader m_reader;
+        std::vector<boost::asio::const_buffer> m_writeBuffers; ///< Gather list of the current write
+        bool m_isClosed;   ///< Only accessed by the session operations
+        bool m_isEvicted;  ///< Closing for being too slow, nothing more is queued
+        bool m_isTextPeer; ///< Sent an unframed text archive, warned about once
+
+    private:
+        std::string m_remoteIp;
+        size_t m_maxFrameSize;
+        std::atomic<util::network::WireFormat> m_wireFormat;
+        MessageCallback m_onMessage;
+        CloseCallback m_onClose;
+        std::atomic<std::chrono::steady_clock::rep> m_lastReceived; ///< Read from other threads
+
+        /** Message waiting to be written */
+        struct Outgoing
+        {
+            core::TopicId topic;
+            std::shared_ptr<std::string> buf;
+        };
+
+        SessionLimits m_limits;
+        std::deque<Outgoing> m_writeQueue;                     ///< Waiting for the next write
+        size_t m_writeQueueBytes;                              ///< Size of the messages in m_writeQueue
+        std::vector<std::shared_ptr<std::string>> m_inFlight;  ///< Owned by the current write
+        size_t m_inFlightBytes;                                ///< Size of the messages in m_inFlight
+
+        mutable std::mutex m_statisticsMutex; ///< Counters are read from other threads
+        SessionStatistics m_statistics;
+    };
+}
+
+#endif /* _CORE_NETWORKING_SESSION_ */
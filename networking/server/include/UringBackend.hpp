@@ -0,0 +1,146 @@
+/**
+ * @file UringBackend.hpp
+ *
+ * @brief io_uring engine serving the clients of the network server.
+ *        A single thread owns the ring: listening sockets are served by
+ *        multishot accepts and each client by a multishot receive into
+ *        a registered ring of provided buffers, so no request is re-armed
+ *        per message. Sends of all clients are gathered into one
+ *        io_uring_enter, which is what a high fan-out relay spends most
+ *        of its system calls on with the reactor.
+ *        Other threads hand work to the ring thread through a command
+ *        queue and wake it through an eventfd only when it sleeps.
+ *
+ * @author Nicolae Natea
+ * Contact: nicu@natea.ro
+ */
+
+#ifndef _CORE_NETWORKING_URING_BACKEND_
+#define _CORE_NETWORKING_URING_BACKEND_
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include <IoUring.hpp>
+#include <Session.hpp>
+
+namespace networking
+{
+    namespace
+    {
+        const unsigned URING_ENTRIES = 1024;
+        const uint16_t URING_RECEIVE_BUFFERS = 512;
+        const size_t URING_RECEIVE_BUFFER_SIZE = 4096;
+        const uint16_t URING_RECEIVE_GROUP = 0;
+    }
+
+    class UringSession;
+
+    class UringBackend
+    {
+    public:
+        /** Called on the ring thread for each accepted client, which then belongs to the callee */
+        typedef std::function<void (int fd, const std::string &remoteIp)> AcceptCallback;
+
+        /**
+         * @param[in] onAccept handler of new clients
+         * @throws std::system_error if io_uring is not available
+         */
+        explicit UringBackend(AcceptCallback onAccept);
+        ~UringBackend();
+
+        /**
+         * Accepts the clients of a listening socket, which must stay open
+         * while the backend runs. Called before start().
+         *
+         * @param[in] fd listening socket
+         * @param[in] isLocal true for the unix domain socket
+         */
+        void listen(int fd, bool isLocal);
+
+        /** Starts the ring thread */
+        void start();
+
+        /** Closes the remaining sessions and joins the ring thread */
+        void stop();
+
+    private:
+        friend class UringSession;
+
+        /** Kind of a request, kept in the low byte of its user data next to the session or listener id */
+        enum Operation : uint64_t
+        {
+            ACCEPT = 1,
+            WAKE,
+            RECEIVE,
+            SEND
+        };
+
+        static uint64_t toUserData(uint64_t id, Operation operation)
+        {
+            return (id << 8) | operation;
+        }
+
+        /** Work handed to the ring thread */
+        struct Command
+        {
+            enum Type
+            {
+                START,
+                SEND,
+                CLOSE
+            };
+
+            Type type;
+            std::shared_ptr<UringSession> session;
+            core::TopicId topic;
+            std::shared_ptr<std::string> buf;
+        };
+
+        /** Queues a command for the ring thread, may be called from any thread */
+        void post(Command command);
+
+        // Ring thread
+        void run();
+        void processCommands();
+        void handleCompletion(const struct io_uring_cqe &cqe);
+        void handleAccept(size_t listener, const struct io_uring_cqe &cqe);
+        void handleReceive(uint64_t id, const struct io_uring_cqe &cqe);
+
+        /** Tracks a session and starts receiving, on the first command for it */
+        void adopt(const std::shared_ptr<UringSession> &session);
+
+        /** Arms the multishot receive of a session */
+        void receive(UringSession &session);
+
+        /** Forgets a closed session once the kernel is done with it */
+        void settle(const std::shared_ptr<UringSession> &session);
+
+        IoUring m_ring;
+        ProvidedBuffers m_buffers;                      ///< Receive buffers shared by all clients
+        AcceptCallback m_onAccept;
+        std::vector<std::pair<int, bool>> m_listeners;  ///< Listening sockets and whether they are local
+        std::thread m_thread;
+        std::atomic<bool> m_isRunning;
+
+        int m_wakeFd;                                   ///< eventfd interrupting the wait for completions
+        uint64_t m_wakeValue;                           ///< Read from m_wakeFd by the ring
+        std::atomic<bool> m_isSleeping;                 ///< The ring thread waits for completions
+
+        std::mutex m_commandsMutex;
+        std::vector<Command> m_commands;                ///< Filled by any thread
+        std::vector<Command> m_pending;                 ///< Being processed by the ring thread
+
+        std::unordered_map<uint64_t, std::shared_ptr<UringSession>> m_sessions; ///< Started sessions by id
+        uint64_t m_nextId;
+    };
+}
+
+#endif /* _CORE_NETWORKING_URING_BACKEND_ */
@@ -0,0 +1,93 @@
+/**
+ * @file UringSession.hpp
+ *
+ * @brief Session whose socket is driven by the io_uring backend.
+ *        All its operations run on the ring thread. Received data comes
+ *        from the provided buffers of the backend and is copied into the
+ *        frame reader; queued messages are sent with a single sendmsg
+ *        gathering them in place.
+ *
+ * @author Nicolae Natea
+ * Contact: nicu@natea.ro
+ */
+
+#ifndef _CORE_NETWORKING_URING_SESSION_
+#define _CORE_NETWORKING_URING_SESSION_
+
+#include <sys/socket.h>
+#include <sys/uio.h>
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <Session.hpp>
+#include <UringBackend.hpp>
+
+namespace networking
+{
+    class UringSession : public Session
+    {
+    public:
+        /**
+         * @param[in] backend backend driving the socket
+         * @param[in] fd connected socket, closed with the session
+         * @param[in] remoteIp address of the client, used in logs
+         * @param[in] maxFrameSize largest accepted frame
+         * @param[in] limits bounds of the outgoing queue
+         * @param[in] onMessage handler of received messages
+         * @param[in] onClose handler of the disconnection
+         */
+        UringSession(
+            UringBackend &backend,
+            int fd,
+            const std::string &remoteIp,
+            size_t maxFrameSize,
+            const SessionLimits &limits,
+            MessageCallback onMessage,
+            CloseCallback onClose);
+
+        ~UringSession() override;
+
+        void start() override;
+        void send(core::TopicId topic, std::shared_ptr<std::string> buf) override;
+        void close() override;
+
+    protected:
+        void read() override;
+        void startWrite() override;
+        void closeSocket() override;
+        void closeLater() override;
+
+    private:
+        friend class UringBackend;
+
+        /** Hands received bytes to the frame reader */
+        void received(const char *data, size_t size);
+
+        /** Ends the session on end of stream (0) or a receive error (-errno) */
+        void receiveFailed(int result);
+
+        /** Handles the completion of a sendmsg */
+        void sent(int result);
+
+        /** Queues a sendmsg for the part of the write not sent yet */
+        void submitWrite();
+
+        std::shared_ptr<UringSession> getSelf();
+
+        UringBackend &m_backend;
+        int m_fd;
+        uint64_t m_id;                   ///< Key of the session in the backend, set once started
+        bool m_isReceiving;              ///< A multishot receive is armed
+        bool m_isSending;                ///< A sendmsg is in flight
+
+        std::vector<struct iovec> m_iovecs; ///< Gather list of the current write
+        size_t m_iovecOffset;               ///< First entry not sent in full
+        size_t m_writeSize;                 ///< Bytes of the current write
+        struct msghdr m_message;
+    };
+}
+
+#endif /* _CORE_NETWORKING_URING_SESSION_ */
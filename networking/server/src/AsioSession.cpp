@@ -0,0 +1,76 @@
+/**
+ * @file AsioSession.cpp
+ *
+ * @author Nicolae Natea
+ * Contact: nicu@natea.ro
+ */
+
+#include <AsioSession.hpp>
+
+namespace networking
+{
+    AsioSession::AsioSession(
+        boost::asio::generic::stream_protocol::socket socket,
+        const std::string &remoteIp,
+        size_t maxFrameSize,
+        const SessionLimits &limits,
+        MessageCallback onMessage,
+        CloseCallback onClose) :
+        Session(remoteIp, maxFrameSize, limits, onMessage, onClose),
+        m_socket(std::move(socket))
+    {
+    }
+
+    void AsioSession::start()
+    {
+        boost::asio::dispatch(m_socket.get_executor(), [self = shared_from_this(), this] { read(); });
+    }
+
+    void AsioSession::send(core::TopicId topic, std::shared_ptr<std::string> buf)
+    {
+        boost::asio::dispatch(
+            m_socket.get_executor(),
+            [self = shared_from_this(), this, topic, buf]
+            {
+                doSend(topic, buf);
+            });
+    }
+
+    void AsioSession::close()
+    {
+        boost::asio::dispatch(m_socket.get_executor(), [self = shared_from_this(), this] { doClose(); });
+    }
+
+    void AsioSession::closeLater()
+    {
+        boost::asio::post(m_socket.get_executor(), [self = shared_from_this(), this] { doClose(); });
+    }
+
+    void AsioSession::read()
+    {
+        m_socket.async_read_some(
+            boost::asio::buffer(m_reader.prepare(), m_reader.writable()),
+            [self = shared_from_this(), this](const boost::system::error_code &ec, size_t readSize)
+            {
+                handleRead(ec, readSize);
+            });
+    }
+
+    void AsioSession::startWrite()
+    {
+        boost::asio::async_write(
+            m_socket,
+            m_writeBuffers,
+            [self = shared_from_this(), this](const boost::system::error_code &ec, size_t bytesSent)
+            {
+                handleWrite(ec, bytesSent);
+            });
+    }
+
+    void AsioSession::closeSocket()
+    {
+        boost::system::error_code error;
+        m_socket.shutdown(boost::asio::ip::tcp::socket::shutdown_both, error);
+        m_socket.close(error);
+    }
+}
@@ -7,8 +7,19 @@
 
 #include <Server.hpp>
 
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdlib>
+#include <iterator>
+#include <optional>
+#include <system_error>
+
 #include <core/logger/event_logger.h>
-#include <util/network/Message.hpp>
+#include <util/network/ControlMessage.hpp>
+#include <util/network/Datagram.hpp>
+#include <util/network/LocalTransport.hpp>
+#include <util/network/MessageCodec.hpp>
 
 namespace networking
 {
@@ -23,8 +34,35 @@ namespace networking
         m_multicastPort(5000),
         m_serverListenAddress("0.0.0.0"),
         m_serverListenPort(3000),
-        m_isActive(true),
-        m_serverMaxRxMsgSizeKb(16)
+        m_serverMaxRxMsgSizeKb(16),
+        m_serverThreads(DEFAULT_SERVER_THREADS),
+#ifdef BREADCRUMBS_IO_URING
+        m_backend(ServerBackend::IO_URING),
+#else
+        m_backend(ServerBackend::ASIO),
+#endif
+        m_sessionLimits{
+            DEFAULT_CLIENT_MAX_QUEUED_KB * 1024,
+            DEFAULT_CLIENT_MAX_QUEUED_MESSAGES,
+            SlowConsumerPolicy::DROP_OLDEST},
+        m_wireFormat(util::network::WireFormat::BINARY),
+        m_local(true),
+        m_multicastData(false),
+        m_multicastDataAddress("239.255.0.2"),
+        m_multicastDataPort(5001),
+        m_multicastDataMtu(DEFAULT_MULTICAST_DATA_MTU),
+        m_multicastDataTtl(1),
+        m_multicastSequence(0),
+        m_multicastNacks(0),
+        m_trace(false),
+        m_traceNodeId(0),
+        m_traceReportPeriodMs(0),
+        m_presentationDelayMs(0),
+        m_evictions(0),
+        m_heartbeatTimeoutMs(3000),
+        m_clientReportPeriodMs(10000),
+        m_reportedEvictions(0),
+        m_isActive(true)
     {
         addPrototype(DOMAIN, this);
     }
@@ -36,6 +74,27 @@ namespace networking
         m_serverListenPort     = other.m_serverListenPort;
         m_isActive             = other.m_isActive;
         m_serverMaxRxMsgSizeKb = other.m_serverMaxRxMsgSizeKb;
+        m_serverThreads        = other.m_serverThreads;
+        m_backend              = other.m_backend;
+        m_sessionLimits        = other.m_sessionLimits;
+        m_evictions            = 0;
+        m_heartbeatTimeoutMs   = other.m_heartbeatTimeoutMs;
+        m_clientReportPeriodMs = other.m_clientReportPeriodMs;
+        m_reportedEvictions    = 0;
+        m_wireFormat           = other.m_wireFormat;
+        m_local                = other.m_local;
+        m_localPath            = other.m_localPath;
+        m_multicastData        = other.m_multicastData;
+        m_multicastDataAddress = other.m_multicastDataAddress;
+        m_multicastDataPort    = other.m_multicastDataPort;
+        m_multicastDataMtu     = other.m_multicastDataMtu;
+        m_multicastDataTtl     = other.m_multicastDataTtl;
+        m_multicastSequence    = 0;
+        m_multicastNacks       = 0;
+        m_trace                = other.m_trace;
+        m_traceNodeId          = other.m_traceNodeId;
+        m_traceReportPeriodMs  = other.m_traceReportPeriodMs;
+        m_presentationDelayMs  = other.m_presentationDelayMs;
     }
 
     Server *Server::clone() const
@@ -51,7 +110,64 @@ namespace networking
         m_multicastPort = conf.get<uint16_t>("multicast.port", m_multicastPort);
         m_serverListenAddress = conf.get<std::string>("server.tcp.address", m_serverListenAddress);
         m_serverListenPort = conf.get<uint16_t>("server.tcp.port", m_serverListenPort);
+        m_local = conf.get<bool>("server.local.enabled", m_local);
+        m_localPath = conf.get<std::string>(
+            "server.local.path", util::network::LocalTransport::getDefaultPath(m_serverListenPort));
         m_serverMaxRxMsgSizeKb = conf.get<uint32_t>("server.max.rx-size-kb", m_serverMaxRxMsgSizeKb);
+        m_serverThreads = std::max<uint32_t>(1, conf.get<uint32_t>("server.threads", m_serverThreads));
+        m_backend = server_backend_map(conf.get<std::string>("server.backend", server_backend_map(m_backend)));
+        m_sessionLimits.maxQueuedBytes = 1024 * conf.get<size_t>(
+            "server.client.max-queued-kb", m_sessionLimits.maxQueuedBytes / 1024);
+        m_sessionLimits.maxQueuedMessages = conf.get<size_t>(
+            "server.client.max-queued-messages", m_sessionLimits.maxQueuedMessages);
+        m_sessionLimits.policy = slow_consumer_policy_map(conf.get<std::string>(
+            "server.client.slow-policy", slow_consumer_policy_map(m_sessionLimits.policy)));
+        m_wireFormat = util::network::wire_format_map(
+            conf.get<std::string>("server.wire-format", util::network::wire_format_map(m_wireFormat)));
+        m_multicastData = conf.get<bool>("server.multicast-data.enabled", m_multicastData);
+        m_multicastDataAddress = conf.get<std::string>("server.multicast-data.group", m_multicastDataAddress);
+        m_multicastDataPort = conf.get<uint16_t>("server.multicast-data.port", m_multicastDataPort);
+        m_multicastDataMtu = conf.get<uint32_t>("server.multicast-data.mtu", m_multicastDataMtu);
+        m_multicastDataTtl = conf.get<uint8_t>("server.multicast-data.ttl", m_multicastDataTtl);
+        m_heartbeatTimeoutMs = conf.get<uint32_t>("server.heartbeat.timeout-ms", m_heartbeatTimeoutMs);
+        m_clientReportPeriodMs = conf.get<uint32_t>("server.client.report-period-ms", m_clientReportPeriodMs);
+        m_trace = conf.get<bool>("trace.enabled", m_trace);
+        m_traceNodeId = conf.get<uint32_t>("trace.node-id", m_traceNodeId);
+        m_traceReportPeriodMs = conf.get<uint32_t>("trace.report-period-ms", m_traceReportPeriodMs);
+        m_presentationDelayMs = conf.get<uint32_t>("server.presentation.delay-ms", m_presentationDelayMs);
+
+#ifndef BREADCRUMBS_IO_URING
+        if (m_backend == ServerBackend::IO_URING)
+        {
+            LOG_WARNING(DOMAIN, "Built without BREADCRUMBS_IO_URING, serving clients with asio");
+            m_backend = ServerBackend::ASIO;
+        }
+#endif
+
+        if (m_wireFormat == util::network::WireFormat::TEXT)
+        {
+            LOG_WARNING(DOMAIN, "Text wire format is deprecated, unframed messages sharing a read are dropped");
+        }
+
+        if (m_multicastData and (m_wireFormat != util::network::WireFormat::BINARY))
+        {
+            LOG_WARNING(DOMAIN, "Multicast data channel needs binary frames, disabled");
+            m_multicastData = false;
+        }
+
+        if (m_trace)
+        {
+            m_tracer = std::make_unique<util::network::MessageTracer>(
+                m_traceNodeId ? m_traceNodeId : util::network::MessageTracer::makeNodeId());
+            LOG_INFO(DOMAIN, "Tracing messages as node %u", m_tracer->getNodeId());
+
+            if (m_traceReportPeriodMs)
+            {
+                m_traceReportTimer = setPeriodicTimer(
+                    [this](const boost::system::error_code &e) { reportTraces(); },
+                    std::chrono::milliseconds{m_traceReportPeriodMs});
+            }
+        }
 
         // Broascast message
         boost::property_tree::ptree defaultSubscribe;
@@ -62,7 +178,70 @@ namespace networking
         {
             std::string msgName = subscription.second.get<std::string>("");
             LOG_ERROR(DOMAIN, "Subscribing to [%s] to handle network broadcasts", msgName.c_str());
-            subscribe(msgName, std::bind(&Server::sendBroadcast, this, msgName, std::placeholders::_1));
+            core::TopicId topic = core::Component::advertise(msgName);
+            m_forwardedTopics[msgName] = topic;
+            subscribe(msgName, std::bind(&Server::sendBroadcast, this, msgName, topic, std::placeholders::_1));
+        }
+
+        // State topics sent once over the data channel, all broadcast ones unless listed
+        if (auto multicastTopics = conf.get_child_optional("server.multicast-data.topics"))
+        {
+            for (auto &multicastTopic : *multicastTopics)
+            {
+                std::string msgName = multicastTopic.second.get<std::string>("");
+                auto forwarded = m_forwardedTopics.find(msgName);
+
+                if (forwarded == m_forwardedTopics.end())
+                {
+                    LOG_WARNING(DOMAIN, "Multicast topic [%s] is not broadcast, ignoring", msgName.c_str());
+                    continue;
+                }
+
+                m_multicastTopics.insert(forwarded->second);
+            }
+        }
+        else
+        {
+            for (auto &forwarded : m_forwardedTopics)
+            {
+                m_multicastTopics.insert(forwarded.second);
+            }
+        }
+
+        // State topics whose last message is pushed to new clients
+        if (auto snapshotTopics = conf.get_child_optional("server.snapshot.topics"))
+        {
+            for (auto &snapshotTopic : *snapshotTopics)
+            {
+                std::string msgName = snapshotTopic.second.get<std::string>("");
+                auto forwarded = m_forwardedTopics.find(msgName);
+
+                if (forwarded == m_forwardedTopics.end())
+                {
+                    LOG_WARNING(DOMAIN, "Snapshot topic [%s] is not broadcast, ignoring", msgName.c_str());
+                    continue;
+                }
+
+                m_snapshotTopics.insert(forwarded->second);
+            }
+        }
+
+        // Frames clients present together, stamped with a time far enough ahead for all of them to have it
+        if (auto presentationTopics = conf.get_child_optional("server.presentation.topics"))
+        {
+            for (auto &presentationTopic : *presentationTopics)
+            {
+                std::string msgName = presentationTopic.second.get<std::string>("");
+                auto forwarded = m_forwardedTopics.find(msgName);
+
+                if (forwarded == m_forwardedTopics.end())
+                {
+                    LOG_WARNING(DOMAIN, "Presentation topic [%s] is not broadcast, ignoring", msgName.c_str());
+                    continue;
+                }
+
+                m_presentationTopics.insert(forwarded->second);
+            }
         }
     }
 
@@ -74,12 +253,108 @@ namespace networking
             *m_ioContext,
             boost::asio::ip::tcp::endpoint(boost::asio::ip::make_address(m_serverListenAddress), m_serverListenPort));
         m_clientsMutex = std::make_shared<std::mutex>();
-        startListeningTcp();
+
+        if (m_local)
+        {
+            // A stale socket file of a previous run would make bind fail
+            if (not util::network::LocalTransport::isAbstract(m_localPath))
+            {
+                ::unlink(m_localPath.c_str());
+            }
+
+            try
+            {
+                m_localAcceptor = std::make_shared<boost::asio::local::stream_protocol::acceptor>(
+                    *m_ioContext,
+                    boost::asio::local::stream_protocol::endpoint(util::network::LocalTransport::toSocketPath(m_localPath)));
+
+                LOG_INFO(DOMAIN, "Listening for local clients on [%s]", m_localPath.c_str());
+            }
+            catch (const boost::system::system_error &e)
+            {
+                LOG_ERROR(DOMAIN, "Unable to listen on [%s], local clients use TCP: [%s]",
+                    m_localPath.c_str(),
+                    e.what());
+                m_localAcceptor.reset();
+            }
+        }
+
+#ifdef BREADCRUMBS_IO_URING
+        if (m_backend == ServerBackend::IO_URING)
+        {
+            // The ring accepts on the sockets bound above
+            try
+            {
+                m_uring = std::make_unique<UringBackend>(
+                    std::bind(&Server::addUringSession, this, std::placeholders::_1, std::placeholders::_2));
+                m_uring->listen(m_acceptor->native_handle(), false);
+
+                if (m_localAcceptor)
+                {
+                    m_uring->listen(m_localAcceptor->native_handle(), true);
+                }
+
+                m_uring->start();
+            }
+            catch (const std::system_error &e)
+            {
+                LOG_WARNING(DOMAIN, "io_uring unavailable, serving clients with asio: [%s]", e.what());
+                m_uring.reset();
+            }
+        }
+
+        if (not m_uring)
+#endif
+        {
+            startListeningTcp();
+
+            if (m_localAcceptor)
+            {
+                startListeningLocal();
+            }
+        }
+
+        if (m_multicastData)
+        {
+            m_multicastDataEndpoint = boost::asio::ip::udp::endpoint(
+                boost::asio::ip::make_address(m_multicastDataAddress), m_multicastDataPort);
+            m_multicastDataSocket = std::make_shared<boost::asio::ip::udp::socket>(
+                *m_ioContext, m_multicastDataEndpoint.protocol());
+            m_multicastDataSocket->set_option(boost::asio::ip::multicast::hops(m_multicastDataTtl));
+            m_multicastDataSocket->set_option(boost::asio::ip::multicast::enable_loopback(true));
+            m_multicastDataBatch = std::make_unique<BatchUdpSocket>(
+                *m_multicastDataSocket, UDP_BATCH_SIZE, m_multicastDataMtu);
+
+            LOG_INFO(DOMAIN, "Sending %zu topics over multicast data channel %s:%u",
+                m_multicastTopics.size(),
+                m_multicastDataAddress.c_str(),
+                m_multicastDataPort);
+        }
+
         m_advertisingThread = std::thread(&Server::startAdvertising, this);
 
+        // Checked twice per timeout, a dead client goes within 1.5 of it
+        if (m_heartbeatTimeoutMs)
+        {
+            m_heartbeatTimer = setPeriodicTimer(
+                [this](const boost::system::error_code &e) { checkHeartbeats(); },
+                std::chrono::milliseconds{std::max<uint32_t>(1, m_heartbeatTimeoutMs / 2)});
+        }
+
+        if (m_clientReportPeriodMs)
+        {
+            m_clientReportTimer = setPeriodicTimer(
+                [this](const boost::system::error_code &e) { reportClients(); },
+                std::chrono::milliseconds{m_clientReportPeriodMs});
+        }
+
+        // A fixed pool serves all connections, independent of their number
         m_workGuard = std::make_unique<boost::asio::executor_work_guard<boost::asio::io_context::executor_type>>(
             m_ioContext->get_executor());
-        m_broadcastThread = std::thread([this]{ this->m_ioContext->run(); });
+        for (uint32_t i = 0; i < m_serverThreads; ++i)
+        {
+            m_runners.emplace_back([this]{ this->m_ioContext->run(); });
+        }
 
         LOG_DEBUG(DOMAIN, "Exited %s", __PRETTY_FUNCTION__);
     }
@@ -90,8 +365,32 @@ namespace networking
 
         m_isActive = false;
         m_acceptor->close();
+
+        if (m_heartbeatTimer != std::nullopt)
+        {
+            cancelTimer(*m_heartbeatTimer);
+            m_heartbeatTimer.reset();
+        }
+
+        if (m_clientReportTimer != std::nullopt)
+        {
+            cancelTimer(*m_clientReportTimer);
+            m_clientReportTimer.reset();
+        }
+
         m_workGuard.reset();
 
+        if (m_localAcceptor)
+        {
+            boost::system::error_code error;
+            m_localAcceptor->close(error);
+
+            if (not util::network::LocalTransport::isAbstract(m_localPath))
+            {
+                ::unlink(m_localPath.c_str());
+            }
+        }
+
         if (m_multicastSocket->is_open())
         {
             LOG_DEBUG(DOMAIN, "Closing advertising socket");
@@ -100,12 +399,6 @@ namespace networking
             m_multicastSocket->close();
         }
 
-        if (m_broadcastThread.joinable())
-        {
-            LOG_DEBUG(DOMAIN, "Joining broadcast thread");
-            m_broadcastThread.join();
-        }
-
         if (m_advertisingThread.joinable())
         {
             LOG_DEBUG(DOMAIN, "Joining advertising thread");
@@ -117,20 +410,22 @@ namespace networking
             LOG_DEBUG(DOMAIN, "Closing sockets");
             std::scoped_lock<std::mutex> lock(*m_clientsMutex);
 
-            for (auto &sock : m_connectedClients)
+            for (auto &session : m_sessions)
             {
-                if (sock->is_open())
-                {
-                    boost::system::error_code error;
-                    sock->shutdown(boost::asio::ip::tcp::socket::shutdown_both, error);
-                    sock->close();
-                }
+                session->close();
             }
+        }
 
-            m_connectedClients.clear();
+#ifdef BREADCRUMBS_IO_URING
+        if (m_uring)
+        {
+            LOG_DEBUG(DOMAIN, "Joining the io_uring thread");
+            m_uring->stop();
+            m_uring.reset();
         }
+#endif
 
-        LOG_DEBUG(DOMAIN, "Joining all client threads");
+        LOG_DEBUG(DOMAIN, "Joining all server threads");
         for (auto &runner: m_runners)
         {
             if (runner.joinable())
@@ -139,38 +434,201 @@ namespace networking
             }
         }
 
+        m_runners.clear();
+
+        {
+            std::scoped_lock<std::mutex> lock(*m_clientsMutex);
+            m_sessions.clear();
+            m_unfilteredSessions.clear();
+            m_snapshotSessions.clear();
+            m_topicSessions.clear();
+            m_subscriptions.clear();
+            m_multicastSessions.clear();
+            m_heartbeats.clear();
+            m_reportedLosses.clear();
+
+            LOG_INFO(DOMAIN, "Clients disconnected for being too slow: %llu",
+                static_cast<unsigned long long>(m_evictions));
+        }
+
+        if (m_multicastDataSocket)
+        {
+            std::scoped_lock<std::mutex> lock(m_multicastMutex);
+
+            LOG_INFO(DOMAIN, "Multicast frames sent: %u, gaps reported by clients: %llu",
+                m_multicastSequence,
+                static_cast<unsigned long long>(m_multicastNacks));
+
+            boost::system::error_code error;
+            m_multicastDataSocket->close(error);
+        }
+
+        if (m_traceReportTimer != std::nullopt)
+        {
+            cancelTimer(*m_traceReportTimer);
+            m_traceReportTimer.reset();
+        }
+
+        reportTraces();
+
         LOG_DEBUG(DOMAIN, "Exited %s", __PRETTY_FUNCTION__);
     }
 
-    void Server::sendBroadcast(const core::MessageId &id, const core::MessageData &attrs)
+    void Server::sendBroadcast(const core::MessageId &id, core::TopicId topic, const core::MessageData &attrs)
     {
         LOG_DEBUG(DOMAIN, "Entered %s", __PRETTY_FUNCTION__);
 
-        util::network::Message message(id, attrs.get<std::string>("data"));
-        std::shared_ptr<std::string> buf = std::make_shared<std::string>(message.toString());
+        core::util::SharedBuffer data = attrs.get<core::util::SharedBuffer>("data");
+
+        // Messages from a client carry on with their trace, the ones published here start one
+        util::network::MessageExtensions extensions;
+        if (m_tracer)
+        {
+            attrs.get_optional("trace", extensions.trace);
+            extensions.trace = extensions.trace ? m_tracer->forward(*extensions.trace) : m_tracer->start(id);
+        }
+
+        // Clients present the frame at the time it was scheduled for, on the clock of this server
+        std::optional<std::chrono::steady_clock::time_point> presentAt;
+        attrs.get_optional("present_at", presentAt);
+        if (not presentAt and (m_presentationTopics.count(topic) != 0))
+        {
+            presentAt = std::chrono::steady_clock::now() + std::chrono::milliseconds(m_presentationDelayMs);
+        }
+
+        if (presentAt)
+        {
+            extensions.presentAt = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                presentAt->time_since_epoch()).count();
+        }
+
+        bool stamped = extensions.trace or extensions.presentAt;
+
+        // Encoded at most once per wire format in use, into frames the client queues released
+        std::shared_ptr<std::string> textBuf;
+        std::shared_ptr<std::string> binaryBuf;
+        auto encode = [&](util::network::WireFormat format)
+        {
+            std::shared_ptr<std::string> buf = m_framePool.acquire();
+            util::network::MessageCodec::encode(format, id, data.str(), *buf, extensions);
+            return buf;
+        };
+
+        // Clients on the data channel get the frame there, sent once for all of them
+        bool multicast = m_multicastDataSocket and (m_multicastTopics.count(topic) != 0);
+
+        if (multicast)
+        {
+            binaryBuf = encode(util::network::WireFormat::BINARY);
+            sendMulticast(id, topic, data, *binaryBuf);
+        }
+
+        // Kept before any client gets it, so one connecting meanwhile misses nothing.
+        // Stamped frames are not reused, a snapshot sent later is neither a hop of the message
+        // nor due at the time it was scheduled for
+        if (multicast or (m_snapshotTopics.count(topic) != 0))
+        {
+            keepSnapshot(topic, id, data, stamped ? nullptr : textBuf, stamped ? nullptr : binaryBuf);
+        }
+
+        auto sendTo = [&](const std::shared_ptr<Session> &session)
+        {
+            if (multicast and (m_multicastSessions.count(session) != 0))
+            {
+                return;
+            }
+
+            util::network::WireFormat format = session->getWireFormat();
+            std::shared_ptr<std::string> &buf =
+                (format == util::network::WireFormat::BINARY) ? binaryBuf : textBuf;
+
+            if (not buf)
+            {
+                buf = encode(format);
+            }
+
+            session->send(topic, buf);
+        };
 
         std::scoped_lock<std::mutex> lock(*m_clientsMutex);
 
-        for (auto sock : m_connectedClients)
+        // Only the clients interested in the topic are touched
+        for (auto &session : m_unfilteredSessions)
         {
-            if (sock->is_open())
+            sendTo(session);
+        }
+
+        auto interested = m_topicSessions.find(topic);
+        if (interested != m_topicSessions.end())
+        {
+            for (auto &session : interested->second)
             {
-                auto broadcast_handler = [this, sock, buf](const boost::system::error_code &ec, size_t bytes_sent)
-                {
-                    if (ec)
-                    {
-                        //std::string clientIp = sock.get()->remote_endpoint().address().to_string().c_str();
-                        //LOG_ERROR(DOMAIN, "Error[%c] while broadcasting message to %s", clientIp.c_str());
-                        LOG_ERROR(DOMAIN, "Error while broadcasting message to %p", sock.get());
-                    }
-                };
-                sock->async_send(boost::asio::buffer(*buf), broadcast_handler);
+                sendTo(session);
             }
         }
 
         LOG_DEBUG(DOMAIN, "Exited %s", __PRETTY_FUNCTION__);
     }
 
+    void Server::sendMulticast(
+        const core::MessageId &id,
+        core::TopicId topic,
+        const core::util::SharedBuffer &data,
+        const std::string &frame)
+    {
+        std::scoped_lock<std::mutex> lock(m_multicastMutex);
+
+        // Fragments leave in batches, a single system call for most frames
+        boost::system::error_code error;
+        size_t lost = 0;
+        auto flush = [this, &error, &lost]()
+            {
+                size_t pending = m_multicastDataBatch->getPendingCount();
+                boost::system::error_code flushError;
+                lost += pending - m_multicastDataBatch->flush(flushError);
+
+                // The first failure is the one worth reporting
+                if (flushError and not error)
+                {
+                    error = flushError;
+                }
+            };
+
+        size_t datagrams = util::network::Datagram::fragment(m_multicastSequence++, frame, m_multicastDataMtu,
+            [this, &flush, &lost](std::string_view header, std::string_view fragment)
+            {
+                if (m_multicastDataBatch->add(m_multicastDataEndpoint, header, fragment))
+                {
+                    return;
+                }
+
+                flush();
+
+                if (not m_multicastDataBatch->add(m_multicastDataEndpoint, header, fragment))
+                {
+                    ++lost;
+                }
+            });
+
+        flush();
+
+        if (error or (lost > 0))
+        {
+            LOG_ERROR(DOMAIN, "Error[%d] while sending multicast datagrams of [%s], %zu of %zu lost",
+                error.value(),
+                id.c_str(),
+                lost,
+                datagrams);
+        }
+
+        if (datagrams == 0)
+        {
+            LOG_ERROR(DOMAIN, "Message [%s] of %zu bytes too large for the multicast data channel",
+                id.c_str(),
+                frame.size());
+        }
+    }
+
     void Server::startAdvertising()
     {
         LOG_DEBUG(DOMAIN, "Entered %s", __PRETTY_FUNCTION__);
@@ -185,6 +643,7 @@ namespace networking
         m_multicastSocket->set_option(boost::asio::ip::udp::socket::reuse_address(true));
         m_multicastSocket->set_option(
             boost::asio::ip::multicast::join_group(boost::asio::ip::make_address(m_multicastAddress)));
+        m_discoveryBatch = std::make_unique<BatchUdpSocket>(*m_multicastSocket, UDP_BATCH_SIZE, 16);
         advertise();
         io.run();
 
@@ -195,44 +654,47 @@ namespace networking
     {
         LOG_DEBUG(DOMAIN, "Entered %s", __PRETTY_FUNCTION__);
 
-        std::shared_ptr<std::string> buf = std::make_shared<std::string>("pingpong");
-        m_multicastSocket->async_receive_from(
-            boost::asio::buffer(*buf),
-            multicast_client_endpoint,
-            [this, buf](const boost::system::error_code &ec, size_t length)
+        // A discovery storm is answered a batch at a time
+        m_discoveryBatch->asyncReceive(
+            [this](const boost::system::error_code &ec, size_t count)
             {
                 if (not ec)
                 {
-                    // Continue to advertise for other potential clients.
-                    advertise();
-
-                    LOG_DEBUG(DOMAIN, "Received[%s] request from %s.",
-                              (*buf).c_str(),
-                              multicast_client_endpoint.address().to_string().c_str());
+                    const char *message = "pong";
 
-                    if ((*buf).find("ping") == 0)
+                    for (size_t i = 0; i < count; ++i)
                     {
-                        const char *message = "pong";
-                        boost::system::error_code error;
-                        uint32_t sendBytes = m_multicastSocket->send_to(
-                            boost::asio::buffer(message, strlen(message)),
-                            this->multicast_client_endpoint,
-                            boost::asio::socket_base::message_flags(0),
-                            error);
-
-                        if (error)
-                        {
-                            LOG_ERROR(DOMAIN, "Error code[%d] while sending [%s]",
-                                error,
-                                message);
-                        }
-                        else
+                        std::string_view request = m_discoveryBatch->getDatagram(i);
+                        const boost::asio::ip::udp::endpoint &client = m_discoveryBatch->getSender(i);
+
+                        LOG_DEBUG(DOMAIN, "Received[%.*s] request from %s.",
+                                  static_cast<int>(request.size()),
+                                  request.data(),
+                                  client.address().to_string().c_str());
+
+                        // Whatever follows the ping is echoed, clients time their requests with it
+                        if (request.find("ping") == 0)
                         {
-                            LOG_DEBUG(DOMAIN, "Sent back [%s] to [%s].",
-                                message,
-                                multicast_client_endpoint.address().to_string().c_str());
+                            m_discoveryBatch->add(client, message, request.substr(4));
                         }
                     }
+
+                    boost::system::error_code error;
+                    size_t sent = m_discoveryBatch->flush(error);
+
+                    if (error)
+                    {
+                        LOG_ERROR(DOMAIN, "Error code[%d] while sending [%s]",
+                            error.value(),
+                            message);
+                    }
+                    else
+                    {
+                        LOG_DEBUG(DOMAIN, "Sent back [%s] to %zu clients.", message, sent);
+                    }
+
+                    // Continue to advertise for other potential clients.
+                    advertise();
                 }
                 else
                 {
@@ -256,25 +718,26 @@ namespace networking
 
         if (m_isActive)
         {
-            std::shared_ptr<boost::asio::ip::tcp::socket> sock = std::make_shared<boost::asio::ip::tcp::socket>(*m_ioContext);
-
+            // Each connection gets its own strand, so its handlers never run concurrently
             m_acceptor->async_accept(
-                *sock,
-                [this, sock](const boost::system::error_code &ec)
+                boost::asio::make_strand(*m_ioContext),
+                [this](const boost::system::error_code &ec, boost::asio::ip::tcp::socket sock)
                 {
                     if (ec or not m_isActive)
                     {
                         LOG_ERROR(DOMAIN, "Error[%d] while accepting data socket: [%s]",
                             ec.value(),
                             ec.message().c_str());
+                        return;
                     }
-                    else
-                    {
-                        startListeningTcp();
 
-                        sock->set_option(boost::asio::ip::tcp::no_delay(true));
-                        m_runners.push_back(std::move(std::thread([this, sock]{ receiveData(sock);})));
-                    }
+                    startListeningTcp();
+
+                    boost::system::error_code error;
+                    std::string remoteIp = sock.remote_endpoint(error).address().to_string();
+                    sock.set_option(boost::asio::ip::tcp::no_delay(true), error);
+
+                    addSession(boost::asio::generic::stream_protocol::socket(std::move(sock)), remoteIp);
                 }
             );
         }
@@ -282,87 +745,559 @@ namespace networking
         LOG_DEBUG(DOMAIN, "Exited %s", __PRETTY_FUNCTION__);
     }
 
-    void Server::receiveData(std::shared_ptr<boost::asio::ip::tcp::socket> sock)
+    void Server::startListeningLocal()
     {
         LOG_DEBUG(DOMAIN, "Entered %s", __PRETTY_FUNCTION__);
 
-        std::string clientIp = sock.get()->remote_endpoint().address().to_string().c_str();
+        if (m_isActive)
+        {
+            m_localAcceptor->async_accept(
+                boost::asio::make_strand(*m_ioContext),
+                [this](const boost::system::error_code &ec, boost::asio::local::stream_protocol::socket sock)
+                {
+                    if (ec or not m_isActive)
+                    {
+                        LOG_ERROR(DOMAIN, "Error[%d] while accepting local socket: [%s]",
+                            ec.value(),
+                            ec.message().c_str());
+                        return;
+                    }
+
+                    startListeningLocal();
+                    addSession(boost::asio::generic::stream_protocol::socket(std::move(sock)), "local");
+                }
+            );
+        }
+
+        LOG_DEBUG(DOMAIN, "Exited %s", __PRETTY_FUNCTION__);
+    }
+
+    void Server::addSession(boost::asio::generic::stream_protocol::socket socket, const std::string &remoteIp)
+    {
+        std::shared_ptr<Session> session = std::make_shared<AsioSession>(
+            std::move(socket),
+            remoteIp,
+            m_serverMaxRxMsgSizeKb * 1024,
+            m_sessionLimits,
+            std::bind(&Server::handleMessage, this,
+                std::placeholders::_1, std::placeholders::_2, std::placeholders::_3, std::placeholders::_4),
+            std::bind(&Server::handleClose, this, std::placeholders::_1));
+
+        registerSession(session);
+    }
+
+#ifdef BREADCRUMBS_IO_URING
+    void Server::addUringSession(int fd, const std::string &remoteIp)
+    {
+        std::shared_ptr<Session> session = std::make_shared<UringSession>(
+            *m_uring,
+            fd,
+            remoteIp,
+            m_serverMaxRxMsgSizeKb * 1024,
+            m_sessionLimits,
+            std::bind(&Server::handleMessage, this,
+                std::placeholders::_1, std::placeholders::_2, std::placeholders::_3, std::placeholders::_4),
+            std::bind(&Server::handleClose, this, std::placeholders::_1));
+
+        registerSession(session);
+    }
+#endif
 
-        // Keep a reference to this socket
+    void Server::registerSession(const std::shared_ptr<Session> &session)
+    {
         {
             std::scoped_lock<std::mutex> lock(*m_clientsMutex);
-            LOG_INFO(DOMAIN, "Client[%s]: connected - %p", clientIp.c_str(), sock.get());
-            m_connectedClients.insert(sock);
+            LOG_INFO(DOMAIN, "Client[%s]: connected - %p", session->getRemoteIp().c_str(), session.get());
+            m_sessions.insert(session);
+            m_unfilteredSessions.insert(session);
+
+            // Text archives carry no length, the snapshots wait until the
+            // client said which wire format it reads
+            if (not m_snapshotTopics.empty())
+            {
+                m_snapshotSessions.insert(session);
+            }
         }
 
-        std::string data;
-        data.resize(m_serverMaxRxMsgSizeKb * 1024);
+        session->start();
+    }
 
-        auto buffer = boost::asio::buffer(data);
+    void Server::handleMessage(
+        const std::shared_ptr<Session> &session,
+        std::string_view id,
+        std::string_view payload,
+        const util::network::MessageExtensions &extensions)
+    {
+        if (id == util::network::BinaryMessage::HELLO_ID)
+        {
+            handleHello(session);
+            return;
+        }
 
-        while (sock->is_open() && m_isActive)
+        // Text peers send no hello, their first message tells the wire format.
+        // A subscription is applied first, so only its snapshots are sent
+        if (session->isTextPeer() and (id != util::network::ControlMessage::SUBSCRIBE_ID))
         {
-            boost::system::error_code error;
-            size_t readSize = sock->read_some(buffer, error);
+            std::scoped_lock<std::mutex> lock(*m_clientsMutex);
+            sendPendingSnapshots(session);
+        }
+
+        if (id == util::network::ControlMessage::SUBSCRIBE_ID)
+        {
+            handleSubscribe(session, payload);
+            return;
+        }
+
+        if (id == util::network::ControlMessage::MULTICAST_ID)
+        {
+            handleMulticast(session);
+            return;
+        }
+
+        if (id == util::network::ControlMessage::NACK_ID)
+        {
+            handleNack(session, payload);
+            return;
+        }
+
+        if (id == util::network::ControlMessage::PING_ID)
+        {
+            handlePing(session, payload);
+            return;
+        }
+
+        core::MessageData attrs;
+        attrs.set("data", core::util::SharedBuffer(payload.data(), payload.size()));
+
+        if (m_tracer and extensions.trace)
+        {
+            m_tracer->receive(id, *extensions.trace);
+            attrs.set("trace", *extensions.trace);
+        }
+
+        // Clients stamp the presentation time on the clock of this server
+        if (extensions.presentAt)
+        {
+            attrs.set("present_at", std::chrono::steady_clock::time_point(
+                std::chrono::nanoseconds(*extensions.presentAt)));
+        }
+
+        LOG_DEBUG(DOMAIN, "Client[%s]: Received message with id [%.*s]",
+            session->getRemoteIp().c_str(),
+            static_cast<int>(id.size()),
+            id.data());
+        post(std::string(id), attrs);
+    }
+
+    void Server::handleClose(const std::shared_ptr<Session> &session)
+    {
+        SessionStatistics statistics = session->getStatistics();
+
+        LOG_INFO(DOMAIN, "Client[%s]: Disconecting, sent %llu messages in %llu writes, dropped %llu, conflated %llu%s",
+            session->getRemoteIp().c_str(),
+            static_cast<unsigned long long>(statistics.sentMessages),
+            static_cast<unsigned long long>(statistics.writeCount),
+            static_cast<unsigned long long>(statistics.dropped),
+            static_cast<unsigned long long>(statistics.conflated),
+            statistics.evicted ? ", evicted" : "");
+
+        std::scoped_lock<std::mutex> lock(*m_clientsMutex);
+        m_sessions.erase(session);
+        m_unfilteredSessions.erase(session);
+        m_snapshotSessions.erase(session);
+        m_multicastSessions.erase(session);
+        m_heartbeats.erase(session);
+        m_reportedLosses.erase(session);
 
-            if (readSize != 0)
+        auto subscription = m_subscriptions.find(session);
+        if (subscription != m_subscriptions.end())
+        {
+            for (core::TopicId topic : subscription->second)
             {
-                LOG_DEBUG(DOMAIN, "Client[%s]: Received %d bytes", clientIp.c_str(), readSize);
+                m_topicSessions[topic].erase(session);
             }
-            else if (error == boost::asio::error::eof)
+
+            m_subscriptions.erase(subscription);
+        }
+
+        if (statistics.evicted)
+        {
+            ++m_evictions;
+        }
+    }
+
+    void Server::handleHello(const std::shared_ptr<Session> &session)
+    {
+        if (m_wireFormat != util::network::WireFormat::BINARY)
+        {
+            LOG_DEBUG(DOMAIN, "Client[%s]: Binary frames disabled, staying on text", session->getRemoteIp().c_str());
+
+            std::scoped_lock<std::mutex> lock(*m_clientsMutex);
+            sendPendingSnapshots(session);
+            return;
+        }
+
+        if (session->getWireFormat() == util::network::WireFormat::BINARY)
+        {
+            return;
+        }
+
+        LOG_INFO(DOMAIN, "Client[%s]: Switching to binary frames", session->getRemoteIp().c_str());
+
+        // Runs on the session strand, so the hello precedes any binary broadcast
+        session->send(Session::CONTROL_TOPIC, util::network::MessageCodec::encode(
+            util::network::WireFormat::BINARY, util::network::BinaryMessage::HELLO_ID, ""));
+        session->setWireFormat(util::network::WireFormat::BINARY);
+
+        if (m_multicastDataSocket)
+        {
+            session->send(Session::CONTROL_TOPIC, util::network::MessageCodec::encode(
+                util::network::WireFormat::BINARY,
+                util::network::ControlMessage::MULTICAST_ID,
+                util::network::ControlMessage::encodeList({m_multicastDataAddress, std::to_string(m_multicastDataPort)})));
+        }
+
+        // Queued after the hello, so the client decodes them as binary frames
+        std::scoped_lock<std::mutex> lock(*m_clientsMutex);
+        sendPendingSnapshots(session);
+    }
+
+    void Server::handleSubscribe(const std::shared_ptr<Session> &session, std::string_view payload)
+    {
+        std::set<core::TopicId> topics;
+
+        for (const std::string &name : util::network::ControlMessage::decodeList(payload))
+        {
+            auto forwarded = m_forwardedTopics.find(name);
+
+            if (forwarded == m_forwardedTopics.end())
             {
+                LOG_DEBUG(DOMAIN, "Client[%s]: Topic [%s] is not broadcast, ignoring",
+                    session->getRemoteIp().c_str(),
+                    name.c_str());
                 continue;
             }
-            else
+
+            topics.insert(forwarded->second);
+        }
+
+        LOG_INFO(DOMAIN, "Client[%s]: Subscribed to %zu topics", session->getRemoteIp().c_str(), topics.size());
+
+        std::scoped_lock<std::mutex> lock(*m_clientsMutex);
+
+        // Closed meanwhile, handleClose already forgot it
+        if (m_sessions.find(session) == m_sessions.end())
+        {
+            return;
+        }
+
+        // Clients that received every topic so far already got the snapshots
+        bool wasUnfiltered = m_unfilteredSessions.erase(session) != 0;
+
+        std::set<core::TopicId> &subscribed = m_subscriptions[session];
+        std::set<core::TopicId> added;
+        for (core::TopicId topic : topics)
+        {
+            if (not wasUnfiltered and (subscribed.count(topic) == 0) and (m_snapshotTopics.count(topic) != 0))
             {
-                LOG_ERROR(DOMAIN, "Client[%s]: Error on read: [%d]", clientIp.c_str(), error);
-                break;
+                added.insert(topic);
             }
+        }
 
-            util::network::Message message;
-            try
+        for (core::TopicId topic : subscribed)
+        {
+            m_topicSessions[topic].erase(session);
+        }
+
+        for (core::TopicId topic : topics)
+        {
+            m_topicSessions[topic].insert(session);
+        }
+
+        subscribed = std::move(topics);
+
+        // Still waiting for the wire format, the snapshots follow the subscription
+        if (m_snapshotSessions.count(session) != 0)
+        {
+            if (session->isTextPeer())
+            {
+                sendPendingSnapshots(session);
+            }
+
+            return;
+        }
+
+        sendSnapshots(session, added);
+    }
+
+    void Server::handleMulticast(const std::shared_ptr<Session> &session)
+    {
+        if (not m_multicastDataSocket)
+        {
+            return;
+        }
+
+        LOG_INFO(DOMAIN, "Client[%s]: Joined the multicast data channel", session->getRemoteIp().c_str());
+
+        std::scoped_lock<std::mutex> lock(*m_clientsMutex);
+
+        if (m_sessions.find(session) != m_sessions.end())
+        {
+            m_multicastSessions.insert(session);
+        }
+    }
+
+    void Server::handleNack(const std::shared_ptr<Session> &session, std::string_view payload)
+    {
+        std::vector<std::string> gap = util::network::ControlMessage::decodeList(payload);
+
+        {
+            std::scoped_lock<std::mutex> lock(m_multicastMutex);
+            ++m_multicastNacks;
+        }
+
+        LOG_WARNING(DOMAIN, "Client[%s]: Lost multicast frames %s to %s, resynchronizing",
+            session->getRemoteIp().c_str(),
+            (gap.size() > 0) ? gap[0].c_str() : "?",
+            (gap.size() > 1) ? gap[1].c_str() : "?");
+
+        std::set<core::TopicId> topics = m_multicastTopics;
+
+        {
+            std::scoped_lock<std::mutex> lock(*m_clientsMutex);
+            auto subscription = m_subscriptions.find(session);
+
+            if (subscription != m_subscriptions.end())
             {
-                message.fromString(std::string(&data[0], readSize));
+                std::set<core::TopicId> subscribed;
+                std::set_intersection(topics.begin(), topics.end(),
+                    subscription->second.begin(), subscription->second.end(),
+                    std::inserter(subscribed, subscribed.end()));
+                topics = std::move(subscribed);
             }
-            catch (std::exception e)
+        }
+
+        // Topics carry state, so their latest frames replace whatever was lost
+        sendSnapshots(session, topics);
+    }
+
+    void Server::handlePing(const std::shared_ptr<Session> &session, std::string_view payload)
+    {
+        uint64_t receivedAt = util::network::MessageTracer::now();
+        std::vector<std::string> values = util::network::ControlMessage::decodeList(payload);
+
+        // Answered first, the measured round trip should not include the bookkeeping
+        std::vector<std::string> answer = values;
+        answer.resize(2, "0");
+        answer.push_back(std::to_string(receivedAt));
+        answer.push_back(std::to_string(util::network::MessageTracer::now()));
+        session->send(Session::CONTROL_TOPIC, util::network::MessageCodec::encode(
+            session->getWireFormat(),
+            util::network::ControlMessage::PONG_ID,
+            util::network::ControlMessage::encodeList(answer)));
+
+        std::chrono::microseconds rtt(0);
+
+        if (values.size() > 1)
+        {
+            rtt = std::chrono::microseconds(std::strtoll(values[1].c_str(), nullptr, 10));
+        }
+
+        std::scoped_lock<std::mutex> lock(*m_clientsMutex);
+
+        // Closed meanwhile, handleClose already forgot it
+        if (m_sessions.find(session) != m_sessions.end())
+        {
+            m_heartbeats[session] = ClientHeartbeat{rtt};
+        }
+    }
+
+    void Server::checkHeartbeats()
+    {
+        auto now = std::chrono::steady_clock::now();
+        std::vector<std::pair<std::shared_ptr<Session>, ClientHeartbeat>> clients;
+
+        {
+            std::scoped_lock<std::mutex> lock(*m_clientsMutex);
+            clients.assign(m_heartbeats.begin(), m_heartbeats.end());
+        }
+
+        for (auto &client : clients)
+        {
+            const std::shared_ptr<Session> &session = client.first;
+
+            // Any message proves the client alive, a busy one may delay its heartbeats
+            uint32_t silenceMs = std::chrono::duration_cast<std::chrono::milliseconds>(
+                now - session->getLastReceived()).count();
+            bool isAlive = silenceMs <= m_heartbeatTimeoutMs;
+
+            core::MessageData heartbeat;
+            heartbeat.set<bool>("alive", isAlive);
+            heartbeat.set<std::string>("address", session->getRemoteIp());
+            heartbeat.set<uint32_t>("rtt_us", static_cast<uint32_t>(client.second.rtt.count()));
+            heartbeat.set<uint32_t>("silence_ms", silenceMs);
+            post("CLIENT_HEARTBEAT", heartbeat);
+
+            // Half open connections never fail a write, only the silence tells
+            if (not isAlive)
             {
-                LOG_ERROR(DOMAIN, "Client[%s]: Unable to deserialize message received. Skiping[%s]",
-                    clientIp.c_str(),
-                    e.what());
-                continue;
+                LOG_WARNING(DOMAIN, "Client[%s]: No heartbeat for %u ms, disconnecting",
+                    session->getRemoteIp().c_str(),
+                    silenceMs);
+                session->close();
+
+                std::scoped_lock<std::mutex> lock(*m_clientsMutex);
+                m_heartbeats.erase(session);
             }
+        }
+    }
+
+    void Server::reportClients()
+    {
+        std::vector<std::shared_ptr<Session>> sessions;
+        uint64_t evictions;
 
-            if (not message.isValid())
+        {
+            std::scoped_lock<std::mutex> lock(*m_clientsMutex);
+            sessions.assign(m_sessions.begin(), m_sessions.end());
+            evictions = m_evictions;
+
+            if (evictions != m_reportedEvictions)
+            {
+                LOG_WARNING(DOMAIN, "Clients disconnected for being too slow: %llu",
+                    static_cast<unsigned long long>(evictions));
+                m_reportedEvictions = evictions;
+            }
+        }
+
+        for (auto &session : sessions)
+        {
+            SessionStatistics statistics = session->getStatistics();
+
+            core::MessageData report;
+            report.set<std::string>("address", session->getRemoteIp());
+            report.set<uint64_t>("queued_messages", statistics.queuedMessages);
+            report.set<uint64_t>("queued_bytes", statistics.queuedBytes);
+            report.set<uint64_t>("sent_messages", statistics.sentMessages);
+            report.set<uint64_t>("write_count", statistics.writeCount);
+            report.set<uint64_t>("dropped", statistics.dropped);
+            report.set<uint64_t>("conflated", statistics.conflated);
+            report.set<uint64_t>("evictions", evictions);
+            post("CLIENT_STATISTICS", report);
+
+            uint64_t losses = statistics.dropped + statistics.conflated;
+
+            std::scoped_lock<std::mutex> lock(*m_clientsMutex);
+
+            // Closed meanwhile, handleClose already forgot it
+            if (m_sessions.find(session) == m_sessions.end())
             {
-                LOG_ERROR(DOMAIN, "Client[%s]: Invalid message received. Skiping.",
-                    clientIp.c_str());
                 continue;
             }
 
+            uint64_t &reported = m_reportedLosses[session];
+            if (losses != reported)
             {
-                core::MessageData attrs;
-                attrs.set<std::string>("data", message.getData());
-                LOG_DEBUG(DOMAIN, "Client[%s]: Received message with id [%s]",
-                    clientIp.c_str(),
-                    message.getId().c_str());
-                post(message.getId(), attrs);
+                LOG_WARNING(DOMAIN, "Client[%s]: %llu messages queued (%llu bytes), dropped %llu, conflated %llu",
+                    session->getRemoteIp().c_str(),
+                    static_cast<unsigned long long>(statistics.queuedMessages),
+                    static_cast<unsigned long long>(statistics.queuedBytes),
+                    static_cast<unsigned long long>(statistics.dropped),
+                    static_cast<unsigned long long>(statistics.conflated));
+                reported = losses;
             }
         }
+    }
+
+    void Server::keepSnapshot(
+        core::TopicId topic,
+        const core::MessageId &id,
+        const core::util::SharedBuffer &data,
+        std::shared_ptr<std::string> textFrame,
+        std::shared_ptr<std::string> binaryFrame)
+    {
+        std::scoped_lock<std::mutex> lock(m_snapshotsMutex);
+
+        Snapshot &snapshot = m_snapshots[topic];
+        snapshot.id = id;
+        snapshot.data = data;
+        snapshot.frames[static_cast<size_t>(util::network::WireFormat::TEXT)] = std::move(textFrame);
+        snapshot.frames[static_cast<size_t>(util::network::WireFormat::BINARY)] = std::move(binaryFrame);
+    }
 
-        // Remove the reference to this connection
+    void Server::sendSnapshots(const std::shared_ptr<Session> &session, const std::set<core::TopicId> &topics)
+    {
+        if (topics.empty())
         {
-            LOG_INFO(DOMAIN, "Client[%s]: Disconecting", clientIp.c_str());
-            std::scoped_lock<std::mutex> lock(*m_clientsMutex);
-            m_connectedClients.erase(sock);
+            return;
+        }
+
+        util::network::WireFormat format = session->getWireFormat();
+        std::vector<std::pair<core::TopicId, std::shared_ptr<std::string>>> frames;
+
+        {
+            std::scoped_lock<std::mutex> lock(m_snapshotsMutex);
 
-            if (sock->is_open())
+            for (core::TopicId topic : topics)
             {
-                boost::system::error_code error;
-                sock->shutdown(boost::asio::ip::tcp::socket::shutdown_both, error);
-                sock->close();
+                auto snapshot = m_snapshots.find(topic);
+                if (snapshot == m_snapshots.end())
+                {
+                    continue;
+                }
+
+                // Encoded once, every client joining later shares the frame
+                std::shared_ptr<std::string> &frame = snapshot->second.frames[static_cast<size_t>(format)];
+                if (not frame)
+                {
+                    frame = util::network::MessageCodec::encode(format, snapshot->second.id, snapshot->second.data.str());
+                }
+
+                frames.emplace_back(topic, frame);
             }
         }
 
-        LOG_DEBUG(DOMAIN, "Exited %s", __PRETTY_FUNCTION__);
+        LOG_DEBUG(DOMAIN, "Client[%s]: Sending %zu snapshots", session->getRemoteIp().c_str(), frames.size());
+
+        for (auto &frame : frames)
+        {
+            session->send(frame.first, frame.second);
+        }
+    }
+
+    void Server::sendPendingSnapshots(const std::shared_ptr<Session> &session)
+    {
+        if (m_snapshotSessions.erase(session) == 0)
+        {
+            return;
+        }
+
+        // Sent under m_clientsMutex, the state kept is never older than a broadcast the client already got
+        auto subscription = m_subscriptions.find(session);
+        if (subscription == m_subscriptions.end())
+        {
+            sendSnapshots(session, m_snapshotTopics);
+            return;
+        }
+
+        std::set<core::TopicId> topics;
+        std::set_intersection(m_snapshotTopics.begin(), m_snapshotTopics.end(),
+            subscription->second.begin(), subscription->second.end(),
+            std::inserter(topics, topics.end()));
+        sendSnapshots(session, topics);
+    }
+
+    void Server::reportTraces()
+    {
+        if (not m_tracer)
+        {
+            return;
+        }
+
+        std::string statistics = m_tracer->toString();
+        if (not statistics.empty())
+        {
+            LOG_INFO(DOMAIN, "Traced messages received by node %u:\n%s", m_tracer->getNodeId(), statistics.c_str());
+        }
     }
 }
\ No newline at end of file
@@ -0,0 +1,302 @@
+/**
+ * @file Session.cpp
+ *
+ * @author Nicolae Natea
+ * Contact: nicu@natea.ro
+ */
+
+#include <Session.hpp>
+
+#include <core/logger/event_logger.h>
+#include <util/network/MessageCodec.hpp>
+
+namespace networking
+{
+    namespace
+    {
+        const char *DOMAIN = "Server";
+    }
+
+    Session::Session(
+        const std::string &remoteIp,
+        size_t maxFrameSize,
+        const SessionLimits &limits,
+        MessageCallback onMessage,
+        CloseCallback onClose) :
+        m_reader(maxFrameSize),
+        m_isClosed(false),
+        m_isEvicted(false),
+        m_isTextPeer(false),
+        m_remoteIp(remoteIp),
+        m_maxFrameSize(maxFrameSize),
+        m_wireFormat(util::network::WireFormat::TEXT),
+        m_onMessage(onMessage),
+        m_onClose(onClose),
+        m_lastReceived(std::chrono::steady_clock::now().time_since_epoch().count()),
+        m_limits(limits),
+        m_writeQueueBytes(0),
+        m_inFlightBytes(0),
+        m_statistics()
+    {
+    }
+
+    void Session::doSend(core::TopicId topic, std::shared_ptr<std::string> buf)
+    {
+        if (m_isClosed or m_isEvicted)
+        {
+            return;
+        }
+
+        enqueue(topic, buf);
+
+        // Otherwise picked up when the write in flight completes
+        if (m_inFlight.empty() and not m_isClosed and not m_isEvicted)
+        {
+            write();
+        }
+    }
+
+    const std::string &Session::getRemoteIp() const
+    {
+        return m_remoteIp;
+    }
+
+    util::network::WireFormat Session::getWireFormat() const
+    {
+        return m_wireFormat;
+    }
+
+    void Session::setWireFormat(util::network::WireFormat format)
+    {
+        m_wireFormat = format;
+    }
+
+    bool Session::isTextPeer() const
+    {
+        return m_isTextPeer;
+    }
+
+    SessionStatistics Session::getStatistics() const
+    {
+        std::scoped_lock lock(m_statisticsMutex);
+        return m_statistics;
+    }
+
+    std::chrono::steady_clock::time_point Session::getLastReceived() const
+    {
+        return std::chrono::steady_clock::time_point(std::chrono::steady_clock::duration(m_lastReceived.load()));
+    }
+
+    void Session::enqueue(core::TopicId topic, std::shared_ptr<std::string> buf)
+    {
+        // Only what waits for the next write may be dropped, the write in flight is committed
+        bool overflow =
+            (m_writeQueue.size() + 1 > m_limits.maxQueuedMessages) or
+            (m_writeQueueBytes + buf->size() > m_limits.maxQueuedBytes);
+
+        uint64_t dropped = 0;
+        uint64_t conflated = 0;
+
+        if (overflow and (m_limits.policy == SlowConsumerPolicy::DISCONNECT))
+        {
+            LOG_WARNING(DOMAIN, "Client[%s]: Too slow, %zu messages (%zu bytes) queued. Disconnecting",
+                m_remoteIp.c_str(),
+                m_writeQueue.size(),
+                m_writeQueueBytes);
+
+            {
+                std::scoped_lock lock(m_statisticsMutex);
+                m_statistics.evicted = true;
+            }
+
+            // The broadcast sending this holds the clients lock, which the close handler takes
+            m_isEvicted = true;
+            m_writeQueue.clear();
+            m_writeQueueBytes = 0;
+            closeLater();
+            return;
+        }
+
+        if (overflow and (m_limits.policy == SlowConsumerPolicy::CONFLATE) and (topic != CONTROL_TOPIC))
+        {
+            for (Outgoing &outgoing : m_writeQueue)
+            {
+                if (outgoing.topic == topic)
+                {
+                    // Keeps its place in the queue but carries the newest frame
+                    m_writeQueueBytes += buf->size();
+                    m_writeQueueBytes -= outgoing.buf->size();
+                    outgoing.buf = buf;
+                    ++conflated;
+                    break;
+                }
+            }
+        }
+
+        if (conflated == 0)
+        {
+            m_writeQueue.push_back(Outgoing{topic, buf});
+            m_writeQueueBytes += buf->size();
+        }
+
+        // Oldest first; control messages are kept whatever the policy
+        for (auto it = m_writeQueue.begin();
+             (it != m_writeQueue.end()) and
+             ((m_writeQueue.size() > m_limits.maxQueuedMessages) or (m_writeQueueBytes > m_limits.maxQueuedBytes));)
+        {
+            if (it->topic == CONTROL_TOPIC)
+            {
+                ++it;
+                continue;
+            }
+
+            m_writeQueueBytes -= it->buf->size();
+            it = m_writeQueue.erase(it);
+            ++dropped;
+        }
+
+        std::scoped_lock lock(m_statisticsMutex);
+
+        if ((dropped != 0) and (m_statistics.dropped == 0))
+        {
+            LOG_WARNING(DOMAIN, "Client[%s]: Too slow, dropping messages", m_remoteIp.c_str());
+        }
+
+        m_statistics.dropped += dropped;
+        m_statistics.conflated += conflated;
+        m_statistics.queuedMessages = m_writeQueue.size() + m_inFlight.size();
+        m_statistics.queuedBytes = m_writeQueueBytes + m_inFlightBytes;
+    }
+
+    void Session::write()
+    {
+        m_writeBuffers.clear();
+
+        while (not m_writeQueue.empty())
+        {
+            m_writeBuffers.push_back(boost::asio::buffer(*m_writeQueue.front().buf));
+            m_inFlight.push_back(std::move(m_writeQueue.front().buf));
+            m_writeQueue.pop_front();
+        }
+
+        m_inFlightBytes = m_writeQueueBytes;
+        m_writeQueueBytes = 0;
+
+        startWrite();
+    }
+
+    void Session::handleWrite(const boost::system::error_code &ec, size_t bytesSent)
+    {
+        if (ec)
+        {
+            if (ec != boost::asio::error::operation_aborted)
+            {
+                LOG_ERROR(DOMAIN, "Client[%s]: Error[%d] while broadcasting message",
+                    m_remoteIp.c_str(),
+                    ec.value());
+            }
+
+            m_inFlight.clear();
+            m_inFlightBytes = 0;
+            doClose();
+            return;
+        }
+
+        {
+            std::scoped_lock lock(m_statisticsMutex);
+            m_statistics.sentMessages += m_inFlight.size();
+            ++m_statistics.writeCount;
+            m_statistics.queuedMessages = m_writeQueue.size();
+            m_statistics.queuedBytes = m_writeQueueBytes;
+        }
+
+        m_inFlight.clear();
+        m_inFlightBytes = 0;
+
+        if (not m_writeQueue.empty() and not m_isClosed)
+        {
+            write();
+        }
+    }
+
+    void Session::handleRead(const boost::system::error_code &ec, size_t readSize)
+    {
+        if (ec)
+        {
+            if ((ec != boost::asio::error::eof) and (ec != boost::asio::error::operation_aborted))
+            {
+                LOG_ERROR(DOMAIN, "Client[%s]: Error on read: [%d]", m_remoteIp.c_str(), ec.value());
+            }
+
+            doClose();
+            return;
+        }
+
+        LOG_DEBUG(DOMAIN, "Client[%s]: Received %d bytes", m_remoteIp.c_str(), readSize);
+        m_reader.commit(readSize);
+        m_lastReceived = std::chrono::steady_clock::now().time_since_epoch().count();
+
+        try
+        {
+            std::shared_ptr<Session> self = shared_from_this();
+            std::string_view frame;
+
+            while (m_reader.next(frame))
+            {
+                util::network::MessageCodec::decode(frame.data(), frame.size(),
+                    [this, &self](
+                        std::string_view id,
+                        std::string_view payload,
+                        util::network::WireFormat format,
+                        const util::network::MessageExtensions &extensions)
+                    {
+                        if ((format == util::network::WireFormat::TEXT) and not m_isTextPeer)
+                        {
+                            LOG_WARNING(DOMAIN, "Client[%s]: Sends unframed text messages, which are deprecated;"
+                                " messages sharing a read are dropped", m_remoteIp.c_str());
+                            m_isTextPeer = true;
+                        }
+
+                        m_onMessage(self, id, payload, extensions);
+                    });
+            }
+        }
+        catch (const std::length_error &e)
+        {
+            LOG_ERROR(DOMAIN, "Client[%s]: Frame larger than %zu bytes. Disconnecting[%s]",
+                m_remoteIp.c_str(),
+                m_maxFrameSize,
+                e.what());
+            doClose();
+            return;
+        }
+        catch (const std::exception &e)
+        {
+            LOG_ERROR(DOMAIN, "Client[%s]: Unable to deserialize message received. Skiping[%s]",
+                m_remoteIp.c_str(),
+                e.what());
+            m_reader.clear();
+        }
+
+        if (not m_isClosed)
+        {
+            read();
+        }
+    }
+
+    void Session::doClose()
+    {
+        if (m_isClosed)
+        {
+            return;
+        }
+
+        m_isClosed = true;
+        m_writeQueue.clear();
+        m_writeQueueBytes = 0;
+
+        closeSocket();
+
+        m_onClose(shared_from_this());
+    }
+}
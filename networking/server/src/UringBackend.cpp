@@ -0,0 +1,327 @@
+/**
+ * @file UringBackend.cpp
+ *
+ * @author Nicolae Natea
+ * Contact: nicu@natea.ro
+ */
+
+#include <UringBackend.hpp>
+
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+#include <system_error>
+
+#include <boost/asio.hpp>
+
+#include <core/logger/event_logger.h>
+
+#include <UringSession.hpp>
+
+namespace networking
+{
+    namespace
+    {
+        const char *DOMAIN = "Server";
+    }
+
+    UringBackend::UringBackend(AcceptCallback onAccept) :
+        m_ring(URING_ENTRIES),
+        m_buffers(m_ring, URING_RECEIVE_GROUP, URING_RECEIVE_BUFFERS, URING_RECEIVE_BUFFER_SIZE),
+        m_onAccept(onAccept),
+        m_isRunning(false),
+        m_wakeFd(::eventfd(0, EFD_CLOEXEC)),
+        m_wakeValue(0),
+        m_isSleeping(false),
+        m_nextId(1)
+    {
+        if (m_wakeFd < 0)
+        {
+            throw std::system_error(errno, std::system_category(), "eventfd");
+        }
+    }
+
+    UringBackend::~UringBackend()
+    {
+        stop();
+        ::close(m_wakeFd);
+    }
+
+    void UringBackend::listen(int fd, bool isLocal)
+    {
+        m_listeners.emplace_back(fd, isLocal);
+    }
+
+    void UringBackend::start()
+    {
+        m_isRunning = true;
+        m_thread = std::thread(&UringBackend::run, this);
+    }
+
+    void UringBackend::stop()
+    {
+        if (m_isRunning.exchange(false))
+        {
+            uint64_t one = 1;
+            ssize_t written = ::write(m_wakeFd, &one, sizeof(one));
+            (void) written;
+        }
+
+        if (m_thread.joinable())
+        {
+            m_thread.join();
+        }
+    }
+
+    void UringBackend::post(Command command)
+    {
+        {
+            std::scoped_lock lock(m_commandsMutex);
+            m_commands.push_back(std::move(command));
+        }
+
+        // The ring thread checks the queue after announcing it sleeps, one of both sees the other
+        if (m_isSleeping.exchange(false))
+        {
+            uint64_t one = 1;
+            ssize_t written = ::write(m_wakeFd, &one, sizeof(one));
+            (void) written;
+        }
+    }
+
+    void UringBackend::run()
+    {
+        LOG_INFO(DOMAIN, "Serving clients with io_uring");
+
+        m_ring.prepareRead(m_wakeFd, &m_wakeValue, sizeof(m_wakeValue), toUserData(0, WAKE));
+
+        for (size_t listener = 0; listener < m_listeners.size(); ++listener)
+        {
+            m_ring.prepareAcceptMultishot(m_listeners[listener].first, toUserData(listener, ACCEPT));
+        }
+
+        auto handler = [this](const struct io_uring_cqe &cqe) { handleCompletion(cqe); };
+
+        while (m_isRunning)
+        {
+            processCommands();
+
+            m_isSleeping = true;
+            bool isIdle;
+            {
+                std::scoped_lock lock(m_commandsMutex);
+                isIdle = m_commands.empty();
+            }
+
+            // Everything prepared since the last call goes out at once, blocking only when idle
+            int result = isIdle ? m_ring.submitAndWait() : m_ring.submit();
+            m_isSleeping = false;
+
+            if ((result < 0) and (result != -EBUSY))
+            {
+                LOG_ERROR(DOMAIN, "io_uring_enter failed: [%s]", std::strerror(-result));
+            }
+
+            m_ring.forEachCompletion(handler);
+        }
+
+        // Shutting the sockets down ends their requests, which are awaited before the memory goes
+        processCommands();
+
+        std::vector<std::shared_ptr<UringSession>> sessions;
+        for (auto &session : m_sessions)
+        {
+            sessions.push_back(session.second);
+        }
+
+        for (auto &session : sessions)
+        {
+            session->doClose();
+            settle(session);
+        }
+
+        while (not m_sessions.empty() and (m_ring.submitAndWait() >= 0))
+        {
+            m_ring.forEachCompletion(handler);
+        }
+
+        m_sessions.clear();
+    }
+
+    void UringBackend::processCommands()
+    {
+        {
+            std::scoped_lock lock(m_commandsMutex);
+            m_pending.swap(m_commands);
+        }
+
+        for (Command &command : m_pending)
+        {
+            adopt(command.session);
+
+            switch (command.type)
+            {
+                case Command::START:
+                    break;
+
+                case Command::SEND:
+                    command.session->doSend(command.topic, std::move(command.buf));
+                    break;
+
+                case Command::CLOSE:
+                    command.session->doClose();
+                    break;
+            }
+
+            settle(command.session);
+        }
+
+        m_pending.clear();
+    }
+
+    void UringBackend::handleCompletion(const struct io_uring_cqe &cqe)
+    {
+        uint64_t id = cqe.user_data >> 8;
+
+        switch (static_cast<Operation>(cqe.user_data & 0xFF))
+        {
+            case ACCEPT:
+                handleAccept(id, cqe);
+                break;
+
+            case WAKE:
+                m_ring.prepareRead(m_wakeFd, &m_wakeValue, sizeof(m_wakeValue), toUserData(0, WAKE));
+                break;
+
+            case RECEIVE:
+                handleReceive(id, cqe);
+                break;
+
+            case SEND:
+            {
+                auto it = m_sessions.find(id);
+                if (it != m_sessions.end())
+                {
+                    std::shared_ptr<UringSession> session = it->second;
+                    session->sent(cqe.res);
+                    settle(session);
+                }
+                break;
+            }
+        }
+    }
+
+    void UringBackend::handleAccept(size_t listener, const struct io_uring_cqe &cqe)
+    {
+        if (cqe.res >= 0)
+        {
+            int fd = cqe.res;
+            std::string remoteIp = "local";
+
+            if (not m_listeners[listener].second)
+            {
+                int noDelay = 1;
+                ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &noDelay, sizeof(noDelay));
+
+                boost::asio::ip::tcp::endpoint endpoint;
+                socklen_t size = endpoint.capacity();
+                if (::getpeername(fd, endpoint.data(), &size) == 0)
+                {
+                    endpoint.resize(size);
+                    remoteIp = endpoint.address().to_string();
+                }
+            }
+
+            m_onAccept(fd, remoteIp);
+        }
+        else
+        {
+            LOG_ERROR(DOMAIN, "Error[%d] while accepting data socket: [%s]", -cqe.res, std::strerror(-cqe.res));
+        }
+
+        // The kernel ends a multishot accept on errors, it is armed again
+        if (not (cqe.flags & IORING_CQE_F_MORE) and m_isRunning)
+        {
+            m_ring.prepareAcceptMultishot(m_listeners[listener].first, toUserData(listener, ACCEPT));
+        }
+    }
+
+    void UringBackend::handleReceive(uint64_t id, const struct io_uring_cqe &cqe)
+    {
+        bool hasBuffer = cqe.flags & IORING_CQE_F_BUFFER;
+        uint16_t bufferId = static_cast<uint16_t>(cqe.flags >> IORING_CQE_BUFFER_SHIFT);
+
+        std::shared_ptr<UringSession> session;
+        auto it = m_sessions.find(id);
+        if (it != m_sessions.end())
+        {
+            session = it->second;
+        }
+
+        if (session)
+        {
+            session->m_isReceiving = cqe.flags & IORING_CQE_F_MORE;
+
+            if (cqe.res > 0)
+            {
+                session->received(m_buffers.get(bufferId), static_cast<size_t>(cqe.res));
+            }
+            else if (cqe.res != -ENOBUFS)
+            {
+                session->receiveFailed(cqe.res);
+            }
+        }
+
+        // The data was copied out, stale completions only give their buffer back
+        if (hasBuffer)
+        {
+            m_buffers.recycle(bufferId);
+        }
+
+        if (session)
+        {
+            // Ended while the connection is up when all buffers were in use
+            if (not session->m_isReceiving and not session->m_isClosed)
+            {
+                receive(*session);
+            }
+
+            settle(session);
+        }
+    }
+
+    void UringBackend::adopt(const std::shared_ptr<UringSession> &session)
+    {
+        if ((session->m_id != 0) or session->m_isClosed)
+        {
+            return;
+        }
+
+        session->m_id = m_nextId++;
+        m_sessions.emplace(session->m_id, session);
+        receive(*session);
+    }
+
+    void UringBackend::receive(UringSession &session)
+    {
+        session.m_isReceiving = m_ring.prepareRecvMultishot(
+            session.m_fd, m_buffers.getGroup(), toUserData(session.m_id, RECEIVE));
+
+        if (not session.m_isReceiving)
+        {
+            session.receiveFailed(-EBUSY);
+        }
+    }
+
+    void UringBackend::settle(const std::shared_ptr<UringSession> &session)
+    {
+        if (session->m_isClosed and not session->m_isReceiving and not session->m_isSending)
+        {
+            m_sessions.erase(session->m_id);
+        }
+    }
+}
@@ -0,0 +1,162 @@
+/**
+ * @file UringSession.cpp
+ *
+ * @author Nicolae Natea
+ * Contact: nicu@natea.ro
+ */
+
+#include <UringSession.hpp>
+
+#include <algorithm>
+#include <climits>
+#include <cstring>
+
+#include <unistd.h>
+
+namespace networking
+{
+    UringSession::UringSession(
+        UringBackend &backend,
+        int fd,
+        const std::string &remoteIp,
+        size_t maxFrameSize,
+        const SessionLimits &limits,
+        MessageCallback onMessage,
+        CloseCallback onClose) :
+        Session(remoteIp, maxFrameSize, limits, onMessage, onClose),
+        m_backend(backend),
+        m_fd(fd),
+        m_id(0),
+        m_isReceiving(false),
+        m_isSending(false),
+        m_iovecOffset(0),
+        m_writeSize(0)
+    {
+        std::memset(&m_message, 0, sizeof(m_message));
+    }
+
+    UringSession::~UringSession()
+    {
+        // Only released once the kernel no longer uses the descriptor
+        ::close(m_fd);
+    }
+
+    void UringSession::start()
+    {
+        m_backend.post(UringBackend::Command{UringBackend::Command::START, getSelf()});
+    }
+
+    void UringSession::send(core::TopicId topic, std::shared_ptr<std::string> buf)
+    {
+        m_backend.post(UringBackend::Command{UringBackend::Command::SEND, getSelf(), topic, std::move(buf)});
+    }
+
+    void UringSession::close()
+    {
+        m_backend.post(UringBackend::Command{UringBackend::Command::CLOSE, getSelf()});
+    }
+
+    void UringSession::closeLater()
+    {
+        // Commands are only run once the ring thread is back in its loop
+        close();
+    }
+
+    void UringSession::read()
+    {
+        // The multishot receive keeps delivering until the connection ends
+    }
+
+    void UringSession::startWrite()
+    {
+        m_iovecs.clear();
+        m_writeSize = 0;
+
+        for (const boost::asio::const_buffer &buffer : m_writeBuffers)
+        {
+            m_iovecs.push_back(iovec{const_cast<void *>(buffer.data()), buffer.size()});
+            m_writeSize += buffer.size();
+        }
+
+        m_iovecOffset = 0;
+        submitWrite();
+    }
+
+    void UringSession::closeSocket()
+    {
+        // Ends the pending receive and sends, the descriptor is closed with the session
+        ::shutdown(m_fd, SHUT_RDWR);
+    }
+
+    void UringSession::received(const char *data, size_t size)
+    {
+        while ((size != 0) and not m_isClosed)
+        {
+            size_t chunk = std::min(size, m_reader.writable());
+            std::memcpy(m_reader.prepare(), data, chunk);
+            data += chunk;
+            size -= chunk;
+
+            handleRead(boost::system::error_code(), chunk);
+        }
+    }
+
+    void UringSession::receiveFailed(int result)
+    {
+        handleRead(
+            (result == 0) ?
+                boost::system::error_code(boost::asio::error::eof) :
+                boost::system::error_code(-result, boost::system::system_category()),
+            0);
+    }
+
+    void UringSession::sent(int result)
+    {
+        m_isSending = false;
+
+        if (result < 0)
+        {
+            handleWrite(boost::system::error_code(-result, boost::system::system_category()), 0);
+            return;
+        }
+
+        // Skips what went out; MSG_WAITALL makes a partial send rare
+        size_t remaining = static_cast<size_t>(result);
+        while ((m_iovecOffset < m_iovecs.size()) and (remaining >= m_iovecs[m_iovecOffset].iov_len))
+        {
+            remaining -= m_iovecs[m_iovecOffset].iov_len;
+            ++m_iovecOffset;
+        }
+
+        if (m_iovecOffset < m_iovecs.size())
+        {
+            iovec &partial = m_iovecs[m_iovecOffset];
+            partial.iov_base = static_cast<char *>(partial.iov_base) + remaining;
+            partial.iov_len -= remaining;
+
+            submitWrite();
+            return;
+        }
+
+        handleWrite(boost::system::error_code(), m_writeSize);
+    }
+
+    void UringSession::submitWrite()
+    {
+        m_message.msg_iov = &m_iovecs[m_iovecOffset];
+        m_message.msg_iovlen = std::min<size_t>(m_iovecs.size() - m_iovecOffset, IOV_MAX);
+
+        if (not m_backend.m_ring.prepareSendmsg(m_fd, &m_message, UringBackend::toUserData(m_id, UringBackend::SEND)))
+        {
+            handleWrite(boost::system::error_code(EBUSY, boost::system::system_category()), 0);
+            return;
+        }
+
+        m_isSending = true;
+    }
+
+    std::shared_ptr<UringSession> UringSession::getSelf()
+    {
+        return std::static_pointer_cast<UringSession>(shared_from_this());
+    }
+}
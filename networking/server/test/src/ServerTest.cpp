@@ -0,0 +1,247 @@
+/**
+ * @file ServerTest.cpp
+ *
+ * @brief Loopback tests of networking::Server. The client side reads
+ *        with the FrameReader and MessageCodec used by networking::Client;
+ *        a Client in the same process would share the bus with the server
+ *        and send every message it receives back to it.
+ *
+ * @author Nicolae Natea
+ * Contact: nicu@natea.ro
+ */
+
+#include <chrono>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include <boost/asio.hpp>
+#include <boost/property_tree/ptree.hpp>
+
+#include <core/Component.hpp>
+#include <util/network/BinaryMessage.hpp>
+#include <util/network/ControlMessage.hpp>
+#include <util/network/FrameReader.hpp>
+#include <util/network/MessageCodec.hpp>
+
+using namespace std::chrono_literals;
+
+namespace
+{
+    const uint16_t PORT = 3190;
+    const char *CUBE_TOPIC = "ServerTest.cube";
+    const char *STATE_TOPIC = "ServerTest.state";
+    const size_t PAYLOAD_SIZE = 3000;
+
+    /** Publishes messages on the bus */
+    class Publisher : public core::Component
+    {
+    public:
+        Publisher *clone() const override
+        {
+            return new Publisher(*this);
+        }
+
+        void init(const boost::property_tree::ptree::value_type &component) override
+        {
+        }
+
+        void publish(const std::string &topic, const std::string &data)
+        {
+            post(topic, core::MessageData("data", core::util::SharedBuffer(data)));
+        }
+    };
+
+    /** Message decoded by the TestClient */
+    struct Received
+    {
+        std::string id;
+        std::string payload;
+        util::network::WireFormat format;
+    };
+
+    /** Client connection decoding the frames the server sends */
+    class TestClient
+    {
+    public:
+        TestClient() :
+            m_socket(m_context),
+            m_reader(64 * 1024)
+        {
+            m_socket.connect(boost::asio::ip::tcp::endpoint(boost::asio::ip::address_v4::loopback(), PORT));
+        }
+
+        void send(util::network::WireFormat format, const std::string &id, const std::string &payload)
+        {
+            boost::asio::write(m_socket, boost::asio::buffer(*util::network::MessageCodec::encode(format, id, payload)));
+        }
+
+        /** @return true if nothing was received within the timeout */
+        bool isIdle(std::chrono::milliseconds timeout)
+        {
+            std::this_thread::sleep_for(timeout);
+            return m_socket.available() == 0;
+        }
+
+        /** @return the messages decoded until the count is reached or the timeout expires */
+        std::vector<Received> receive(size_t count, std::chrono::milliseconds timeout = 2000ms)
+        {
+            std::vector<Received> messages;
+            auto deadline = std::chrono::steady_clock::now() + timeout;
+
+            while ((messages.size() < count) and (std::chrono::steady_clock::now() < deadline))
+            {
+                if (m_socket.available() == 0)
+                {
+                    std::this_thread::sleep_for(1ms);
+                    continue;
+                }
+
+                m_reader.commit(m_socket.read_some(boost::asio::buffer(m_reader.prepare(), m_reader.writable())));
+
+                std::string_view frame;
+                while (m_reader.next(frame))
+                {
+                    util::network::MessageCodec::decode(frame.data(), frame.size(),
+                        [&messages](std::string_view id, std::string_view payload, util::network::WireFormat format)
+                        {
+                            messages.push_back({std::string(id), std::string(payload), format});
+                        });
+                }
+            }
+
+            return messages;
+        }
+
+    private:
+        boost::asio::io_context m_context;
+        boost::asio::ip::tcp::socket m_socket;
+        util::network::FrameReader m_reader;
+    };
+
+    /** @return a ptree array of the values */
+    boost::property_tree::ptree makeList(const std::vector<std::string> &values)
+    {
+        boost::property_tree::ptree list;
+
+        for (const std::string &value : values)
+        {
+            boost::property_tree::ptree entry;
+            entry.put("", value);
+            list.push_back(std::make_pair("", entry));
+        }
+
+        return list;
+    }
+
+    class ServerTest : public ::testing::Test
+    {
+    protected:
+        static void SetUpTestSuite()
+        {
+            boost::property_tree::ptree conf;
+            conf.put("multicast.group", "239.255.0.1");
+            conf.put("multicast.port", PORT + 1);
+            conf.put("server.tcp.address", "127.0.0.1");
+            conf.put("server.tcp.port", PORT);
+            conf.put("server.local.enabled", false);
+            conf.put_child("server.snapshot.topics", makeList({CUBE_TOPIC, STATE_TOPIC}));
+            conf.put_child("subscribe", makeList({CUBE_TOPIC, STATE_TOPIC}));
+            boost::property_tree::ptree::value_type serverConf("Server", conf);
+
+            m_server = core::Component::makeComponent(serverConf);
+            ASSERT_NE(nullptr, m_server);
+            m_server->init(serverConf);
+            m_server->start();
+
+            // Kept by the server before any client connects, only the newest is sent
+            Publisher publisher;
+            publisher.publish(CUBE_TOPIC, std::string(PAYLOAD_SIZE, 'a'));
+            publisher.publish(CUBE_TOPIC, std::string(PAYLOAD_SIZE, 'b'));
+            publisher.publish(STATE_TOPIC, std::string(PAYLOAD_SIZE, 'c'));
+        }
+
+        static void TearDownTestSuite()
+        {
+            if (m_server)
+            {
+                m_server->stop();
+                delete m_server;
+                m_server = nullptr;
+            }
+        }
+
+        static core::Component *m_server;
+    };
+
+    core::Component *ServerTest::m_server = nullptr;
+}
+
+TEST_F(ServerTest, SnapshotsFollowTheBinaryHello)
+{
+    TestClient client;
+
+    // Nothing is sent before the client tells its wire format
+    EXPECT_TRUE(client.isIdle(50ms));
+
+    client.send(util::network::WireFormat::BINARY, util::network::BinaryMessage::HELLO_ID, "");
+
+    std::vector<Received> messages = client.receive(3);
+    ASSERT_EQ(3u, messages.size());
+
+    EXPECT_EQ(util::network::BinaryMessage::HELLO_ID, messages[0].id);
+
+    for (size_t i = 1; i < messages.size(); ++i)
+    {
+        EXPECT_EQ(util::network::WireFormat::BINARY, messages[i].format);
+
+        if (messages[i].id == CUBE_TOPIC)
+        {
+            EXPECT_EQ(std::string(PAYLOAD_SIZE, 'b'), messages[i].payload);
+        }
+        else
+        {
+            EXPECT_EQ(STATE_TOPIC, messages[i].id);
+            EXPECT_EQ(std::string(PAYLOAD_SIZE, 'c'), messages[i].payload);
+        }
+    }
+
+    EXPECT_NE(messages[1].id, messages[2].id);
+}
+
+TEST_F(ServerTest, SnapshotsFollowTheSubscription)
+{
+    TestClient client;
+
+    client.send(util::network::WireFormat::BINARY,
+        util::network::ControlMessage::SUBSCRIBE_ID, util::network::ControlMessage::encodeList({STATE_TOPIC}));
+    client.send(util::network::WireFormat::BINARY, util::network::BinaryMessage::HELLO_ID, "");
+
+    std::vector<Received> messages = client.receive(2);
+    ASSERT_EQ(2u, messages.size());
+    EXPECT_EQ(util::network::BinaryMessage::HELLO_ID, messages[0].id);
+    EXPECT_EQ(STATE_TOPIC, messages[1].id);
+    EXPECT_EQ(std::string(PAYLOAD_SIZE, 'c'), messages[1].payload);
+    EXPECT_TRUE(client.isIdle(50ms));
+}
+
+TEST_F(ServerTest, TextPeerGetsItsSnapshotsAfterItsFirstMessage)
+{
+    TestClient client;
+
+    EXPECT_TRUE(client.isIdle(50ms));
+
+    // A single snapshot, text archives sharing a read cannot be told apart
+    client.send(util::network::WireFormat::TEXT,
+        util::network::ControlMessage::SUBSCRIBE_ID, util::network::ControlMessage::encodeList({STATE_TOPIC}));
+
+    std::vector<Received> messages = client.receive(1);
+    ASSERT_EQ(1u, messages.size());
+    EXPECT_EQ(STATE_TOPIC, messages[0].id);
+    EXPECT_EQ(util::network::WireFormat::TEXT, messages[0].format);
+    EXPECT_EQ(std::string(PAYLOAD_SIZE, 'c'), messages[0].payload);
+    EXPECT_TRUE(client.isIdle(50ms));
+}
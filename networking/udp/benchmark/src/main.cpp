@@ -0,0 +1,183 @@
+/**
+ * @file main.cpp
+ *
+ * @brief Throughput benchmark of networking::BatchUdpSocket.
+ *        Sends datagrams over loopback, first one per system call with
+ *        send_to/receive_from, then in batches with sendmmsg/recvmmsg,
+ *        and reports the datagrams per second of both paths.
+ *
+ * @author Nicolae Natea
+ * Contact: nicu@natea.ro
+ */
+
+#include <sys/socket.h>
+#include <sys/time.h>
+
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <thread>
+
+#include <boost/asio.hpp>
+#include <boost/program_options.hpp>
+
+#include <BatchUdpSocket.hpp>
+
+namespace
+{
+    const char *APP_NAME = "UdpBenchmark";
+
+    /** Outcome of one run */
+    struct Result
+    {
+        uint64_t sent;
+        uint64_t received;
+        uint64_t sendCalls;
+        uint64_t receiveCalls;
+        double sendSeconds;
+        double receiveSeconds;
+    };
+
+    /** Makes blocking receives return, so the receiver notices the end of a run */
+    void setReceiveTimeout(boost::asio::ip::udp::socket &socket, std::chrono::milliseconds timeout)
+    {
+        struct timeval tv;
+        tv.tv_sec = timeout.count() / 1000;
+        tv.tv_usec = (timeout.count() % 1000) * 1000;
+        ::setsockopt(socket.native_handle(), SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    }
+
+    Result run(bool batched, uint32_t datagrams, uint32_t size, uint32_t batchSize, uint16_t port)
+    {
+        boost::asio::io_context context;
+        boost::asio::ip::udp::endpoint endpoint(boost::asio::ip::make_address("127.0.0.1"), port);
+
+        boost::asio::ip::udp::socket receiver(context, endpoint);
+        receiver.set_option(boost::asio::socket_base::receive_buffer_size(8 * 1024 * 1024));
+        setReceiveTimeout(receiver, std::chrono::milliseconds(200));
+
+        boost::asio::ip::udp::socket sender(context, boost::asio::ip::udp::v4());
+        sender.set_option(boost::asio::socket_base::send_buffer_size(8 * 1024 * 1024));
+
+        Result result{};
+        std::atomic<bool> isSending(true);
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        std::chrono::steady_clock::time_point lastReceived = start;
+
+        std::thread receiving([&]
+        {
+            networking::BatchUdpSocket batch(receiver, batchSize, size);
+            std::string buffer(size, '\0');
+            boost::asio::ip::udp::endpoint from;
+
+            // Stops once the sender is done and nothing arrived for a while
+            while (result.received < datagrams)
+            {
+                boost::system::error_code error;
+                size_t count = batched ?
+                    batch.receive(MSG_WAITFORONE, error) :
+                    receiver.receive_from(boost::asio::buffer(&buffer[0], buffer.size()), from, 0, error);
+
+                if (error)
+                {
+                    if (not isSending)
+                    {
+                        break;
+                    }
+
+                    continue;
+                }
+
+                result.received += batched ? count : 1;
+                ++result.receiveCalls;
+                lastReceived = std::chrono::steady_clock::now();
+            }
+        });
+
+        std::string payload(size, 'x');
+        networking::BatchUdpSocket batch(sender, batchSize, size);
+
+        start = std::chrono::steady_clock::now();
+
+        for (uint32_t i = 0; i < datagrams; ++i)
+        {
+            boost::system::error_code error;
+
+            if (batched)
+            {
+                batch.add(endpoint, std::string_view(), payload);
+
+                if ((batch.getPendingCount() == batchSize) or (i + 1 == datagrams))
+                {
+                    result.sent += batch.flush(error);
+                    ++result.sendCalls;
+                }
+            }
+            else
+            {
+                sender.send_to(boost::asio::buffer(payload), endpoint, 0, error);
+                result.sent += error ? 0 : 1;
+                ++result.sendCalls;
+            }
+        }
+
+        result.sendSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        isSending = false;
+        receiving.join();
+        result.receiveSeconds = std::chrono::duration<double>(lastReceived - start).count();
+
+        return result;
+    }
+
+    void print(const std::string &name, const Result &result)
+    {
+        std::cout << name << std::endl;
+        std::cout << "  sent                  " << result.sent << " in " << result.sendCalls << " calls ("
+                  << result.sent / result.sendSeconds << " datagrams/s)" << std::endl;
+        std::cout << "  received              " << result.received << " in " << result.receiveCalls << " calls ("
+                  << result.received / result.receiveSeconds << " datagrams/s)" << std::endl;
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    uint32_t datagrams;
+    uint32_t size;
+    uint32_t batchSize;
+    uint16_t port;
+
+    try
+    {
+        boost::program_options::options_description options{APP_NAME};
+        options.add_options()
+            ("help,h", "Help")
+            ("datagrams,n", boost::program_options::value<uint32_t>(&datagrams)->default_value(200000), "Datagrams sent per run")
+            ("size,s", boost::program_options::value<uint32_t>(&size)->default_value(256), "Datagram size in bytes")
+            ("batch,b", boost::program_options::value<uint32_t>(&batchSize)->default_value(32), "Datagrams per system call")
+            ("port,p", boost::program_options::value<uint16_t>(&port)->default_value(3200), "Receiver port");
+
+        boost::program_options::variables_map vm;
+        boost::program_options::store(boost::program_options::parse_command_line(argc, argv, options), vm);
+        boost::program_options::notify(vm);
+
+        if (vm.count("help"))
+        {
+            options.print(std::cout);
+            return 0;
+        }
+    }
+    catch (const boost::program_options::error &e)
+    {
+        std::cerr << e.what() << std::endl;
+        return -1;
+    }
+
+    std::cout << "datagram size           " << size << " bytes" << std::endl;
+    std::cout << "batch size              " << batchSize << std::endl;
+
+    print("per datagram (send_to/receive_from)", run(false, datagrams, size, batchSize, port));
+    print("batched (sendmmsg/recvmmsg)", run(true, datagrams, size, batchSize, port));
+
+    return 0;
+}
@@ -0,0 +1,138 @@
+/**
+ * @file BatchUdpSocket.hpp
+ *
+ * @brief Batched datagram I/O over an existing UDP socket.
+ *        Up to a batch of datagrams is received with a single recvmmsg
+ *        and sent with a single sendmmsg, using message vectors and
+ *        receive buffers allocated once, so high datagram rates cost
+ *        few system calls and no allocations.
+ *
+ * @author Nicolae Natea
+ * Contact: nicu@natea.ro
+ */
+
+#ifndef _CORE_NETWORKING_BATCH_UDP_SOCKET_
+#define _CORE_NETWORKING_BATCH_UDP_SOCKET_
+
+#include <sys/socket.h>
+#include <sys/uio.h>
+
+#include <cstddef>
+#include <string_view>
+#include <vector>
+
+#include <boost/asio.hpp>
+
+namespace networking
+{
+    class BatchUdpSocket
+    {
+    public:
+        /** Largest header add() copies, the data it references */
+        static const size_t MAX_HEADER_SIZE = 64;
+
+        /**
+         * @param[in] socket open socket, which must outlive the batch socket
+         * @param[in] batchSize datagrams handled by a single system call
+         * @param[in] maxDatagramSize largest datagram received without truncation
+         */
+        BatchUdpSocket(boost::asio::ip::udp::socket &socket, size_t batchSize = 32, size_t maxDatagramSize = 2048);
+
+        BatchUdpSocket(const BatchUdpSocket &) = delete;
+        BatchUdpSocket &operator=(const BatchUdpSocket &) = delete;
+
+        /**
+         * Receives the datagrams already queued on the socket, up to a batch.
+         * They are valid until the next receive.
+         *
+         * @param[in] flags recvmmsg flags, MSG_WAITFORONE blocks until one arrives
+         *            and MSG_DONTWAIT returns would_block if none is queued
+         * @param[out] error result of the call
+         * @return number of datagrams received
+         */
+        size_t receive(int flags, boost::system::error_code &error);
+
+        /**
+         * Waits for datagrams without blocking the calling thread, then
+         * receives them as receive() does.
+         *
+         * @param[in] handler called as handler(error, count) on the socket executor
+         */
+        template<typename Handler>
+        void asyncReceive(Handler handler)
+        {
+            m_socket.async_wait(
+                boost::asio::ip::udp::socket::wait_read,
+                [this, handler](const boost::system::error_code &ec)
+                {
+                    if (ec)
+                    {
+                        handler(ec, 0);
+                        return;
+                    }
+
+                    boost::system::error_code error;
+                    size_t count = receive(MSG_DONTWAIT, error);
+
+                    // Someone else drained the socket in between
+                    if (error == boost::asio::error::would_block)
+                    {
+                        asyncReceive(handler);
+                        return;
+                    }
+
+                    handler(error, count);
+                });
+        }
+
+        /** @return bytes of a received datagram */
+        std::string_view getDatagram(size_t index) const;
+
+        /** @return sender of a received datagram */
+        const boost::asio::ip::udp::endpoint &getSender(size_t index) const;
+
+        /** @return true if a received datagram was larger than maxDatagramSize */
+        bool isTruncated(size_t index) const;
+
+        /**
+         * Queues a datagram made of a header, which is copied, followed by
+         * data, which must stay valid until flush().
+         *
+         * @param[in] destination where to send the datagram
+         * @param[in] header leading bytes, at most MAX_HEADER_SIZE
+         * @param[in] data remaining bytes
+         * @return false if the batch is full or the header too large
+         */
+        bool add(const boost::asio::ip::udp::endpoint &destination, std::string_view header, std::string_view data = {});
+
+        /** @return number of datagrams waiting for flush() */
+        size_t getPendingCount() const;
+
+        /**
+         * Sends every queued datagram and empties the batch, even on error.
+         *
+         * @param[out] error result of the first failed call
+         * @return number of datagrams sent
+         */
+        size_t flush(boost::system::error_code &error);
+
+    private:
+        boost::asio::ip::udp::socket &m_socket;
+        size_t m_batchSize;
+        size_t m_maxDatagramSize;
+
+        std::vector<char> m_rxBuffers;                       ///< One slot of maxDatagramSize per datagram
+        std::vector<struct iovec> m_rxIovecs;
+        std::vector<struct mmsghdr> m_rxMessages;
+        std::vector<boost::asio::ip::udp::endpoint> m_senders;
+        size_t m_rxCount;                                    ///< Datagrams held by the buffers
+
+        std::vector<char> m_txHeaders;                       ///< One slot of MAX_HEADER_SIZE per datagram
+        std::vector<struct iovec> m_txIovecs;                ///< Header and data of each datagram
+        std::vector<struct mmsghdr> m_txMessages;
+        std::vector<boost::asio::ip::udp::endpoint> m_destinations;
+        size_t m_txCount;                                    ///< Datagrams waiting for flush()
+    };
+}
+
+#endif /* _CORE_NETWORKING_BATCH_UDP_SOCKET_ */
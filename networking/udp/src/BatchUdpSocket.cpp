@@ -0,0 +1,157 @@
+/**
+ * @file BatchUdpSocket.cpp
+ *
+ * @author Nicolae Natea
+ * Contact: nicu@natea.ro
+ */
+
+#include <BatchUdpSocket.hpp>
+
+#include <cerrno>
+#include <cstring>
+
+namespace networking
+{
+    BatchUdpSocket::BatchUdpSocket(boost::asio::ip::udp::socket &socket, size_t batchSize, size_t maxDatagramSize) :
+        m_socket(socket),
+        m_batchSize(batchSize),
+        m_maxDatagramSize(maxDatagramSize),
+        m_rxBuffers(batchSize * maxDatagramSize),
+        m_rxIovecs(batchSize),
+        m_rxMessages(batchSize),
+        m_senders(batchSize),
+        m_rxCount(0),
+        m_txHeaders(batchSize * MAX_HEADER_SIZE),
+        m_txIovecs(2 * batchSize),
+        m_txMessages(batchSize),
+        m_destinations(batchSize),
+        m_txCount(0)
+    {
+        for (size_t i = 0; i < m_batchSize; ++i)
+        {
+            m_rxIovecs[i].iov_base = &m_rxBuffers[i * m_maxDatagramSize];
+            m_rxIovecs[i].iov_len = m_maxDatagramSize;
+
+            std::memset(&m_rxMessages[i], 0, sizeof(m_rxMessages[i]));
+            m_rxMessages[i].msg_hdr.msg_iov = &m_rxIovecs[i];
+            m_rxMessages[i].msg_hdr.msg_iovlen = 1;
+
+            std::memset(&m_txMessages[i], 0, sizeof(m_txMessages[i]));
+            m_txMessages[i].msg_hdr.msg_iov = &m_txIovecs[2 * i];
+        }
+    }
+
+    size_t BatchUdpSocket::receive(int flags, boost::system::error_code &error)
+    {
+        error.clear();
+
+        for (size_t i = 0; i < m_batchSize; ++i)
+        {
+            // Both are updated by every call
+            m_rxMessages[i].msg_hdr.msg_name = m_senders[i].data();
+            m_rxMessages[i].msg_hdr.msg_namelen = m_senders[i].capacity();
+            m_rxMessages[i].msg_hdr.msg_flags = 0;
+        }
+
+        int count;
+        do
+        {
+            count = ::recvmmsg(m_socket.native_handle(), m_rxMessages.data(), m_batchSize, flags, nullptr);
+        } while ((count < 0) and (errno == EINTR));
+
+        if (count < 0)
+        {
+            error = boost::system::error_code(errno, boost::asio::error::get_system_category());
+            m_rxCount = 0;
+            return 0;
+        }
+
+        for (int i = 0; i < count; ++i)
+        {
+            m_senders[i].resize(m_rxMessages[i].msg_hdr.msg_namelen);
+        }
+
+        m_rxCount = count;
+        return m_rxCount;
+    }
+
+    std::string_view BatchUdpSocket::getDatagram(size_t index) const
+    {
+        if (index >= m_rxCount)
+        {
+            return std::string_view();
+        }
+
+        return std::string_view(&m_rxBuffers[index * m_maxDatagramSize], m_rxMessages[index].msg_len);
+    }
+
+    const boost::asio::ip::udp::endpoint &BatchUdpSocket::getSender(size_t index) const
+    {
+        return m_senders.at(index);
+    }
+
+    bool BatchUdpSocket::isTruncated(size_t index) const
+    {
+        return (index < m_rxCount) and ((m_rxMessages[index].msg_hdr.msg_flags & MSG_TRUNC) != 0);
+    }
+
+    bool BatchUdpSocket::add(
+        const boost::asio::ip::udp::endpoint &destination,
+        std::string_view header,
+        std::string_view data)
+    {
+        if ((m_txCount == m_batchSize) or (header.size() > MAX_HEADER_SIZE))
+        {
+            return false;
+        }
+
+        size_t i = m_txCount++;
+        char *headerSlot = &m_txHeaders[i * MAX_HEADER_SIZE];
+        std::memcpy(headerSlot, header.data(), header.size());
+
+        m_destinations[i] = destination;
+        m_txIovecs[2 * i].iov_base = headerSlot;
+        m_txIovecs[2 * i].iov_len = header.size();
+        m_txIovecs[2 * i + 1].iov_base = const_cast<char *>(data.data());
+        m_txIovecs[2 * i + 1].iov_len = data.size();
+
+        m_txMessages[i].msg_hdr.msg_name = m_destinations[i].data();
+        m_txMessages[i].msg_hdr.msg_namelen = m_destinations[i].size();
+        m_txMessages[i].msg_hdr.msg_iovlen = data.empty() ? 1 : 2;
+
+        return true;
+    }
+
+    size_t BatchUdpSocket::getPendingCount() const
+    {
+        return m_txCount;
+    }
+
+    size_t BatchUdpSocket::flush(boost::system::error_code &error)
+    {
+        error.clear();
+        size_t sent = 0;
+
+        // sendmmsg stops early when the socket buffer fills up
+        while (sent < m_txCount)
+        {
+            int count = ::sendmmsg(m_socket.native_handle(), &m_txMessages[sent], m_txCount - sent, 0);
+
+            if (count < 0)
+            {
+                if (errno == EINTR)
+                {
+                    continue;
+                }
+
+                error = boost::system::error_code(errno, boost::asio::error::get_system_category());
+                break;
+            }
+
+            sent += count;
+        }
+
+        m_txCount = 0;
+        return sent;
+    }
+}
@@ -0,0 +1,119 @@
+/**
+ * @file BatchUdpSocketTest.cpp
+ *
+ * @author Nicolae Natea
+ * Contact: nicu@natea.ro
+ */
+
+#include <string>
+
+#include <gtest/gtest.h>
+
+#include <BatchUdpSocket.hpp>
+
+namespace
+{
+    struct BatchUdpSocketTest : public ::testing::Test
+    {
+        boost::asio::io_context io;
+        boost::asio::ip::udp::socket sender{io};
+        boost::asio::ip::udp::socket receiver{io};
+        boost::asio::ip::udp::endpoint destination;
+
+        void SetUp() override
+        {
+            boost::asio::ip::udp::endpoint loopback(boost::asio::ip::address_v4::loopback(), 0);
+
+            sender.open(loopback.protocol());
+            sender.bind(loopback);
+            receiver.open(loopback.protocol());
+            receiver.bind(loopback);
+
+            destination = receiver.local_endpoint();
+        }
+    };
+}
+
+TEST_F(BatchUdpSocketTest, FlushSendsQueuedDatagramsInOrder)
+{
+    networking::BatchUdpSocket tx(sender, 4);
+    networking::BatchUdpSocket rx(receiver, 4);
+    std::string data = "payload";
+
+    EXPECT_TRUE(tx.add(destination, "a:"));
+    EXPECT_TRUE(tx.add(destination, "b:", data));
+    EXPECT_TRUE(tx.add(destination, "c:", data));
+    EXPECT_EQ(tx.getPendingCount(), 3u);
+
+    boost::system::error_code error;
+    EXPECT_EQ(tx.flush(error), 3u);
+    EXPECT_FALSE(error);
+    EXPECT_EQ(tx.getPendingCount(), 0u);
+
+    size_t count = 0;
+    while (count < 3)
+    {
+        size_t received = rx.receive(MSG_WAITFORONE, error);
+        ASSERT_FALSE(error);
+
+        for (size_t i = 0; i < received; ++i, ++count)
+        {
+            static const std::string expected[] = { "a:", "b:payload", "c:payload" };
+            EXPECT_EQ(rx.getDatagram(i), expected[count]);
+            EXPECT_EQ(rx.getSender(i), sender.local_endpoint());
+            EXPECT_FALSE(rx.isTruncated(i));
+        }
+    }
+}
+
+TEST_F(BatchUdpSocketTest, AddRejectsFullBatchAndLargeHeader)
+{
+    networking::BatchUdpSocket tx(sender, 2);
+
+    EXPECT_FALSE(tx.add(destination, std::string(networking::BatchUdpSocket::MAX_HEADER_SIZE + 1, 'h')));
+    EXPECT_TRUE(tx.add(destination, "1"));
+    EXPECT_TRUE(tx.add(destination, "2"));
+    EXPECT_FALSE(tx.add(destination, "3"));
+    EXPECT_EQ(tx.getPendingCount(), 2u);
+
+    boost::system::error_code error;
+    EXPECT_EQ(tx.flush(error), 2u);
+    EXPECT_TRUE(tx.add(destination, "3"));
+}
+
+TEST_F(BatchUdpSocketTest, ReceiveReportsTruncation)
+{
+    networking::BatchUdpSocket tx(sender, 1);
+    networking::BatchUdpSocket rx(receiver, 1, 4);
+
+    boost::system::error_code error;
+    tx.add(destination, "too long");
+    tx.flush(error);
+
+    ASSERT_EQ(rx.receive(MSG_WAITFORONE, error), 1u);
+    EXPECT_EQ(rx.getDatagram(0), "too ");
+    EXPECT_TRUE(rx.isTruncated(0));
+}
+
+TEST_F(BatchUdpSocketTest, ReceiveWithoutDatagramsWouldBlock)
+{
+    networking::BatchUdpSocket rx(receiver, 4);
+
+    boost::system::error_code error;
+    EXPECT_EQ(rx.receive(MSG_DONTWAIT, error), 0u);
+    EXPECT_EQ(error, boost::asio::error::would_block);
+    EXPECT_TRUE(rx.getDatagram(0).empty());
+}
+
+TEST_F(BatchUdpSocketTest, FlushReportsErrorAndEmptiesBatch)
+{
+    networking::BatchUdpSocket tx(sender, 2);
+
+    tx.add(destination, "lost");
+    sender.close();
+
+    boost::system::error_code error;
+    EXPECT_EQ(tx.flush(error), 0u);
+    EXPECT_TRUE(error);
+    EXPECT_EQ(tx.getPendingCount(), 0u);
+}
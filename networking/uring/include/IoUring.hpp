@@ -0,0 +1,148 @@
+/**
+ * @file IoUring.hpp
+ *
+ * @brief Minimal io_uring instance driven through the raw system calls.
+ *        Requests are queued as submission entries and handed to the
+ *        kernel in batches with a single io_uring_enter; completions are
+ *        reaped from the shared completion ring without a system call.
+ *        ProvidedBuffers registers a ring of receive buffers the kernel
+ *        picks from, which multishot receives need.
+ *
+ * @author Nicolae Natea
+ * Contact: nicu@natea.ro
+ */
+
+#ifndef _CORE_NETWORKING_IO_URING_
+#define _CORE_NETWORKING_IO_URING_
+
+#include <linux/io_uring.h>
+#include <sys/socket.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace networking
+{
+    class IoUring
+    {
+    public:
+        /**
+         * @param[in] entries submission queue size, rounded up to a power of two
+         * @throws std::system_error if the kernel refuses to create the ring
+         */
+        explicit IoUring(unsigned entries);
+        ~IoUring();
+
+        IoUring(const IoUring &) = delete;
+        IoUring &operator=(const IoUring &) = delete;
+
+        /**
+         * @return cleared submission entry, queued on the next submit.
+         *         A full queue is submitted first to make room; nullptr
+         *         if the kernel does not take any more entries.
+         */
+        struct io_uring_sqe *getSqe();
+
+        /** Hands the queued entries to the kernel, @return number submitted or -errno */
+        int submit();
+
+        /** Submits and blocks until at least one completion is available, @return as submit() */
+        int submitAndWait();
+
+        /**
+         * Reaps the available completions.
+         *
+         * @param[in] handler called as handler(const io_uring_cqe &) for each one
+         * @return number of completions handled
+         */
+        template<typename Handler>
+        unsigned forEachCompletion(Handler handler)
+        {
+            unsigned head = *m_cqHead;
+            unsigned tail = __atomic_load_n(m_cqTail, __ATOMIC_ACQUIRE);
+            unsigned count = 0;
+
+            for (; head != tail; ++head, ++count)
+            {
+                handler(m_cqes[head & m_cqMask]);
+            }
+
+            __atomic_store_n(m_cqHead, head, __ATOMIC_RELEASE);
+            return count;
+        }
+
+        /** @return file descriptor of the ring, used to register resources */
+        int getFd() const;
+
+        // Request helpers, each fills a new submission entry; false if none is left
+        bool prepareAcceptMultishot(int fd, uint64_t userData);
+        bool prepareRecvMultishot(int fd, uint16_t bufferGroup, uint64_t userData);
+        bool prepareSendmsg(int fd, const struct msghdr *message, uint64_t userData);
+        bool prepareRead(int fd, void *buffer, unsigned size, uint64_t userData);
+        bool prepareCancel(uint64_t target, uint64_t userData);
+
+    private:
+        /** Unmaps the rings and closes the instance */
+        void release();
+
+        int m_fd;
+        unsigned m_sqEntries;
+
+        void *m_sqRing;
+        size_t m_sqRingSize;
+        void *m_cqRing;
+        size_t m_cqRingSize;
+        struct io_uring_sqe *m_sqes;
+        size_t m_sqesSize;
+
+        unsigned *m_sqHead;
+        unsigned *m_sqTail;
+        unsigned m_sqMask;
+        unsigned *m_sqArray;
+        unsigned m_sqLocalTail;  ///< Entries handed out, published on submit
+
+        unsigned *m_cqHead;
+        unsigned *m_cqTail;
+        unsigned m_cqMask;
+        struct io_uring_cqe *m_cqes;
+    };
+
+    class ProvidedBuffers
+    {
+    public:
+        /**
+         * @param[in] ring ring the buffers are registered with, must outlive them
+         * @param[in] group id receives refer to
+         * @param[in] count number of buffers, a power of two
+         * @param[in] size bytes of each buffer
+         * @throws std::system_error if the kernel refuses the registration
+         */
+        ProvidedBuffers(IoUring &ring, uint16_t group, uint16_t count, size_t size);
+        ~ProvidedBuffers();
+
+        ProvidedBuffers(const ProvidedBuffers &) = delete;
+        ProvidedBuffers &operator=(const ProvidedBuffers &) = delete;
+
+        /** @return id of the group */
+        uint16_t getGroup() const;
+
+        /** @return start of a buffer */
+        const char *get(uint16_t id) const;
+
+        /** Gives a buffer back to the kernel once its data was consumed */
+        void recycle(uint16_t id);
+
+    private:
+        IoUring &m_ring;
+        uint16_t m_group;
+        uint16_t m_count;
+        size_t m_size;
+        struct io_uring_buf_ring *m_bufferRing; ///< Shared with the kernel
+        size_t m_bufferRingSize;
+        std::vector<char> m_buffers;
+        uint16_t m_tail;
+    };
+}
+
+#endif /* _CORE_NETWORKING_IO_URING_ */
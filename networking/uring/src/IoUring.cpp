@@ -0,0 +1,340 @@
+/**
+ * @file IoUring.cpp
+ *
+ * @author Nicolae Natea
+ * Contact: nicu@natea.ro
+ */
+
+#include <IoUring.hpp>
+
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <system_error>
+
+namespace networking
+{
+    namespace
+    {
+        int enter(int fd, unsigned toSubmit, unsigned minComplete, unsigned flags)
+        {
+            int result;
+            do
+            {
+                result = static_cast<int>(::syscall(__NR_io_uring_enter, fd, toSubmit, minComplete, flags, nullptr, 0));
+            } while ((result < 0) and (errno == EINTR));
+
+            return (result < 0) ? -errno : result;
+        }
+
+        void *map(size_t size, int fd, off_t offset)
+        {
+            void *address = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, offset);
+
+            if (address == MAP_FAILED)
+            {
+                throw std::system_error(errno, std::system_category(), "io_uring mmap");
+            }
+
+            return address;
+        }
+
+        template<typename T>
+        T *at(void *ring, uint32_t offset)
+        {
+            return reinterpret_cast<T *>(static_cast<char *>(ring) + offset);
+        }
+    }
+
+    IoUring::IoUring(unsigned entries) :
+        m_fd(-1),
+        m_sqRing(MAP_FAILED),
+        m_sqRingSize(0),
+        m_cqRing(MAP_FAILED),
+        m_cqRingSize(0),
+        m_sqes(static_cast<struct io_uring_sqe *>(MAP_FAILED)),
+        m_sqesSize(0),
+        m_sqLocalTail(0)
+    {
+        struct io_uring_params params;
+        std::memset(&params, 0, sizeof(params));
+
+        m_fd = static_cast<int>(::syscall(__NR_io_uring_setup, entries, &params));
+        if (m_fd < 0)
+        {
+            throw std::system_error(errno, std::system_category(), "io_uring_setup");
+        }
+
+        try
+        {
+            m_sqEntries = params.sq_entries;
+            m_sqRingSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+            m_cqRingSize = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+
+            // Recent kernels share a single mapping between both rings
+            if (params.features & IORING_FEAT_SINGLE_MMAP)
+            {
+                m_sqRingSize = m_cqRingSize = std::max(m_sqRingSize, m_cqRingSize);
+                m_sqRing = map(m_sqRingSize, m_fd, IORING_OFF_SQ_RING);
+                m_cqRing = m_sqRing;
+            }
+            else
+            {
+                m_sqRing = map(m_sqRingSize, m_fd, IORING_OFF_SQ_RING);
+                m_cqRing = map(m_cqRingSize, m_fd, IORING_OFF_CQ_RING);
+            }
+
+            m_sqesSize = params.sq_entries * sizeof(struct io_uring_sqe);
+            m_sqes = static_cast<struct io_uring_sqe *>(map(m_sqesSize, m_fd, IORING_OFF_SQES));
+        }
+        catch (...)
+        {
+            release();
+            throw;
+        }
+
+        m_sqHead = at<unsigned>(m_sqRing, params.sq_off.head);
+        m_sqTail = at<unsigned>(m_sqRing, params.sq_off.tail);
+        m_sqMask = *at<unsigned>(m_sqRing, params.sq_off.ring_mask);
+        m_sqArray = at<unsigned>(m_sqRing, params.sq_off.array);
+        m_cqHead = at<unsigned>(m_cqRing, params.cq_off.head);
+        m_cqTail = at<unsigned>(m_cqRing, params.cq_off.tail);
+        m_cqMask = *at<unsigned>(m_cqRing, params.cq_off.ring_mask);
+        m_cqes = at<struct io_uring_cqe>(m_cqRing, params.cq_off.cqes);
+        m_sqLocalTail = *m_sqTail;
+
+        // Entries are always used in order, so the indirection array never changes
+        for (unsigned i = 0; i < m_sqEntries; ++i)
+        {
+            m_sqArray[i] = i;
+        }
+    }
+
+    IoUring::~IoUring()
+    {
+        release();
+    }
+
+    void IoUring::release()
+    {
+        if (m_sqes != MAP_FAILED)
+        {
+            ::munmap(m_sqes, m_sqesSize);
+        }
+
+        if ((m_cqRing != MAP_FAILED) and (m_cqRing != m_sqRing))
+        {
+            ::munmap(m_cqRing, m_cqRingSize);
+        }
+
+        if (m_sqRing != MAP_FAILED)
+        {
+            ::munmap(m_sqRing, m_sqRingSize);
+        }
+
+        if (m_fd >= 0)
+        {
+            ::close(m_fd);
+        }
+
+        m_sqes = static_cast<struct io_uring_sqe *>(MAP_FAILED);
+        m_cqRing = m_sqRing = MAP_FAILED;
+        m_fd = -1;
+    }
+
+    struct io_uring_sqe *IoUring::getSqe()
+    {
+        if (m_sqLocalTail - __atomic_load_n(m_sqHead, __ATOMIC_ACQUIRE) >= m_sqEntries)
+        {
+            submit();
+
+            if (m_sqLocalTail - __atomic_load_n(m_sqHead, __ATOMIC_ACQUIRE) >= m_sqEntries)
+            {
+                return nullptr;
+            }
+        }
+
+        struct io_uring_sqe *sqe = &m_sqes[m_sqLocalTail & m_sqMask];
+        std::memset(sqe, 0, sizeof(*sqe));
+        ++m_sqLocalTail;
+
+        return sqe;
+    }
+
+    int IoUring::submit()
+    {
+        unsigned toSubmit = m_sqLocalTail - *m_sqTail;
+
+        if (toSubmit == 0)
+        {
+            return 0;
+        }
+
+        __atomic_store_n(m_sqTail, m_sqLocalTail, __ATOMIC_RELEASE);
+        return enter(m_fd, toSubmit, 0, 0);
+    }
+
+    int IoUring::submitAndWait()
+    {
+        unsigned toSubmit = m_sqLocalTail - *m_sqTail;
+
+        __atomic_store_n(m_sqTail, m_sqLocalTail, __ATOMIC_RELEASE);
+        return enter(m_fd, toSubmit, 1, IORING_ENTER_GETEVENTS);
+    }
+
+    int IoUring::getFd() const
+    {
+        return m_fd;
+    }
+
+    bool IoUring::prepareAcceptMultishot(int fd, uint64_t userData)
+    {
+        if (struct io_uring_sqe *sqe = getSqe())
+        {
+            sqe->opcode = IORING_OP_ACCEPT;
+            sqe->fd = fd;
+            sqe->ioprio = IORING_ACCEPT_MULTISHOT;
+            // Non blocking sockets are polled by the ring instead of tying up a kernel worker
+            sqe->accept_flags = SOCK_NONBLOCK | SOCK_CLOEXEC;
+            sqe->user_data = userData;
+            return true;
+        }
+
+        return false;
+    }
+
+    bool IoUring::prepareRecvMultishot(int fd, uint16_t bufferGroup, uint64_t userData)
+    {
+        if (struct io_uring_sqe *sqe = getSqe())
+        {
+            sqe->opcode = IORING_OP_RECV;
+            sqe->fd = fd;
+            sqe->flags = IOSQE_BUFFER_SELECT;
+            sqe->buf_group = bufferGroup;
+            sqe->ioprio = IORING_RECV_MULTISHOT;
+            sqe->user_data = userData;
+            return true;
+        }
+
+        return false;
+    }
+
+    bool IoUring::prepareSendmsg(int fd, const struct msghdr *message, uint64_t userData)
+    {
+        if (struct io_uring_sqe *sqe = getSqe())
+        {
+            sqe->opcode = IORING_OP_SENDMSG;
+            sqe->fd = fd;
+            sqe->addr = reinterpret_cast<uint64_t>(message);
+            sqe->len = 1;
+            // Short sends are retried by the kernel
+            sqe->msg_flags = MSG_NOSIGNAL | MSG_WAITALL;
+            sqe->user_data = userData;
+            return true;
+        }
+
+        return false;
+    }
+
+    bool IoUring::prepareRead(int fd, void *buffer, unsigned size, uint64_t userData)
+    {
+        if (struct io_uring_sqe *sqe = getSqe())
+        {
+            sqe->opcode = IORING_OP_READ;
+            sqe->fd = fd;
+            sqe->addr = reinterpret_cast<uint64_t>(buffer);
+            sqe->len = size;
+            sqe->off = static_cast<uint64_t>(-1);
+            sqe->user_data = userData;
+            return true;
+        }
+
+        return false;
+    }
+
+    bool IoUring::prepareCancel(uint64_t target, uint64_t userData)
+    {
+        if (struct io_uring_sqe *sqe = getSqe())
+        {
+            sqe->opcode = IORING_OP_ASYNC_CANCEL;
+            sqe->fd = -1;
+            sqe->addr = target;
+            sqe->user_data = userData;
+            return true;
+        }
+
+        return false;
+    }
+
+    ProvidedBuffers::ProvidedBuffers(IoUring &ring, uint16_t group, uint16_t count, size_t size) :
+        m_ring(ring),
+        m_group(group),
+        m_count(count),
+        m_size(size),
+        m_bufferRingSize(count * sizeof(struct io_uring_buf)),
+        m_buffers(count * size),
+        m_tail(0)
+    {
+        // The ring must be page aligned
+        void *memory = ::mmap(nullptr, m_bufferRingSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (memory == MAP_FAILED)
+        {
+            throw std::system_error(errno, std::system_category(), "provided buffers mmap");
+        }
+
+        m_bufferRing = static_cast<struct io_uring_buf_ring *>(memory);
+
+        struct io_uring_buf_reg registration;
+        std::memset(&registration, 0, sizeof(registration));
+        registration.ring_addr = reinterpret_cast<uint64_t>(m_bufferRing);
+        registration.ring_entries = count;
+        registration.bgid = group;
+
+        if (::syscall(__NR_io_uring_register, m_ring.getFd(), IORING_REGISTER_PBUF_RING, &registration, 1) < 0)
+        {
+            int error = errno;
+            ::munmap(m_bufferRing, m_bufferRingSize);
+            throw std::system_error(error, std::system_category(), "IORING_REGISTER_PBUF_RING");
+        }
+
+        for (uint16_t id = 0; id < count; ++id)
+        {
+            recycle(id);
+        }
+    }
+
+    ProvidedBuffers::~ProvidedBuffers()
+    {
+        struct io_uring_buf_reg registration;
+        std::memset(&registration, 0, sizeof(registration));
+        registration.bgid = m_group;
+
+        ::syscall(__NR_io_uring_register, m_ring.getFd(), IORING_UNREGISTER_PBUF_RING, &registration, 1);
+        ::munmap(m_bufferRing, m_bufferRingSize);
+    }
+
+    uint16_t ProvidedBuffers::getGroup() const
+    {
+        return m_group;
+    }
+
+    const char *ProvidedBuffers::get(uint16_t id) const
+    {
+        return &m_buffers[static_cast<size_t>(id) * m_size];
+    }
+
+    void ProvidedBuffers::recycle(uint16_t id)
+    {
+        // Entries start at the ring itself, their flexible array member is misplaced when compiled as C++
+        struct io_uring_buf *buffer = reinterpret_cast<struct io_uring_buf *>(m_bufferRing) + (m_tail & (m_count - 1));
+        buffer->addr = reinterpret_cast<uint64_t>(&m_buffers[static_cast<size_t>(id) * m_size]);
+        buffer->len = static_cast<uint32_t>(m_size);
+        buffer->bid = id;
+
+        __atomic_store_n(&m_bufferRing->tail, ++m_tail, __ATOMIC_RELEASE);
+    }
+}